@@ -0,0 +1,272 @@
+//
+//  BeamPolicy.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/24/21.
+//
+
+#include <algorithm>
+#include "BeamPolicy.hpp"
+
+// --- BEGIN PRIVATE ---
+
+BeamPolicy::Scratch::Scratch(): board(0, 0) {}
+
+/**
+ Expands one node: tries every placement of the piece on a copy of its board,
+ scores the boards in one batch, and adds each one the table hasn't seen from
+ a better sequence to the chunk.
+*/
+void BeamPolicy::expand(Scratch &s, const int &node, const int &ply, const PIECE_TYPE &type,
+                        const vector<Placement> *placements, Chunk &chunk) {
+  const Node &parent = this->beam[node];
+  const vector<Placement> &tried = placements ? *placements : s.generator.generate(parent.board, type);
+  const int count = (int)tried.size();
+  // Boards too big for the batch kernels are scored one at a time
+  const bool batch = Evaluator::fits(parent.board.getRows(), parent.board.getCols());
+  s.boards.resize(batch ? count : 0);
+  s.footprints.resize(count);
+  s.hashes.resize(count);
+  s.lines.resize(count);
+  s.features.resize(count);
+  chunk.scored += count;
+
+  for (int i = 0; i < count; i++) {
+    // Lock the piece on a copy and clear whatever it completes
+    const Footprint &f = tried[i].piece.getFootprint();
+    s.board = parent.board;
+    s.board.place(f, 1);
+    s.lines[i] = s.board.clearFullRows(f.top, f.top + 3);
+    s.footprints[i] = f;
+    s.hashes[i] = s.board.getHash();
+    if (batch)
+      Evaluator::compact(s.board, s.boards[i]);
+    else
+      Evaluator::evaluate(s.board, i, s.features);
+  }
+
+  if (batch)
+    Evaluator::evaluate(s.boards.data(), count, s.board.getRows(), s.board.getCols(), s.features);
+
+  // Boards are keyed by decision and piece as well, so old entries never match
+  const uint64_t salt = ((this->searches << 8) | (uint64_t)ply) * 0x9E3779B97F4A7C15ull;
+  for (int i = 0; i < count; i++) {
+    const float reward = parent.reward + (float)(this->weights.lines * s.lines[i]);
+    const float score = reward + (float)(this->weights.height * s.features.height[i] +
+                                         this->weights.holes * s.features.holes[i] +
+                                         this->weights.bumpiness * s.features.bumpiness[i]);
+
+    // Another sequence already reached this board with at least as much
+    TableEntry seen;
+    const uint64_t key = s.hashes[i] ^ salt;
+    if (this->table.probe(key, seen) && seen.score >= score)
+      continue;
+    this->table.store(key, { score, -1, (uint8_t)ply, 0 });
+
+    chunk.candidates.push_back({ node, placements ? i : parent.root, s.footprints[i], reward, score });
+  }
+}
+
+/**
+ Expands every node in the beam. The beam is cut into a few chunks per worker
+ so a worker that finishes early can steal the rest, and each chunk writes only
+ to its own candidate list.
+
+ @return: true if every node was expanded in time; false otherwise.
+*/
+bool BeamPolicy::expandAll(const int &ply, const PIECE_TYPE &type,
+                           const vector<Placement> *placements) {
+  const int count = (int)this->chunks.size();
+  for (int c = 0; c < count; c++) {
+    Chunk &chunk = this->chunks[c];
+    chunk.first = this->beam_size * c / count;
+    chunk.last = this->beam_size * (c + 1) / count;
+    chunk.finished = chunk.first == chunk.last;
+    chunk.scored = 0;
+    chunk.candidates.clear();
+  }
+
+  // The active piece is always searched to the end, so there is an answer
+  const bool timed = ply > 0 && this->settings.budget > 0;
+  const auto run = [this, ply, type, placements, timed](Chunk &chunk, Scratch &s) {
+    for (int node = chunk.first; node < chunk.last; node++) {
+      if (timed && (this->expired || std::chrono::steady_clock::now() > this->deadline)) {
+        this->expired = true;
+        return;
+      }
+      this->expand(s, node, ply, type, placements, chunk);
+    }
+    chunk.finished = true;
+  };
+
+  if (this->pool) {
+    for (int c = 0; c < count; c++)
+      if (!this->chunks[c].finished)
+        this->pool->submit([this, c, &run](int worker) {
+          run(this->chunks[c], *this->scratch[worker]);
+        });
+    this->pool->wait();
+  } else {
+    for (Chunk &chunk : this->chunks)
+      if (!chunk.finished)
+        run(chunk, *this->scratch[0]);
+  }
+
+  for (const Chunk &chunk : this->chunks) {
+    this->nodes += chunk.scored;
+    if (!chunk.finished)
+      return false;
+  }
+  return true;
+}
+
+/**
+ Keeps the best `width` candidates and turns them into the next beam, best
+ first. Only the kept ones are ever copied into a board.
+*/
+void BeamPolicy::select() {
+  this->candidates.clear();
+  for (const Chunk &chunk : this->chunks)
+    this->candidates.insert(this->candidates.end(), chunk.candidates.begin(), chunk.candidates.end());
+
+  const auto better = [](const Candidate &a, const Candidate &b) {
+    return a.score > b.score;
+  };
+  const int kept = std::min((int)this->candidates.size(), this->settings.width);
+  std::partial_sort(this->candidates.begin(), this->candidates.begin() + kept,
+                    this->candidates.end(), better);
+
+  if ((int)this->next.size() < kept)
+    this->next.resize(kept, { Bitboard(0, 0), 0, 0 });
+  for (int i = 0; i < kept; i++) {
+    const Candidate &c = this->candidates[i];
+    Node &node = this->next[i];
+    node.board = this->beam[c.parent].board;
+    node.board.place(c.footprint, 1);
+    node.board.clearFullRows(c.footprint.top, c.footprint.top + 3);
+    node.root = c.root;
+    node.reward = c.reward;
+  }
+
+  // The old beam's boards are reused by the one after
+  std::swap(this->beam, this->next);
+  this->beam_size = kept;
+}
+
+/**
+ Asks the table for the shortest perfect clear with the active piece and the
+ preview, and finds its first move among the active piece's placements.
+
+ @return: the index of the placement, or -1 if there is no table, no perfect
+ clear, or the move isn't one of the placements.
+*/
+int BeamPolicy::perfectClear(const Board &board, const PIECE_TYPE *preview, const int &count,
+                             const vector<Placement> &placements) const {
+  if (!this->perfect_clears || !this->perfect_clears->isOpen())
+    return -1;
+
+  PIECE_TYPE pieces[PerfectClearTable::MAX_PIECES];
+  int known = 0;
+  pieces[known++] = board.getActive().getType();
+  for (int i = 0; i < count && known < PerfectClearTable::MAX_PIECES; i++)
+    pieces[known++] = preview[i];
+
+  uint64_t move;
+  int used;
+  if (!this->perfect_clears->lookup(board.getBitboard(), pieces, known, move, used))
+    return -1;
+
+  const int rows = board.getBitboard().getRows();
+  for (int i = 0; i < (int)placements.size(); i++)
+    if (PerfectClearTable::cells(placements[i].piece.getFootprint(), rows) == move)
+      return i;
+  return -1;
+}
+
+// --- END PRIVATE ---
+
+// --- BEGIN PUBLIC ---
+
+/**
+ Public constructor.
+*/
+BeamPolicy::BeamPolicy(const BeamSettings &settings, const Weights &weights):
+  settings(settings), weights(weights), table(settings.table_bits) {
+  if (this->settings.threads > 1)
+    this->pool.reset(new WorkStealingPool(this->settings.threads));
+  const int workers = this->pool ? this->pool->size() : 1;
+  for (int i = 0; i < workers; i++)
+    this->scratch.push_back(std::unique_ptr<Scratch>(new Scratch()));
+  this->chunks.resize(this->pool ? workers * 4 : 1);
+
+  this->beam_size = 0;
+  this->searches = 0;
+  this->expired = false;
+  this->nodes = 0;
+  this->depth = 0;
+  this->perfect_clears = nullptr;
+}
+
+/**
+ Searches the active piece and the preview one piece at a time, keeping the
+ best boards after each, until the preview runs out or the budget does. The
+ best board of the deepest piece finished decides the placement.
+*/
+int BeamPolicy::choose(const Board &board, const vector<Placement> &placements) {
+  this->deadline = std::chrono::steady_clock::now() +
+    std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(this->settings.budget));
+  this->expired = false;
+  this->searches++;
+  this->nodes = 0;
+  this->depth = 0;
+
+  if (this->beam.empty())
+    this->beam.resize(1, { Bitboard(0, 0), 0, 0 });
+  this->beam_size = 1;
+  this->beam[0].board = board.getBitboard();
+  this->beam[0].root = 0;
+  this->beam[0].reward = 0;
+
+  // Filled on the stack so the decision doesn't allocate
+  PIECE_TYPE preview[MAX_PREVIEW];
+  const int count = std::max(0, std::min(this->settings.preview, (int)MAX_PREVIEW));
+  board.getPreview(preview, count);
+  const int solved = this->perfectClear(board, preview, count, placements);
+  if (solved >= 0)
+    return solved;
+
+  int best = 0;
+  for (int ply = 0; ply <= count; ply++) {
+    const PIECE_TYPE type = ply == 0 ? board.getActive().getType() : preview[ply - 1];
+    if (!this->expandAll(ply, type, ply == 0 ? &placements : nullptr))
+      break;
+    this->select();
+    // Every line of play topped out
+    if (this->beam_size == 0)
+      break;
+    best = this->beam[0].root;
+    this->depth = ply + 1;
+  }
+
+  return best;
+}
+
+/**
+ Sets the perfect-clear table to consult before searching.
+*/
+void BeamPolicy::setPerfectClears(const PerfectClearTable *table) {
+  this->perfect_clears = table;
+}
+
+// Gets the number of boards scored in the last decision
+long BeamPolicy::getNodes() const {
+  return this->nodes;
+}
+
+// Gets the number of pieces the last decision finished
+int BeamPolicy::getDepth() const {
+  return this->depth;
+}
+
+// --- END PUBLIC ---
@@ -0,0 +1,223 @@
+//
+//  BeamPolicy.hpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/24/21.
+//
+
+#ifndef BeamPolicy_hpp
+#define BeamPolicy_hpp
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "PerfectClearTable.hpp"
+#include "Policy.hpp"
+#include "TranspositionTable.hpp"
+#include "WorkStealingPool.hpp"
+
+using std::vector;
+
+/**
+ How wide, how deep and how long a <BeamPolicy> searches.
+*/
+struct BeamSettings {
+  /**
+   # of positions kept after each piece.
+  */
+  int width = 64;
+  /**
+   # of pieces from the preview queue searched after the active one, up to
+   BeamPolicy::MAX_PREVIEW.
+  */
+  int preview = 3;
+  /**
+   Seconds one decision may take, 0 for no limit. The search answers from the
+   deepest piece it finished in time; the active piece is always finished.
+  */
+  double budget = 0;
+  /**
+   # of threads expanding each piece. 1 searches on the calling thread.
+  */
+  int threads = 1;
+  /**
+   The table that merges positions reached more than one way has 2^table_bits
+   slots.
+  */
+  int table_bits = 18;
+};
+
+/**
+ Plays several pieces ahead with a beam search over the preview queue. Every
+ placement of the active piece is tried, the best `width` boards are kept, and
+ each of them is extended with every placement of the next piece, and so on.
+ The placement of the active piece that leads to the best board at the end is
+ the one chosen. Boards are scored as in <HeuristicPolicy>, plus the lines
+ cleared on the way.
+
+ The beam is split into chunks of nodes that the workers expand on their own
+ buffers into their own candidate lists; the only thing they share is a
+ lock-free <TranspositionTable> that drops boards already reached by a better
+ sequence. The chunks are merged once per piece.
+
+ With a <PerfectClearTable>, a stack the table can clear with the active piece
+ and the preview skips the search and plays the table's move.
+*/
+class BeamPolicy : public Policy {
+private:
+  typedef std::chrono::steady_clock::time_point Time;
+
+  /**
+   A board kept in the beam, which of the active piece's placements it came
+   from, and the reward for the lines cleared getting there.
+  */
+  struct Node {
+    Bitboard board;
+    int root;
+    float reward;
+  };
+
+  /**
+   A placement tried from a node in the beam. Only the ones kept are turned
+   into boards.
+  */
+  struct Candidate {
+    int parent;
+    int root;
+    Footprint footprint;
+    float reward;
+    float score;
+  };
+
+  /**
+   The buffers one worker expands nodes with.
+  */
+  struct Scratch {
+    MoveGenerator generator;
+    Bitboard board;
+    vector<CompactBoard> boards;
+    vector<Footprint> footprints;
+    vector<uint64_t> hashes;
+    vector<int> lines;
+    Features features;
+
+    Scratch();
+  };
+
+  /**
+   A run of nodes expanded as one task, the # of boards it scored and the
+   candidates it kept.
+  */
+  struct Chunk {
+    int first;
+    int last;
+    bool finished;
+    long scored;
+    vector<Candidate> candidates;
+  };
+
+  BeamSettings settings;
+  Weights weights;
+  /**
+   Workers, if there is more than one thread, and their buffers.
+  */
+  std::unique_ptr<WorkStealingPool> pool;
+  vector<std::unique_ptr<Scratch>> scratch;
+  TranspositionTable table;
+  /**
+   The beam for the current piece and the next one. Both only grow, so their
+   boards are reused; beam_size is how many of beam are in use.
+  */
+  vector<Node> beam;
+  vector<Node> next;
+  int beam_size;
+  /**
+   A few chunks per worker, so a worker that finishes early can steal.
+  */
+  vector<Chunk> chunks;
+  vector<Candidate> candidates;
+  /**
+   Mixed into the table keys so each decision and piece has its own entries
+   and the table never has to be cleared.
+  */
+  uint64_t searches;
+  /**
+   When the current decision has to be made by, and whether a worker has seen
+   it pass.
+  */
+  Time deadline;
+  std::atomic<bool> expired;
+  /**
+   # of boards scored and pieces finished in the last decision.
+  */
+  long nodes;
+  int depth;
+  /**
+   Solved perfect clears, if any. Not owned.
+  */
+  const PerfectClearTable *perfect_clears;
+
+  /**
+   @return: the index of the placement the perfect-clear table plays on the
+   board, or -1 if it has none.
+  */
+  int perfectClear(const Board &board, const PIECE_TYPE *preview, const int &count,
+                   const vector<Placement> &placements) const;
+
+  /**
+   Expands one node: tries every placement of the piece (or the given ones,
+   for the active piece), scores the boards and adds the ones the table
+   doesn't already have to the chunk.
+  */
+  void expand(Scratch &s, const int &node, const int &ply, const PIECE_TYPE &type,
+              const vector<Placement> *placements, Chunk &chunk);
+
+  /**
+   Expands every node in the beam, split across the workers.
+
+   @return: true if every node was expanded in time; false otherwise.
+  */
+  bool expandAll(const int &ply, const PIECE_TYPE &type,
+                 const vector<Placement> *placements);
+
+  /**
+   Keeps the best `width` candidates and turns them into the next beam, best
+   first.
+  */
+  void select();
+
+public:
+  /**
+   Most pieces of the preview queue the search looks at.
+  */
+  static const int MAX_PREVIEW = 16;
+
+  /**
+   Public constructor.
+  */
+  BeamPolicy(const BeamSettings &settings = BeamSettings(),
+             const Weights &weights = Weights());
+
+  int choose(const Board &board, const vector<Placement> &placements) override;
+
+  /**
+   Sets the perfect-clear table to consult before searching, or nullptr for
+   none. It has to outlive the policy.
+  */
+  void setPerfectClears(const PerfectClearTable *table);
+
+  /**
+   Gets the # of boards scored in the last decision
+  */
+  long getNodes() const;
+
+  /**
+   Gets the # of pieces the last decision finished searching, the active one
+   included
+  */
+  int getDepth() const;
+};
+
+#endif /* BeamPolicy_hpp */
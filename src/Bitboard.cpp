@@ -0,0 +1,377 @@
+//
+//  Bitboard.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/9/21.
+//
+
+#include <algorithm>
+#include <cstring>
+#include "Bitboard.hpp"
+#include "Zobrist.hpp"
+
+// --- BEGIN PRIVATE ---
+
+/**
+ Copies one board row over another, masks and colors.
+*/
+void Bitboard::copyRow(const int &from, const int &to) {
+  const int src = this->index(from);
+  const int dst = this->index(to);
+  this->masks[dst] = this->masks[src];
+  memcpy(&this->colors[dst * this->cols], &this->colors[src * this->cols], this->cols);
+}
+
+/**
+ @return: the Zobrist key of a row's filled cells.
+*/
+uint64_t Bitboard::rowHash(const int &row) const {
+  return Zobrist::row(row, (this->masks[this->index(row)] & ~this->empty_row) >> 1);
+}
+
+/**
+ Empties a board row.
+*/
+void Bitboard::emptyRow(const int &row) {
+  const int i = this->index(row);
+  this->masks[i] = this->empty_row;
+  memset(&this->colors[i * this->cols], 0, this->cols);
+}
+
+/**
+ Raises the surface of every column the row mask fills up to that row, if it
+ isn't that high already.
+*/
+void Bitboard::raiseSurface(const int &row, const uint64_t &mask) {
+  for (uint64_t bits = mask & ~this->empty_row; bits; bits &= bits - 1) {
+    int &top = this->surface[__builtin_ctzll(bits) - 1];
+    top = std::min(top, row);
+  }
+}
+
+/**
+ Follows each row of the footprint down until it hits something, and the
+ closest hit wins, so no row is ever tested twice.
+
+ @return: how many rows the footprint can move straight down.
+*/
+int Bitboard::scanDrop(const Footprint &f) const {
+  int distance = this->rows;
+  for (int i = 0; i < 4; i++) {
+    if (f.rows[i] == 0)
+      continue;
+
+    // The floor is the furthest this row can go, and it can't go further than
+    // a closer row of the piece already allows
+    const int from = f.top + i;
+    const int limit = std::min(this->rows - 1 - from, distance);
+    int d = 0;
+    while (d < limit && !(this->masks[this->index(from + d + 1)] & f.rows[i]))
+      d++;
+    distance = d;
+  }
+
+  return distance;
+}
+
+// --- END PRIVATE ---
+
+// --- BEGIN PUBLIC ---
+
+/**
+ Public constructor. A size that doesn't fit gets a board with no rows, which
+ every piece collides with, and its cols cut to at most MAX_COLS so the walls
+ still fit in the word. <WideBoard> takes boards wider than that.
+
+ @param rows - The number of rows on the board. Must be 1 to 64.
+ @param cols - The number of cols on the board. Must be 1 to 62.
+*/
+Bitboard::Bitboard(const int &rows, const int &cols) {
+  // Set rows and cols
+  this->rows = rows;
+  this->cols = cols;
+  if (!Bitboard::fits(rows, cols)) {
+    this->rows = 0;
+    this->cols = std::max(std::min(cols, (int)MAX_COLS), 0);
+  }
+  this->base = 0;
+  this->top_filled = this->rows;
+  this->hash = 0;
+  // Everything except the playable columns is wall
+  this->empty_row = ~(((uint64_t(1) << this->cols) - 1) << 1);
+  // Create an empty board
+  this->masks = vector<uint64_t>(this->rows, this->empty_row);
+  this->colors = vector<uint8_t>(this->rows * this->cols, 0);
+  this->surface = vector<int>(this->cols, this->rows);
+}
+
+/**
+ @return: true if a board of the given size fits: every row in one word with a
+ wall on either side, and no more rows than there are Zobrist keys for.
+*/
+bool Bitboard::fits(const int &rows, const int &cols) {
+  return rows >= 1 && rows <= Zobrist::MAX_ROWS && cols >= 1 && cols <= MAX_COLS;
+}
+
+/**
+ @return: how many rows the footprint can move straight down before it
+ collides. A piece that is above the surface of every column it covers lands
+ on the closest surface, so only its cells are looked at. One tucked under the
+ stack (or overlapping a wall) could be caught by an overhang the surface
+ doesn't show, and is followed down row by row instead.
+*/
+int Bitboard::dropDistance(const Footprint &f) const {
+  int distance = this->rows;
+  for (int i = 0; i < 4; i++) {
+    if (f.rows[i] & this->empty_row)
+      return this->scanDrop(f);
+
+    const int row = f.top + i;
+    for (uint64_t bits = f.rows[i]; bits; bits &= bits - 1) {
+      const int top = this->surface[__builtin_ctzll(bits) - 1];
+      if (top <= row)
+        return this->scanDrop(f);
+      distance = std::min(distance, top - row - 1);
+    }
+  }
+
+  return distance;
+}
+
+/**
+ Fills a cell with the given color id.
+*/
+void Bitboard::set(const int &row, const int &col, const uint8_t &color) {
+  const int i = this->index(row);
+  if (!(this->masks[i] & Bitboard::bit(col)))
+    this->hash ^= Zobrist::row(row, uint64_t(1) << col);
+  this->masks[i] |= Bitboard::bit(col);
+  this->colors[i * this->cols + col] = color;
+  this->top_filled = std::min(this->top_filled, row);
+  this->surface[col] = std::min(this->surface[col], row);
+}
+
+/**
+ Fills every cell covered by the footprint with the given color id.
+*/
+void Bitboard::place(const Footprint &f, const uint8_t &color) {
+  for (int i = 0; i < 4; i++) {
+    if (f.rows[i] == 0)
+      continue;
+
+    const int row = this->index(f.top + i);
+    this->hash ^= Zobrist::row(f.top + i, (f.rows[i] & ~this->masks[row]) >> 1);
+    this->masks[row] |= f.rows[i];
+    // Walk the set bits to fill in the color plane
+    for (uint64_t bits = f.rows[i]; bits; bits &= bits - 1)
+      this->colors[row * this->cols + __builtin_ctzll(bits) - 1] = color;
+    this->top_filled = std::min(this->top_filled, f.top + i);
+    this->raiseSurface(f.top + i, f.rows[i]);
+  }
+}
+
+/**
+ @return: true if every cell in the row is filled; false otherwise.
+*/
+bool Bitboard::isFull(const int &row) const {
+  return this->masks[this->index(row)] == ~uint64_t(0);
+}
+
+// A board has at most Zobrist::MAX_ROWS rows, so a row is always a bit of a
+// uint64_t mask
+static_assert(Zobrist::MAX_ROWS <= 64, "rows must fit in a 64-bit row mask");
+
+/**
+ Removes every full row between top and bottom (inclusive, at most 4 rows) in
+ one pass and drops the rows above them.
+
+ @param cleared - If given, gets the rows that were full, bit r for row r.
+ @return: the number of rows cleared.
+*/
+int Bitboard::clearFullRows(const int &top, const int &bottom, uint64_t *cleared) {
+  // Find the full rows. Bit i of full is row top + i.
+  const int first = std::max(top, 0);
+  const int last = std::min(bottom, this->rows - 1);
+  unsigned full = 0;
+  int count = 0, lowest = -1, highest = this->rows;
+  for (int row = first; row <= last; row++) {
+    if (this->isFull(row)) {
+      full |= 1u << (row - first);
+      count++;
+      lowest = row;
+      highest = std::min(highest, row);
+    }
+  }
+
+  if (cleared)
+    *cleared = uint64_t(full) << first;
+  if (count == 0)
+    return 0;
+
+  // Every row from the top of the stack down to the lowest cleared one changes,
+  // so take them out of the hash now and put the new ones back in after
+  for (int row = this->top_filled; row <= lowest; row++)
+    this->hash ^= this->rowHash(row);
+
+  // Rows that would have to move either way
+  const int above = lowest - this->top_filled + 1 - count;
+  const int below = this->rows - 1 - highest + 1 - count;
+
+  if (above <= below) {
+    // Compact the stack downward into the cleared rows
+    int write = lowest;
+    for (int row = lowest; row >= this->top_filled; row--) {
+      if (row <= last && row >= first && (full >> (row - first)) & 1)
+        continue;
+      if (write != row)
+        this->copyRow(row, write);
+      write--;
+    }
+    // Whatever is left at the top of the stack is now empty
+    for (; write >= this->top_filled; write--)
+      this->emptyRow(write);
+  } else {
+    // Compact the rows below upward, then rotate the ring so the stack above
+    // the cleared rows drops without being touched
+    int write = highest;
+    for (int row = highest; row < this->rows; row++) {
+      if (row <= last && (full >> (row - first)) & 1)
+        continue;
+      this->copyRow(row, write);
+      write++;
+    }
+    // The freed rows at the bottom become the empty rows at the top
+    for (; write < this->rows; write++)
+      this->emptyRow(write);
+    this->base = this->index(this->rows - count);
+  }
+
+  this->top_filled = std::min(this->top_filled + count, this->rows);
+  for (int row = this->top_filled; row <= lowest; row++)
+    this->hash ^= this->rowHash(row);
+
+  // Columns that top out above the cleared rows drop with the stack. The rest
+  // lost their top cell, or sit below it all, and are found again from the
+  // first cleared row down
+  uint64_t lost = 0;
+  for (int col = 0; col < this->cols; col++) {
+    if (this->surface[col] < highest)
+      this->surface[col] += count;
+    else
+      lost |= Bitboard::bit(col);
+  }
+  for (int row = highest; lost && row < this->rows; row++) {
+    for (uint64_t found = this->masks[this->index(row)] & lost; found; found &= found - 1)
+      this->surface[__builtin_ctzll(found) - 1] = row;
+    lost &= ~this->masks[this->index(row)];
+  }
+  for (; lost; lost &= lost - 1)
+    this->surface[__builtin_ctzll(lost) - 1] = this->rows;
+  return count;
+}
+
+/**
+ @return: true if the cell is filled; false otherwise.
+*/
+bool Bitboard::isOccupied(const int &row, const int &col) const {
+  return this->masks[this->index(row)] & Bitboard::bit(col);
+}
+
+/**
+ @return: the color id of the cell, 0 if it is empty.
+*/
+uint8_t Bitboard::getColor(const int &row, const int &col) const {
+  return this->colors[this->index(row) * this->cols + col];
+}
+
+/**
+ @return: the occupancy mask of a row, walls included.
+*/
+uint64_t Bitboard::getRow(const int &row) const {
+  return this->masks[this->index(row)];
+}
+
+/**
+ @return: the height of a column: the # of rows from the floor up to its
+ highest filled cell, 0 if it is empty.
+*/
+int Bitboard::getHeight(const int &col) const {
+  return this->rows - this->surface[col];
+}
+
+/**
+ @return: the bit for the given column in a row mask.
+*/
+uint64_t Bitboard::bit(const int &col) {
+  return uint64_t(1) << (col + 1);
+}
+
+/**
+ Empties the board without reallocating it.
+*/
+void Bitboard::clear() {
+  std::fill(this->masks.begin(), this->masks.end(), this->empty_row);
+  std::fill(this->colors.begin(), this->colors.end(), 0);
+  std::fill(this->surface.begin(), this->surface.end(), this->rows);
+  this->base = 0;
+  this->top_filled = this->rows;
+  this->hash = 0;
+}
+
+/**
+ Copies the whole board into a state. The ring is copied as it is, base
+ included, so nothing has to be rearranged either way.
+
+ @return: true if it fits in a <BitboardState>; false otherwise.
+*/
+bool Bitboard::save(BitboardState &state) const {
+  if (this->rows > BitboardState::MAX_ROWS || this->cols > BitboardState::MAX_COLS)
+    return false;
+
+  memcpy(state.masks, this->masks.data(), this->rows * sizeof(uint64_t));
+  memcpy(state.colors, this->colors.data(), this->rows * this->cols);
+  state.hash = this->hash;
+  state.rows = (int16_t)this->rows;
+  state.cols = (int16_t)this->cols;
+  state.base = (int16_t)this->base;
+  state.top_filled = (int16_t)this->top_filled;
+  for (int col = 0; col < this->cols; col++)
+    state.surface[col] = (int8_t)this->surface[col];
+  return true;
+}
+
+/**
+ Puts the board back in a saved state. Only allocates if the state has
+ different dimensions.
+*/
+void Bitboard::load(const BitboardState &state) {
+  if (state.rows != this->rows || state.cols != this->cols)
+    *this = Bitboard(state.rows, state.cols);
+
+  memcpy(this->masks.data(), state.masks, this->rows * sizeof(uint64_t));
+  memcpy(this->colors.data(), state.colors, this->rows * this->cols);
+  this->hash = state.hash;
+  this->base = state.base;
+  this->top_filled = state.top_filled;
+  for (int col = 0; col < this->cols; col++)
+    this->surface[col] = state.surface[col];
+}
+
+/**
+ @return: the Zobrist hash of the filled cells.
+*/
+uint64_t Bitboard::getHash() const {
+  return this->hash;
+}
+
+// Gets the number of rows
+int Bitboard::getRows() const {
+  return this->rows;
+}
+
+// Gets the number of cols
+int Bitboard::getCols() const {
+  return this->cols;
+}
+
+// --- END PUBLIC ---
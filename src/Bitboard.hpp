@@ -0,0 +1,273 @@
+//
+//  Bitboard.hpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/9/21.
+//
+
+#ifndef Bitboard_hpp
+#define Bitboard_hpp
+
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+
+/**
+ The cells covered by a piece, stored as one row mask per row it spans. Uses the
+ same bit layout as <Bitboard> so it can be tested against the board directly.
+*/
+struct Footprint {
+  /**
+   The board row that rows[0] lines up with.
+  */
+  int top;
+  /**
+   Row masks from top to bottom. Unused rows are 0.
+  */
+  uint64_t rows[4];
+};
+
+/**
+ Everything in a <Bitboard>, as plain data that can be memcpy'd. Holds boards
+ up to TALL_ROWS by 16 cols; only the first rows * cols colors are used.
+*/
+struct BitboardState {
+  static const int MAX_ROWS = 40;
+  static const int MAX_COLS = 16;
+  uint64_t masks[MAX_ROWS];
+  uint8_t colors[MAX_ROWS * MAX_COLS];
+  uint64_t hash;
+  int16_t rows;
+  int16_t cols;
+  int16_t base;
+  int16_t top_filled;
+  int8_t surface[MAX_COLS];
+};
+
+class Bitboard {
+private:
+  /**
+   Occupancy of the board, one word per row. Column c is stored at bit c + 1.
+   Bit 0 and every bit past the last column are walls, so a piece that moves off
+   either side of the board collides without an explicit bounds check.
+   Stored as a ring: row r lives at index (base + r) % rows.
+  */
+  vector<uint64_t> masks;
+  /**
+   Color plane used for rendering. Holds one id per cell, 0 = empty. Rows are
+   contiguous and use the same ring indexing as masks.
+  */
+  vector<uint8_t> colors;
+  /**
+   # of rows and cols on the board
+  */
+  int rows;
+  int cols;
+  /**
+   Index of row 0 in the ring.
+  */
+  int base;
+  /**
+   Every row above this one is empty.
+  */
+  int top_filled;
+  /**
+   The highest filled row in each column, rows if the column is empty. Kept up
+   to date by every change so a drop can be measured without walking the rows.
+  */
+  vector<int> surface;
+  /**
+   A row with nothing in it but the walls.
+  */
+  uint64_t empty_row;
+  /**
+   Zobrist hash of the filled cells, kept up to date by every change.
+  */
+  uint64_t hash;
+
+  /**
+   @return: the Zobrist key of a row's filled cells.
+  */
+  uint64_t rowHash(const int &row) const;
+
+  /**
+   @return: the index of a board row in the ring.
+  */
+  int index(const int &row) const;
+
+  /**
+   Copies one board row over another, masks and colors.
+  */
+  void copyRow(const int &from, const int &to);
+
+  /**
+   Empties a board row.
+  */
+  void emptyRow(const int &row);
+
+  /**
+   Raises the surface of every column the row mask fills up to that row, if it
+   isn't that high already.
+  */
+  void raiseSurface(const int &row, const uint64_t &mask);
+
+  /**
+   Follows each row of the footprint down until it hits something.
+
+   @return: how many rows the footprint can move straight down.
+  */
+  int scanDrop(const Footprint &f) const;
+
+public:
+  /**
+   Most cols a row word holds with a wall on either side.
+  */
+  static const int MAX_COLS = 62;
+
+  /**
+   Public constructor. cols must be at most MAX_COLS so the walls fit in the
+   word, and rows at most Zobrist::MAX_ROWS. A size that doesn't fit gets a
+   board with no rows; use <WideBoard> for wider boards.
+  */
+  Bitboard(const int &rows, const int &cols);
+
+  /**
+   @return: true if a board of the given size fits; false otherwise.
+  */
+  static bool fits(const int &rows, const int &cols);
+
+  /**
+   Checks if the footprint, moved by (dx, dy), overlaps a filled cell, a wall,
+   the floor, or the area above the board.
+
+   @return: true if it collides; false if the piece fits.
+  */
+  bool collides(const Footprint &f, const int &dx = 0, const int &dy = 0) const;
+
+  /**
+   @return: how many rows the footprint can move straight down before it
+   collides. Constant time unless the piece is tucked under the stack.
+  */
+  int dropDistance(const Footprint &f) const;
+
+  /**
+   Fills a cell with the given color id.
+  */
+  void set(const int &row, const int &col, const uint8_t &color);
+
+  /**
+   Fills every cell covered by the footprint with the given color id.
+  */
+  void place(const Footprint &f, const uint8_t &color);
+
+  /**
+   @return: true if every cell in the row is filled; false otherwise.
+  */
+  bool isFull(const int &row) const;
+
+  /**
+   Removes every full row between top and bottom (inclusive, at most 4 rows) in
+   one pass and drops the rows above them. Moves whichever side of the cleared
+   rows is smaller: the stack above them, or the rows below them by rotating
+   the ring.
+
+   @param cleared - If given, gets the rows that were full, bit r for row r
+   as it was before the clear.
+   @return: the number of rows cleared.
+  */
+  int clearFullRows(const int &top, const int &bottom, uint64_t *cleared = nullptr);
+
+  /**
+   @return: true if the cell is filled; false otherwise.
+  */
+  bool isOccupied(const int &row, const int &col) const;
+
+  /**
+   @return: the color id of the cell, 0 if it is empty.
+  */
+  uint8_t getColor(const int &row, const int &col) const;
+
+  /**
+   @return: the occupancy mask of a row, walls included.
+  */
+  uint64_t getRow(const int &row) const;
+
+  /**
+   @return: the height of a column: the # of rows from the floor up to its
+   highest filled cell, 0 if it is empty.
+  */
+  int getHeight(const int &col) const;
+
+  /**
+   @return: the bit for the given column in a row mask.
+  */
+  static uint64_t bit(const int &col);
+
+  /**
+   Empties the board without reallocating it.
+  */
+  void clear();
+
+  /**
+   Copies the whole board into a state, ring layout and all.
+
+   @return: true if it fits in a <BitboardState>; false otherwise.
+  */
+  bool save(BitboardState &state) const;
+
+  /**
+   Puts the board back in a saved state. Only allocates if the state has
+   different dimensions.
+  */
+  void load(const BitboardState &state);
+
+  /**
+   @return: the Zobrist hash of the filled cells. Boards with the same cells
+   filled have the same hash, whatever the colors.
+  */
+  uint64_t getHash() const;
+
+  // Getters
+  int getRows() const;
+  int getCols() const;
+};
+
+// The collision test runs for every move the game or a search tries, so it and
+// the ring lookup it uses are defined here where they can be inlined.
+
+/**
+ @return: the index of a board row in the ring.
+*/
+inline int Bitboard::index(const int &row) const {
+  const int i = this->base + row;
+  return i < this->rows ? i : i - this->rows;
+}
+
+/**
+ Checks if the footprint, moved by (dx, dy), overlaps a filled cell, a wall,
+ the floor, or the area above the board. dx is expected to be -1, 0 or 1.
+
+ @return: true if it collides; false if the piece fits.
+*/
+inline bool Bitboard::collides(const Footprint &f, const int &dx, const int &dy) const {
+  for (int i = 0; i < 4; i++) {
+    // Skip the rows the piece doesn't cover
+    if (f.rows[i] == 0)
+      continue;
+
+    // Rows off the top or bottom of the board are always blocked
+    const int row = f.top + dy + i;
+    if (row < 0 || row >= this->rows)
+      return true;
+
+    // Shift the piece sideways and test it against the row (walls included)
+    const uint64_t shifted = dx >= 0 ? f.rows[i] << dx : f.rows[i] >> -dx;
+    if (this->masks[this->index(row)] & shifted)
+      return true;
+  }
+
+  return false;
+}
+
+#endif /* Bitboard_hpp */
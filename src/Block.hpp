@@ -8,7 +8,7 @@
 #ifndef Block_hpp
 #define Block_hpp
 
-#include "raylib.h"
+#include <cstdint>
 #include <algorithm>
 #include <vector>
 #include <iostream>
@@ -16,39 +16,35 @@
 using std::vector;
 using std::cout; using std::endl;
 
+/**
+ A cell on the board. x is the column, y is the row (0 is the top).
+*/
+struct Point {
+  int x;
+  int y;
+};
+
 class Block {
 private:
   // Coords of the box
-  Vector2 coords;
-  // Color of the box
-  Color color;
+  Point coords;
+  // Color id of the box, 0 = empty
+  uint8_t color;
   
 public:
   // Public constructor
-  Block(const Vector2 &coords = { -1, -1 }, const Color &color = BLANK);
+  Block(const Point &coords = { -1, -1 }, const uint8_t &color = 0);
   
   // Copy assignment
   Block& operator=(const Block &rhs);
   
-  // Translations
-  bool left(const vector<vector<Block>> &board);
-  bool right(const vector<vector<Block>> &board);
-  bool down(const vector<vector<Block>> &board);
-  
-  // Rotations
-  bool rotateCW(const Block &b, const vector<vector<Block>> &board);
-  bool rotateCCW(const Block &b, const vector<vector<Block>> &board);
-  
   // Getters
-  const Vector2& getCoords() const;
-  const Color& getColor() const;
+  const Point& getCoords() const;
+  const uint8_t& getColor() const;
   
   // Setters
-  void setCoords(const Vector2 &coords);
-  void setColor(const Color &color);
-  
-  // Draw
-  void draw() const;
+  void setCoords(const Point &coords);
+  void setColor(const uint8_t &color);
 };
 
 #endif /* Block_hpp */
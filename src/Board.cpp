@@ -5,196 +5,328 @@
 //  Created by Andy Mina on 5/4/21.
 //
 
+#include <algorithm>
+#include <type_traits>
 #include "Board.hpp"
+#include "Trace.hpp"
+#include "Zobrist.hpp"
+
+static_assert(std::is_trivially_copyable<BoardState>::value,
+              "BoardState must stay plain data so it can be memcpy'd");
 
 // --- BEGIN PRIVATE ---
 
 /**
- Locks the active piece onto the board and generates a new one.
+ Locks the active piece onto the board and clears any rows it completed.
 */
-void Board::lockPiece() {
+template <class Stack>
+void BasicBoard<Stack>::lockPiece() {
+  TRACE_SCOPE("lockPiece");
   // Lock the active piece
-  for (Block &b : this->active->getBlocks()) {
-    // Grab the coords of the current block
-    const Vector2 &coords = b.getCoords();
-    // Grab the target block in the board
-    Block &target = this->board[coords.y][coords.x];
-    // Update the coords of the target block
-    target.setCoords(coords);
-    target.setColor(b.getColor());
-    
-    // Clear the row of new block if necessary
-    this->checkRow(coords.y);
-  }
+  this->active.place(this->board);
+
+  // Only the rows the piece covers can have been completed
+  const int top = this->active.getFootprint().top;
+  this->clearRows(top, top + 3);
+  this->pieces++;
 }
 
 /**
- Sets a new random piece as the active piece and deletes the old one.
+ Sets a new random piece as the active piece.
 */
-void Board::newPiece() {
-  // Delete active
-  delete this->active;
+template <class Stack>
+void BasicBoard<Stack>::newPiece() {
+  TRACE_SCOPE("spawn");
   // Get new piece
-  this->active = new Piece(this->board, PIECE_TYPE(rng(generator)));
+  this->active = BasicPiece<Stack>(PIECE_TYPE(rng(generator)), this->rows, this->cols);
+  // The game is over if there is no room for it
+  if (this->active.collides(this->board))
+    this->over = true;
 }
 
 /**
- If the given row is filled, it will be cleared.
- @returns - True if the row was cleared; false otherwise
+ Clears every full row between top and bottom in one pass and scores them.
+ @returns - The number of rows cleared.
 */
-bool Board::checkRow(const int &row_index) {
-  // Get the row
-  vector<Block> &row = this->board[row_index];
-  
-  // Loop through the row
-  for (Block &b : row) {
-    // Get the coords of this block
-    const Vector2 &coords = b.getCoords();
-    
-    // If this block is not empty
-    if (coords.x == -1 || coords.y == -1)
-      return false;
-  }
-  
-  // Clear the row
-  this->clearRow(row_index);
-  // Update the board
-  this->updateBoard();
-  return true;
+template <class Stack>
+int BasicBoard<Stack>::clearRows(const int &top, const int &bottom) {
+  // Points for clearing 0-4 rows at once
+  static const int POINTS[5] = { 0, 40, 100, 300, 1200 };
+  TRACE_SCOPE("clearRows");
+
+  // Remember which rows go, for anything mirroring the stack row by row
+  const int count = this->board.clearFullRows(top, bottom, &this->cleared);
+  this->lines += count;
+  this->score += POINTS[count];
+  return count;
 }
 
 /**
- Clears the given row.
+ Applies one tick of gravity to the active piece.
 */
-void Board::clearRow(const int &row_index) {
-  // Delete this row from the board
-  this->board.erase(this->board.begin() + row_index);
-  // Create a new empty row and insert at top
-  this->board.insert(this->board.begin(), vector<Block>(this->cols));
+template <class Stack>
+void BasicBoard<Stack>::fall() {
+  // Gravity builds up a fraction of a row per tick. Drop the whole rows.
+  this->gravity_progress += this->gravity;
+  const int rows = (int)this->gravity_progress;
+  this->gravity_progress -= rows;
+
+  // Count the ticks the piece spends resting on the stack. Either way it takes
+  // one drop-distance query, however many rows gravity moves it.
+  const bool resting = rows > 0 ? this->active.fall(this->board, rows) == 0
+                                : this->active.dropDistance(this->board) == 0;
+  if (resting)
+    this->lock_ticks++;
+
+  // Determine if the piece has rested long enough
+  if (this->lock_ticks >= LOCK_DELAY) {
+    // Lock the piece
+    this->lockPiece();
+    // Set a new piece
+    this->newPiece();
+    // Reset counters
+    this->lock_ticks = 0;
+    this->gravity_progress = 0;
+  }
+}
+
+// --- END PRIVATE ---
+
+// --- BEGIN PUBLIC ---
+
+/**
+ Public constructor that creates a board.
+
+ @param rows - The number of rows on the board. Defaults to Global::ROWS
+ @param cols - The number of cols on the board. Defaults to Global::COLS
+ @param gravity - Rows the piece falls per tick.
+ @param seed - Seed for the piece generator.
+ */
+template <class Stack>
+BasicBoard<Stack>::BasicBoard(const int &rows, const int &cols, const double &gravity,
+                              const unsigned &seed): board(rows, cols) {
+  // Take the size from the board, which turns down sizes it can't hold
+  this->rows = this->board.getRows();
+  this->cols = this->board.getCols();
+
+  // Set up RNG
+  this->rng = uniform_int_distribution<int>(0, 6);
+  // Set gravity
+  this->gravity = gravity;
+  // Seed the generator, set the counters and spawn the first piece
+  this->reset(seed);
 }
 
 /**
- Updates all of the blocks in the board to render at the correct position
- starting from the bottom.
+ Applies one action to the game. TICK is one tick of the simulation clock.
+
+ @return: true if the action changed the state; false otherwise.
 */
-void Board::updateBoard() {
-  // Iterate backwards through the vector (bottom up)
-  for (int i = this->board.size() - 1; i >= 0; i--) {
-    // Iterate forwards through each row (left to right)
-    for (int j = 0; j < this->board[i].size(); j++) {
-      // Get the coords of this block
-      const Vector2 &coords = this->board[i][j].getCoords();
-      // Check if the block needs to be updated
-      if (coords.x != -1 && coords.y != - 1) {
-        // Create new coords
-        Vector2 target;
-        target.x = j;
-        target.y = i;
-        // Set the new coords
-        this->board[i][j].setCoords(target);
-      }
-    }
+template <class Stack>
+bool BasicBoard<Stack>::step(const ACTION &action) {
+  // Nothing moves once the game is over
+  if (this->over)
+    return false;
+
+  switch (action) {
+    case MOVE_LEFT:
+      return this->active.left(this->board);
+    case MOVE_RIGHT:
+      return this->active.right(this->board);
+    case MOVE_DOWN:
+      return this->active.down(this->board);
+    case ROTATE_CW:
+      return this->active.rotateClockwise(this->board);
+    case ROTATE_CCW:
+      return this->active.rotateCounterClockwise(this->board);
+    case HARD_DROP:
+      // Drop as far as possible, then lock immediately
+      this->active.fall(this->board, this->rows);
+      this->lockPiece();
+      this->newPiece();
+      this->lock_ticks = 0;
+      this->gravity_progress = 0;
+      return true;
+    case TICK:
+      this->fall();
+      return true;
   }
+
+  return false;
+}
+
+/**
+ Starts a new game on the same board with a new seed, keeping the size and
+ gravity. Doesn't allocate, so games can be restarted in a hot loop.
+*/
+template <class Stack>
+void BasicBoard<Stack>::reset(const unsigned &seed) {
+  this->board.clear();
+
+  this->seed = seed;
+  this->generator = default_random_engine(seed);
+  this->rng.reset();
+
+  this->gravity_progress = 0;
+  this->lock_ticks = 0;
+  this->over = false;
+  this->pieces = 0;
+  this->lines = 0;
+  this->score = 0;
+  this->cleared = 0;
+  this->newPiece();
+}
+
+// Gets the occupancy of the board
+template <class Stack>
+const Stack& BasicBoard<Stack>::getBitboard() const {
+  return this->board;
+}
+
+// Gets the active piece
+template <class Stack>
+const BasicPiece<Stack>& BasicBoard<Stack>::getActive() const {
+  return this->active;
+}
+
+// Gets the gravity in rows per tick
+template <class Stack>
+double BasicBoard<Stack>::getGravity() const {
+  return this->gravity;
+}
+
+// Checks if the game is over
+template <class Stack>
+bool BasicBoard<Stack>::isOver() const {
+  return this->over;
+}
+
+// Gets the seed of the piece generator
+template <class Stack>
+unsigned BasicBoard<Stack>::getSeed() const {
+  return this->seed;
 }
 
 /**
- Draws all of the blocks on the screen.
+ @return: the types of the next count pieces, in the order they will spawn.
+ The generator and distribution are copied and drawn from exactly as spawning
+ does, so the preview always matches what comes.
 */
-void Board::drawBlocks() {
-  // Draw all of the blocks
-  for (int i = 0; i < this->rows; i++)
-    for (int j = 0; j < this->cols; j++)
-      if (this->board[i][j].getCoords().x != -1) // dont draw the empty blocks
-        this->board[i][j].draw();
+template <class Stack>
+vector<PIECE_TYPE> BasicBoard<Stack>::getPreview(const int &count) const {
+  vector<PIECE_TYPE> preview(count);
+  this->getPreview(preview.data(), count);
+  return preview;
 }
 
 /**
- Draws the grid overlay.
+ Fills out with the types of the next count pieces, drawn from copies of the
+ generator and distribution as above. Doesn't allocate, so it can be called on
+ the decision path.
 */
-void Board::drawGrid() {
-  // Draw rows
-  for (int i = 0; i < this->rows; i++)
-    DrawLine(0, i * BLOCK_SIZE, WINDOW_WIDTH, i * BLOCK_SIZE, WHITE);
-  
-  // Draw columns
-  for (int i = 0; i < this->cols; i++)
-    DrawLine(i * BLOCK_SIZE, 0, i * BLOCK_SIZE, WINDOW_HEIGHT, WHITE);
+template <class Stack>
+void BasicBoard<Stack>::getPreview(PIECE_TYPE *out, const int &count) const {
+  default_random_engine generator = this->generator;
+  uniform_int_distribution<int> rng = this->rng;
+  for (int i = 0; i < count; i++)
+    out[i] = PIECE_TYPE(rng(generator));
 }
 
-// --- END PRIVATE ---
+// Gets the number of pieces locked
+template <class Stack>
+int BasicBoard<Stack>::getPieces() const {
+  return this->pieces;
+}
 
-// --- BEGIN PUBLIC ---
+// Gets the number of lines cleared
+template <class Stack>
+int BasicBoard<Stack>::getLines() const {
+  return this->lines;
+}
+
+// Gets the score
+template <class Stack>
+int BasicBoard<Stack>::getScore() const {
+  return this->score;
+}
+
+/**
+ @return: the rows the last piece to lock cleared, bit r for row r as it was
+ just before the clear.
+*/
+template <class Stack>
+uint64_t BasicBoard<Stack>::getCleared() const {
+  return this->cleared;
+}
 
 /**
  Public constructor that creates a board.
- 
+
  @param rows - The number of rows on the board. Defaults to Global::ROWS
  @param cols - The number of cols on the board. Defaults to Global::COLS
+ @param gravity - Rows the piece falls per tick.
+ @param seed - Seed for the piece generator.
  */
-Board::Board(const int &rows, const int &cols, const int &fall_speed) {
-  // Set rows and cols
-  this->rows = rows;
-  this->cols = cols;
-  // Create a board
-  vector<vector<Block>> board(this->rows, vector<Block>(this->cols));
-  // Move the existing board into the data member
-  this->board = std::move(board);
-  
-  // Seed the generator
-  this->generator = default_random_engine((int)time(nullptr));
-  // Set up RNG
-  this->rng = uniform_int_distribution<int>(0, 6);
-  // Create a new piece of random type
-  this->active = new Piece(this->board, PIECE_TYPE(rng(generator)));
-  
-  // Set fall speed
-  this->fall_speed = fall_speed;
-  // Set failed fall counter
-  this->failed_falls = 0;
+Board::Board(const int &rows, const int &cols, const double &gravity,
+             const unsigned &seed): BasicBoard<Bitboard>(rows, cols, gravity, seed) {
 }
 
 /**
- Allows the piece to be updated by user input. User can use LEFT to move left,
- RIGHT to move right, DOWN to move down, Z to rotate counter-clockwise, and
- X or UP to rotate clockwise.
- */
-void Board::update() {
-  // Update the active piece
-  this->active->update();
+ Takes a snapshot of the whole game.
+
+ @return: true if the board fits in a <BoardState>; false otherwise.
+*/
+bool Board::save(BoardState &state) const {
+  if (!this->board.save(state.board))
+    return false;
+
+  state.active = this->active;
+  state.gravity = this->gravity;
+  state.gravity_progress = this->gravity_progress;
+  state.lock_ticks = this->lock_ticks;
+  state.over = this->over;
+  state.pieces = this->pieces;
+  state.lines = this->lines;
+  state.score = this->score;
+  state.seed = this->seed;
+  state.generator = this->generator;
+  state.rng = this->rng;
+  return true;
 }
 
 /**
- Increases the fall speed by 1 block per second (bps).
+ Puts the game back exactly as it was when the snapshot was taken, including
+ the pieces still to come.
 */
-void Board::fall(int &frames) {
-  // Calculate if the block shouldve fallen already
-  if (frames >= FPS / this->fall_speed) {
-    // Reset frame counter
-    frames = 0;
-    
-    // Drop the piece and increment failed falls if needed
-    if (!this->active->fall())
-      this->failed_falls++;
-    
-    // Determine if the piece failed to fall more than 3 times
-    if (this->failed_falls > 3) {
-      // Lock the piece
-      this->lockPiece();
-      // Set a new piece
-      this->newPiece();
-      // Reset counter
-      this->failed_falls = 0;
-    }
-  }
+void Board::restore(const BoardState &state) {
+  this->board.load(state.board);
+  this->rows = state.board.rows;
+  this->cols = state.board.cols;
+
+  this->active = state.active;
+  this->gravity = state.gravity;
+  this->gravity_progress = state.gravity_progress;
+  this->lock_ticks = state.lock_ticks;
+  this->over = state.over;
+  this->pieces = state.pieces;
+  this->lines = state.lines;
+  this->score = state.score;
+  this->seed = state.seed;
+  this->generator = state.generator;
+  this->rng = state.rng;
+  this->cleared = 0;
 }
 
 /**
- Draws the board, grid, and active piece.
+ @return: the Zobrist hash of the position: the filled cells plus the type and
+ orientation of the active piece.
 */
-void Board::draw() {
-  this->drawBlocks();
-  this->active->draw();
-  this->drawGrid();
+uint64_t Board::getHash() const {
+  return this->board.getHash() ^
+         Zobrist::piece(this->active.getType(), this->active.getRotation());
 }
 
 // --- END PUBLIC ---
+
+template class BasicBoard<Bitboard>;
+template class BasicBoard<WideBitboard>;
@@ -12,38 +12,104 @@
 #include <utility>
 #include <random>
 #include <time.h>
-#include "raylib.h"
 #include "Global.hpp"
 #include "Block.hpp"
+#include "Bitboard.hpp"
 #include "Piece.hpp"
+#include "WideBitboard.hpp"
 
 using std::vector;
 using std::default_random_engine;
 using std::uniform_int_distribution;
 
-class Board {
-private:
+// Enums to define the inputs the board understands
+enum ACTION {
+  MOVE_LEFT, MOVE_RIGHT, MOVE_DOWN,
+  ROTATE_CW, ROTATE_CCW,
+  HARD_DROP,
+  TICK
+};
+
+/**
+ A full game snapshot as plain data: the stack, the active piece, gravity and
+ lock progress, the counters and the piece generator mid-sequence. Taking or
+ restoring one is a couple of memcpys, so it is cheap enough for undo,
+ rollback and search. It can be copied freely, but the active piece holds a
+ function pointer, so it is only good in the process that made it.
+*/
+struct BoardState {
+  BitboardState board;
+  Piece active;
+  double gravity;
+  double gravity_progress;
+  int lock_ticks;
+  bool over;
+  int pieces;
+  int lines;
+  int score;
+  unsigned seed;
+  default_random_engine generator;
+  uniform_int_distribution<int> rng;
+};
+
+/**
+ The game itself. Has no dependency on raylib, input, or the frame rate: it is
+ advanced one <ACTION> at a time, as fast as the caller feeds it. The windowed
+ game in main.cpp is one front end over it.
+
+ The rules live here once, whatever holds the stack: Stack is the row store,
+ a <Bitboard> for <Board> or a <WideBitboard> for <WideBoard>, so on a board
+ both can hold the two play out the same game for a seed.
+*/
+template <class Stack>
+class BasicBoard {
+protected:
+  /**
+   Stores which cells on the board are filled, and their colors if Stack
+   keeps them
+  */
+  Stack board;
   /**
-   Stores the blocks on the board
+   The active piece. Stored by value, so spawning never allocates.
   */
-  vector<vector<Block>> board;
+  BasicPiece<Stack> active;
   /**
-   The active piece.
+   Gravity in rows per tick. Can be a fraction of a row (1/60 is one row per
+   second at 60 ticks per second) or many rows (20 drops straight to the floor).
   */
-  Piece* active;
+  double gravity;
   /**
-   Fall speed of the active piece.
+   The part of a row gravity has built up but not yet dropped.
   */
-  int fall_speed;
+  double gravity_progress;
   /**
-   Keeps track of how many times the piece has failed to fall.
+   Keeps track of how many ticks the piece has spent resting on the stack.
   */
-  int failed_falls;
+  int lock_ticks;
   /**
    # of rows and cols on the board
   */
   int rows;
   int cols;
+  /**
+   Set once a new piece can't be placed.
+  */
+  bool over;
+  /**
+   # of pieces locked, lines cleared and points scored so far.
+  */
+  int pieces;
+  int lines;
+  int score;
+  /**
+   Rows the last piece to lock cleared, bit r for row r as it was before the
+   clear. Not part of a snapshot: it only describes the last lock.
+  */
+  uint64_t cleared;
+  /**
+   Seed the generator started from.
+  */
+  unsigned seed;
   /**
    Generator for random numbers
   */
@@ -52,66 +118,138 @@ private:
    Define distribution for random numbers.
   */
   uniform_int_distribution<int> rng;
-  
+
   /**
    Locks the active piece onto the board.
   */
   void lockPiece();
-  
+
   /**
-   Sets a new random piece as the active piece and deletes the old one.
+   Sets a new random piece as the active piece.
   */
   void newPiece();
-  
-  /**
-   If the row is fill, it will be cleared.
-   @returns - True if the row was cleared; false otherwise.
-  */
-  bool checkRow(const int &row_index);
-  
-  void clearRow(const int &row_index);
-  
-  void updateBoard();
-  
+
   /**
-   Draws all of the blocks on the screen.
+   Clears every full row between top and bottom in one pass and scores them.
+   @returns - The number of rows cleared.
   */
-  void drawBlocks();
-  
+  int clearRows(const int &top, const int &bottom);
+
   /**
-   Draws the grid overlay.
+   Applies one tick of gravity to the active piece, locking it once it has
+   rested on the stack for LOCK_DELAY ticks.
   */
-  void drawGrid();
+  void fall();
 
-  
 public:
+  // Ticks a piece can rest on the stack before it locks
+  static const int LOCK_DELAY = 30;
+
   /**
    Public constructor that creates a board.
-   
+
    @param rows - The number of rows on the board. Defaults to Global::ROWS
    @param cols - The number of cols on the board. Defaults to Global::COLS
-   @param fall_speed - The fall speed of the blocks to be generated. Defaults to 1 bps.
+   @param gravity - Rows the piece falls per tick. Defaults to one row per second.
+   @param seed - Seed for the piece generator. Defaults to the current time.
    */
-  Board(const int &rows = ROWS, const int &cols = COLS, const int &fall_speed = 1);
-  
+  BasicBoard(const int &rows = ROWS, const int &cols = COLS,
+             const double &gravity = 1.0 / TICK_RATE,
+             const unsigned &seed = (unsigned)time(nullptr));
+
   /**
-   Allows the piece to be updated by user input. User can use LEFT to move left,
-   RIGHT to move right, DOWN to move down, Z to rotate counter-clockwise, and
-   X or UP to rotate clockwise.
+   Applies one action to the game. TICK is one tick of the simulation clock.
+
+   @return: true if the action changed the state; false otherwise.
+  */
+  bool step(const ACTION &action);
+
+  /**
+   Starts a new game on the same board with a new seed. Doesn't allocate.
+  */
+  void reset(const unsigned &seed);
+
+  // Getters
+  const Stack& getBitboard() const;
+  const BasicPiece<Stack>& getActive() const;
+  double getGravity() const;
+  bool isOver() const;
+  unsigned getSeed() const;
+
+  /**
+   @return: the types of the next count pieces, in the order they will spawn.
+   Drawn from a copy of the generator, so the game itself is untouched.
+  */
+  vector<PIECE_TYPE> getPreview(const int &count) const;
+
+  /**
+   Fills out with the types of the next count pieces, as above, without
+   allocating. out must hold at least count entries.
+  */
+  void getPreview(PIECE_TYPE *out, const int &count) const;
+
+  int getPieces() const;
+  int getLines() const;
+  int getScore() const;
+
+  /**
+   @return: the rows the last piece to lock cleared, bit r for row r as it was
+   just before the clear; 0 if it cleared none, or if the game was reset or
+   restored since.
+  */
+  uint64_t getCleared() const;
+};
+
+/**
+ The game on a <Bitboard>, which holds up to Bitboard::MAX_COLS cols. Adds
+ colors, hashing and snapshots on top of the rules.
+*/
+class Board : public BasicBoard<Bitboard> {
+private:
+  // Replays save and restore the whole state
+  friend class ReplayWriter;
+  friend class ReplayReader;
+
+public:
+  /**
+   Public constructor that creates a board. A size a <Bitboard> can't hold
+   gets a board with no rows, so the game is over from the start; use
+   <WideBoard> for boards wider than Bitboard::MAX_COLS.
+
+   @param rows - The number of rows on the board. Defaults to Global::ROWS
+   @param cols - The number of cols on the board. Defaults to Global::COLS
+   @param gravity - Rows the piece falls per tick. Defaults to one row per second.
+   @param seed - Seed for the piece generator. Defaults to the current time.
    */
-  void update();
-  
+  Board(const int &rows = ROWS, const int &cols = COLS,
+        const double &gravity = 1.0 / TICK_RATE,
+        const unsigned &seed = (unsigned)time(nullptr));
 
-  
   /**
-   Drops the current piece by fall_speed to simulate gravity.
+   Takes a snapshot of the whole game.
+
+   @return: true if the board fits in a <BoardState>; false otherwise.
   */
-  void fall(int &frames);
-    
+  bool save(BoardState &state) const;
+
   /**
-   Draws the board.
+   Puts the game back exactly as it was when the snapshot was taken, including
+   the pieces still to come.
   */
-  void draw();
+  void restore(const BoardState &state);
+
+  /**
+   @return: the Zobrist hash of the position: the filled cells plus the type
+   and orientation of the active piece.
+  */
+  uint64_t getHash() const;
 };
 
+/**
+ The game on a board too wide for a <Bitboard>, for the large-board stress and
+ variant modes. Any number of cols works. The stack is a <WideBitboard>, so
+ there are no colors, no hash and no snapshots.
+*/
+typedef BasicBoard<WideBitboard> WideBoard;
+
 #endif /* Board_hpp */
@@ -0,0 +1,64 @@
+//
+//  Clock.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/18/21.
+//
+
+#include "Clock.hpp"
+
+/**
+ Public constructor.
+
+ @param rate - Ticks per second.
+ @param max_ticks - Most ticks to run in one frame.
+*/
+Clock::Clock(const int &rate, const int &max_ticks) {
+  this->step = 1.0 / rate;
+  this->accumulator = 0;
+  this->last = -1;
+  this->max_ticks = max_ticks;
+}
+
+/**
+ Moves the clock to the given time, in seconds.
+
+ @return: the number of ticks to simulate.
+*/
+int Clock::advance(const double &now) {
+  // The first call only starts the clock
+  if (this->last >= 0 && now > this->last)
+    this->accumulator += now - this->last;
+  this->last = now;
+
+  int ticks = 0;
+  while (this->accumulator >= this->step && ticks < this->max_ticks) {
+    this->accumulator -= this->step;
+    ticks++;
+  }
+
+  // Drop whatever backlog is left after the cap
+  if (ticks == this->max_ticks && this->accumulator >= this->step)
+    this->accumulator = 0;
+
+  return ticks;
+}
+
+/**
+ @return: how far the clock is into the next tick, from 0 to 1.
+*/
+double Clock::getAlpha() const {
+  return this->accumulator / this->step;
+}
+
+/**
+ @return: the time the simulation has reached.
+*/
+double Clock::getTime() const {
+  return this->last - this->accumulator;
+}
+
+// Gets the seconds per tick
+double Clock::getStep() const {
+  return this->step;
+}
@@ -0,0 +1,70 @@
+//
+//  Clock.hpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/18/21.
+//
+
+#ifndef Clock_hpp
+#define Clock_hpp
+
+#include "Global.hpp"
+
+/**
+ A fixed-timestep simulation clock. The game runs at TICK_RATE ticks per
+ second no matter how fast frames are drawn: each frame the caller passes the
+ current time, and the clock says how many ticks are due. Time that doesn't
+ add up to a whole tick is carried over to the next frame.
+*/
+class Clock {
+private:
+  /**
+   Seconds per tick.
+  */
+  double step;
+  /**
+   Time that has passed but not been simulated yet.
+  */
+  double accumulator;
+  /**
+   The time passed to the last advance(), or a negative value before the first.
+  */
+  double last;
+  /**
+   Most ticks a single advance() will ask for. After a long stall (a debugger,
+   a dragged window) the clock drops the backlog instead of trying to catch up.
+  */
+  int max_ticks;
+
+public:
+  /**
+   Public constructor.
+
+   @param rate - Ticks per second. Defaults to Global::TICK_RATE
+   @param max_ticks - Most ticks to run in one frame.
+  */
+  Clock(const int &rate = TICK_RATE, const int &max_ticks = 8);
+
+  /**
+   Moves the clock to the given time, in seconds.
+
+   @return: the number of ticks to simulate.
+  */
+  int advance(const double &now);
+
+  /**
+   @return: how far the clock is into the next tick, from 0 to 1.
+  */
+  double getAlpha() const;
+
+  /**
+   @return: the time the simulation has reached: the time of the last tick
+   advance() asked for.
+  */
+  double getTime() const;
+
+  // Gets the seconds per tick
+  double getStep() const;
+};
+
+#endif /* Clock_hpp */
@@ -0,0 +1,180 @@
+//
+//  Environment.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/23/21.
+//
+
+#include <new>
+#include "Environment.hpp"
+
+// --- BEGIN PRIVATE ---
+
+/**
+ Writes the observation of one game into the buffers: the stack and the
+ active piece into its grid, then the piece's type and orientation.
+*/
+void Environment::observe(const int &i, const TetrisEnvBuffers &out) const {
+  const Board &board = this->boards[i];
+  const Bitboard &b = board.getBitboard();
+  const int rows = b.getRows();
+  const int cols = b.getCols();
+
+  uint8_t *grid = out.grid + (size_t)i * rows * cols;
+  for (int row = 0; row < rows; row++) {
+    const uint64_t mask = b.getRow(row) >> 1;
+    for (int col = 0; col < cols; col++)
+      grid[row * cols + col] = (mask >> col) & 1;
+  }
+
+  // The piece goes on top of the stack it is falling through
+  const Piece &active = board.getActive();
+  const Footprint &f = active.getFootprint();
+  for (int r = 0; r < 4; r++) {
+    const int row = f.top + r;
+    if (row < 0 || row >= rows)
+      continue;
+    for (uint64_t bits = f.rows[r]; bits; bits &= bits - 1)
+      grid[row * cols + __builtin_ctzll(bits) - 1] = 2;
+  }
+
+  if (out.piece)
+    out.piece[i] = active.getType();
+  if (out.rotation)
+    out.rotation[i] = active.getRotation();
+}
+
+// --- END PRIVATE ---
+
+// --- BEGIN PUBLIC ---
+
+/**
+ Public constructor.
+
+ @param count - # of games in the batch.
+ @param seed - Seed of the first game; the rest follow in order.
+ @param ticks - Ticks of gravity after each action.
+*/
+Environment::Environment(const int &count, const unsigned &seed, const int &ticks) {
+  this->next_seed = seed;
+  this->ticks = ticks;
+  this->boards.reserve(count);
+  for (int i = 0; i < count; i++)
+    this->boards.push_back(Board(ROWS, COLS, 1.0 / TICK_RATE, this->next_seed++));
+}
+
+/**
+ Restarts every game and writes the first observations.
+*/
+void Environment::reset(const TetrisEnvBuffers &out) {
+  for (int i = 0; i < (int)this->boards.size(); i++) {
+    this->boards[i].reset(this->next_seed++);
+    this->observe(i, out);
+    if (out.reward)
+      out.reward[i] = 0;
+    if (out.done)
+      out.done[i] = 0;
+  }
+}
+
+/**
+ Applies one action to every game, then the ticks of gravity, and writes the
+ results. Games that end are restarted right away, so the observation written
+ for them is the first one of the next game.
+*/
+void Environment::step(const int32_t *actions, const TetrisEnvBuffers &out) {
+  for (int i = 0; i < (int)this->boards.size(); i++) {
+    Board &board = this->boards[i];
+    const int score = board.getScore();
+
+    if (actions[i] >= 0 && actions[i] <= TICK)
+      board.step(ACTION(actions[i]));
+    for (int t = 0; t < this->ticks; t++)
+      board.step(TICK);
+
+    if (out.reward)
+      out.reward[i] = (float)(board.getScore() - score);
+    const bool over = board.isOver();
+    if (out.done)
+      out.done[i] = over;
+    if (over)
+      board.reset(this->next_seed++);
+
+    this->observe(i, out);
+  }
+}
+
+// Gets the number of games in the batch
+int Environment::getCount() const {
+  return (int)this->boards.size();
+}
+
+// Gets the number of rows on each board
+int Environment::getRows() const {
+  return this->boards.empty() ? ROWS : this->boards[0].getBitboard().getRows();
+}
+
+// Gets the number of cols on each board
+int Environment::getCols() const {
+  return this->boards.empty() ? COLS : this->boards[0].getBitboard().getCols();
+}
+
+// --- END PUBLIC ---
+
+// --- BEGIN C API ---
+
+// An exception can't unwind into C or ctypes, so nothing thrown on the C++
+// side gets past these functions: it is caught and reported the only way the
+// C API can, as a null environment or a call that did nothing.
+
+struct TetrisEnv {
+  Environment env;
+};
+
+TetrisEnv* tetris_env_create(int count, unsigned seed, int ticks_per_step) {
+  if (count <= 0)
+    return nullptr;
+  // The games allocate their boards as they are built, so a batch too big for
+  // memory throws from inside the environment, not just from new
+  try {
+    return new (std::nothrow) TetrisEnv{ Environment(count, seed, ticks_per_step) };
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void tetris_env_destroy(TetrisEnv *env) {
+  delete env;
+}
+
+void tetris_env_reset(TetrisEnv *env, const TetrisEnvBuffers *out) {
+  if (!env || !out)
+    return;
+  try {
+    env->env.reset(*out);
+  } catch (...) {
+  }
+}
+
+void tetris_env_step(TetrisEnv *env, const int32_t *actions, const TetrisEnvBuffers *out) {
+  if (!env || !actions || !out)
+    return;
+  try {
+    env->env.step(actions, *out);
+  } catch (...) {
+  }
+}
+
+int tetris_env_count(const TetrisEnv *env) {
+  return env ? env->env.getCount() : 0;
+}
+
+int tetris_env_rows(const TetrisEnv *env) {
+  return env ? env->env.getRows() : 0;
+}
+
+int tetris_env_cols(const TetrisEnv *env) {
+  return env ? env->env.getCols() : 0;
+}
+
+// --- END C API ---
@@ -0,0 +1,71 @@
+//
+//  Environment.hpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/23/21.
+//
+
+#ifndef Environment_hpp
+#define Environment_hpp
+
+#include <cstdint>
+#include <vector>
+#include "Board.hpp"
+#include "EnvironmentAPI.h"
+
+using std::vector;
+
+/**
+ Steps a batch of headless games in lockstep for reinforcement learning.
+ Observations, rewards and done flags go straight into the caller's buffers
+ (see <TetrisEnvBuffers>), and games that end are restarted in place, so a
+ step never allocates or copies anything else.
+
+ One environment runs on the calling thread. Independent environments share
+ nothing, so a trainer can run one per thread.
+*/
+class Environment {
+private:
+  vector<Board> boards;
+  /**
+   Seed of the next game started.
+  */
+  unsigned next_seed;
+  /**
+   Ticks of gravity after each action.
+  */
+  int ticks;
+
+  /**
+   Writes the observation of one game into the buffers.
+  */
+  void observe(const int &i, const TetrisEnvBuffers &out) const;
+
+public:
+  /**
+   Public constructor.
+
+   @param count - # of games in the batch.
+   @param seed - Seed of the first game; the rest follow in order.
+   @param ticks - Ticks of gravity after each action.
+  */
+  Environment(const int &count, const unsigned &seed, const int &ticks = 1);
+
+  /**
+   Restarts every game and writes the first observations.
+  */
+  void reset(const TetrisEnvBuffers &out);
+
+  /**
+   Applies one action to every game, then the ticks of gravity, and writes
+   the results.
+  */
+  void step(const int32_t *actions, const TetrisEnvBuffers &out);
+
+  // Getters
+  int getCount() const;
+  int getRows() const;
+  int getCols() const;
+};
+
+#endif /* Environment_hpp */
@@ -0,0 +1,83 @@
+//
+//  EnvironmentAPI.h
+//  Tetris
+//
+//  Created by Andy Mina on 5/23/21.
+//
+//  C interface to <Environment>, for training code that isn't C++ (e.g.
+//  loaded through ctypes or cffi). Every buffer is owned by the caller and
+//  written in place. No C++ exception ever gets out to the caller; failures
+//  come back as a null environment.
+//
+
+#ifndef EnvironmentAPI_h
+#define EnvironmentAPI_h
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ Where a step writes its results, for a batch of N games on a rows x cols
+ board. Every array is contiguous.
+
+   grid      N * rows * cols cells, row-major: 0 empty, 1 stack, 2 active piece
+   piece     N active piece types (PIECE_TYPE)
+   rotation  N active piece orientations, 0-3
+   reward    N points scored by the step
+   done      N flags, 1 if the game ended on the step. That game has already
+             been restarted, and the rest of its outputs are for the new game.
+
+ Any pointer but grid may be null to skip that output.
+*/
+typedef struct TetrisEnvBuffers {
+  uint8_t *grid;
+  int32_t *piece;
+  int32_t *rotation;
+  float *reward;
+  uint8_t *done;
+} TetrisEnvBuffers;
+
+typedef struct TetrisEnv TetrisEnv;
+
+/**
+ Creates N games on standard boards. Game seeds are handed out in order from
+ seed, so a batch is reproducible. Each step applies the action, then
+ ticks_per_step ticks of gravity.
+
+ @return: the environment, or null if count is not positive or there isn't
+ the memory for it.
+*/
+TetrisEnv* tetris_env_create(int count, unsigned seed, int ticks_per_step);
+
+/**
+ Frees an environment.
+*/
+void tetris_env_destroy(TetrisEnv *env);
+
+/**
+ Restarts every game and writes the first observations. reward and done are
+ zeroed. Does nothing if env or out is null.
+*/
+void tetris_env_reset(TetrisEnv *env, const TetrisEnvBuffers *out);
+
+/**
+ Steps every game once. actions holds N ACTION values; anything out of range
+ is a no-op. Does nothing if any pointer is null.
+*/
+void tetris_env_step(TetrisEnv *env, const int32_t *actions, const TetrisEnvBuffers *out);
+
+/**
+ Dimensions of the batch, for sizing the buffers. 0 if env is null.
+*/
+int tetris_env_count(const TetrisEnv *env);
+int tetris_env_rows(const TetrisEnv *env);
+int tetris_env_cols(const TetrisEnv *env);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EnvironmentAPI_h */
@@ -0,0 +1,452 @@
+//
+//  Evaluator.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/16/21.
+//
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include "Evaluator.hpp"
+
+// On x86 the vector kernels are built into every binary, each function marked
+// with the instruction set it needs, and the best one the CPU has is picked
+// the first time a batch is evaluated. No -mavx2 or -msse4.1 needed.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define EVALUATOR_X86
+#include <immintrin.h>
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+// The shared kernel below passes vectors around before it is inlined into the
+// function that has the instruction set, which GCC warns changes the ABI.
+// Nothing is ever called that way once inlined.
+#ifndef __clang__
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+#endif
+
+// --- BEGIN KERNELS ---
+
+// Every feature is computed with 16-bit lanes, one board per lane. With at
+// most 40 rows and 14 columns no sum can get past 600, so nothing overflows.
+// Each instruction set supplies the same handful of operations and the kernel
+// below is written once against them.
+
+/**
+ Plain C++, one board at a time.
+*/
+struct ScalarOps {
+  typedef int Vec;
+  static const int LANES = 1;
+
+  static Vec set1(const int &x) { return x; }
+  static Vec load(const int16_t *p) { return p[0]; }
+  static void store(int16_t *p, const Vec &a) { p[0] = (int16_t)a; }
+  static Vec add(const Vec &a, const Vec &b) { return a + b; }
+  static Vec sub(const Vec &a, const Vec &b) { return a - b; }
+  static Vec bitAnd(const Vec &a, const Vec &b) { return a & b; }
+  static Vec bitOr(const Vec &a, const Vec &b) { return a | b; }
+  static Vec bitXor(const Vec &a, const Vec &b) { return a ^ b; }
+  static Vec andNot(const Vec &a, const Vec &b) { return ~a & b; }
+  static Vec shiftLeft1(const Vec &a) { return (a << 1) & 0xFFFF; }
+  static Vec shiftRight(const Vec &a, const int &n) { return a >> n; }
+  static Vec min(const Vec &a, const Vec &b) { return std::min(a, b); }
+  static Vec max(const Vec &a, const Vec &b) { return std::max(a, b); }
+  static Vec abs(const Vec &a) { return std::abs(a); }
+  static Vec nonZero(const Vec &a) { return a ? 0xFFFF : 0; }
+  static Vec popcount(const Vec &a) { return __builtin_popcount(a); }
+};
+
+#ifdef EVALUATOR_X86
+
+/**
+ AVX2, 16 boards per pass.
+*/
+struct Avx2Ops {
+  typedef __m256i Vec;
+  static const int LANES = 16;
+
+  TARGET_AVX2 static Vec set1(const int &x) { return _mm256_set1_epi16((short)x); }
+  TARGET_AVX2 static Vec load(const int16_t *p) { return _mm256_loadu_si256((const __m256i*)p); }
+  TARGET_AVX2 static void store(int16_t *p, const Vec &a) { _mm256_storeu_si256((__m256i*)p, a); }
+  TARGET_AVX2 static Vec add(const Vec &a, const Vec &b) { return _mm256_add_epi16(a, b); }
+  TARGET_AVX2 static Vec sub(const Vec &a, const Vec &b) { return _mm256_sub_epi16(a, b); }
+  TARGET_AVX2 static Vec bitAnd(const Vec &a, const Vec &b) { return _mm256_and_si256(a, b); }
+  TARGET_AVX2 static Vec bitOr(const Vec &a, const Vec &b) { return _mm256_or_si256(a, b); }
+  TARGET_AVX2 static Vec bitXor(const Vec &a, const Vec &b) { return _mm256_xor_si256(a, b); }
+  TARGET_AVX2 static Vec andNot(const Vec &a, const Vec &b) { return _mm256_andnot_si256(a, b); }
+  TARGET_AVX2 static Vec shiftLeft1(const Vec &a) { return _mm256_slli_epi16(a, 1); }
+  TARGET_AVX2 static Vec shiftRight(const Vec &a, const int &n) {
+    return _mm256_srl_epi16(a, _mm_cvtsi32_si128(n));
+  }
+  TARGET_AVX2 static Vec min(const Vec &a, const Vec &b) { return _mm256_min_epi16(a, b); }
+  TARGET_AVX2 static Vec max(const Vec &a, const Vec &b) { return _mm256_max_epi16(a, b); }
+  TARGET_AVX2 static Vec abs(const Vec &a) { return _mm256_abs_epi16(a); }
+  TARGET_AVX2 static Vec nonZero(const Vec &a) {
+    return _mm256_xor_si256(_mm256_cmpeq_epi16(a, _mm256_setzero_si256()),
+                            _mm256_set1_epi16(-1));
+  }
+  TARGET_AVX2 static Vec popcount(const Vec &a) {
+    // Count each nibble with a lookup table, then add the two bytes of a lane
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                           0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i bytes = _mm256_add_epi8(
+      _mm256_shuffle_epi8(table, _mm256_and_si256(a, nibble)),
+      _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(a, 4), nibble)));
+    return _mm256_add_epi16(_mm256_and_si256(bytes, _mm256_set1_epi16(0xFF)),
+                            _mm256_srli_epi16(bytes, 8));
+  }
+};
+
+/**
+ SSE4.1, 8 boards per pass.
+*/
+struct Sse41Ops {
+  typedef __m128i Vec;
+  static const int LANES = 8;
+
+  TARGET_SSE41 static Vec set1(const int &x) { return _mm_set1_epi16((short)x); }
+  TARGET_SSE41 static Vec load(const int16_t *p) { return _mm_loadu_si128((const __m128i*)p); }
+  TARGET_SSE41 static void store(int16_t *p, const Vec &a) { _mm_storeu_si128((__m128i*)p, a); }
+  TARGET_SSE41 static Vec add(const Vec &a, const Vec &b) { return _mm_add_epi16(a, b); }
+  TARGET_SSE41 static Vec sub(const Vec &a, const Vec &b) { return _mm_sub_epi16(a, b); }
+  TARGET_SSE41 static Vec bitAnd(const Vec &a, const Vec &b) { return _mm_and_si128(a, b); }
+  TARGET_SSE41 static Vec bitOr(const Vec &a, const Vec &b) { return _mm_or_si128(a, b); }
+  TARGET_SSE41 static Vec bitXor(const Vec &a, const Vec &b) { return _mm_xor_si128(a, b); }
+  TARGET_SSE41 static Vec andNot(const Vec &a, const Vec &b) { return _mm_andnot_si128(a, b); }
+  TARGET_SSE41 static Vec shiftLeft1(const Vec &a) { return _mm_slli_epi16(a, 1); }
+  TARGET_SSE41 static Vec shiftRight(const Vec &a, const int &n) {
+    return _mm_srl_epi16(a, _mm_cvtsi32_si128(n));
+  }
+  TARGET_SSE41 static Vec min(const Vec &a, const Vec &b) { return _mm_min_epi16(a, b); }
+  TARGET_SSE41 static Vec max(const Vec &a, const Vec &b) { return _mm_max_epi16(a, b); }
+  TARGET_SSE41 static Vec abs(const Vec &a) { return _mm_abs_epi16(a); }
+  TARGET_SSE41 static Vec nonZero(const Vec &a) {
+    return _mm_xor_si128(_mm_cmpeq_epi16(a, _mm_setzero_si128()), _mm_set1_epi16(-1));
+  }
+  TARGET_SSE41 static Vec popcount(const Vec &a) {
+    // Count each nibble with a lookup table, then add the two bytes of a lane
+    const __m128i table = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i bytes = _mm_add_epi8(
+      _mm_shuffle_epi8(table, _mm_and_si128(a, nibble)),
+      _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(a, 4), nibble)));
+    return _mm_add_epi16(_mm_and_si128(bytes, _mm_set1_epi16(0xFF)),
+                         _mm_srli_epi16(bytes, 8));
+  }
+};
+
+#endif
+
+/**
+ Computes the features of up to V::LANES boards, starting at boards[first],
+ and writes them to out at the same indices. Always inlined, so it is built
+ with the instruction set of the kernel that calls it.
+*/
+template <typename V>
+__attribute__((always_inline)) static inline void evaluateLanes(const CompactBoard *boards, const int &first, const int &count,
+                          const int &rows, const int &cols, Features &out) {
+  typedef typename V::Vec Vec;
+  const int L = V::LANES;
+
+  // Transpose the boards so each row of every lane can be loaded at once.
+  // Lanes past the end of the batch stay empty.
+  int16_t lanes[CompactBoard::MAX_ROWS][L];
+  for (int i = 0; i < rows; i++) {
+    for (int k = 0; k < L; k++)
+      lanes[i][k] = k < count ? (int16_t)boards[first + k].rows[i] : 0;
+  }
+
+  const Vec one = V::set1(1);
+  // The walls on either side of a row once it is shifted up one bit, and the
+  // bits that hold a boundary between two neighbouring cells (or a wall)
+  const Vec walls = V::set1(1 | (1 << (cols + 1)));
+  const Vec boundaries = V::set1((1 << (cols + 1)) - 1);
+
+  Vec seen = V::set1(0);
+  Vec holes = V::set1(0);
+  Vec transitions = V::set1(0);
+  Vec heights[CompactBoard::MAX_COLS];
+  for (int j = 0; j < cols; j++)
+    heights[j] = V::set1(0);
+
+  for (int i = 0; i < rows; i++) {
+    const Vec row = V::load(lanes[i]);
+
+    // Empty cells under something filled are holes
+    holes = V::add(holes, V::popcount(V::andNot(row, seen)));
+    seen = V::bitOr(seen, row);
+
+    // A column's height is the number of rows at or below its highest cell
+    for (int j = 0; j < cols; j++)
+      heights[j] = V::add(heights[j], V::bitAnd(V::shiftRight(seen, j), one));
+
+    // Count filled/empty changes with the walls attached, skipping rows above
+    // the stack
+    const Vec walled = V::bitOr(V::shiftLeft1(row), walls);
+    const Vec changes = V::bitAnd(V::bitXor(walled, V::shiftRight(walled, 1)), boundaries);
+    transitions = V::add(transitions, V::bitAnd(V::popcount(changes), V::nonZero(seen)));
+  }
+
+  // Fold the column heights into the column features
+  const Vec full = V::set1(rows);
+  Vec height = V::set1(0), max_height = V::set1(0);
+  Vec bumpiness = V::set1(0), wells = V::set1(0);
+  for (int j = 0; j < cols; j++) {
+    height = V::add(height, heights[j]);
+    max_height = V::max(max_height, heights[j]);
+    if (j > 0)
+      bumpiness = V::add(bumpiness, V::abs(V::sub(heights[j], heights[j - 1])));
+
+    const Vec left = j > 0 ? heights[j - 1] : full;
+    const Vec right = j < cols - 1 ? heights[j + 1] : full;
+    const Vec depth = V::sub(V::min(left, right), heights[j]);
+    wells = V::add(wells, V::max(depth, V::set1(0)));
+  }
+
+  // Spread the lanes back out into the feature arrays
+  int16_t values[6][L];
+  V::store(values[0], height);
+  V::store(values[1], max_height);
+  V::store(values[2], holes);
+  V::store(values[3], bumpiness);
+  V::store(values[4], transitions);
+  V::store(values[5], wells);
+  for (int k = 0; k < count; k++) {
+    out.height[first + k] = values[0][k];
+    out.max_height[first + k] = values[1][k];
+    out.holes[first + k] = values[2][k];
+    out.bumpiness[first + k] = values[3][k];
+    out.row_transitions[first + k] = values[4][k];
+    out.wells[first + k] = values[5][k];
+  }
+}
+
+/**
+ Computes the features of every board in the batch, V::LANES at a time.
+*/
+template <typename V>
+__attribute__((always_inline)) static inline void evaluateAll(
+    const CompactBoard *boards, const int &count, const int &rows, const int &cols,
+    Features &out) {
+  const int lanes = V::LANES;
+  for (int first = 0; first < count; first += lanes)
+    evaluateLanes<V>(boards, first, std::min(lanes, count - first), rows, cols, out);
+}
+
+static void evaluateScalar(const CompactBoard *boards, const int &count, const int &rows,
+                           const int &cols, Features &out) {
+  evaluateAll<ScalarOps>(boards, count, rows, cols, out);
+}
+
+#ifdef EVALUATOR_X86
+
+TARGET_AVX2 static void evaluateAvx2(const CompactBoard *boards, const int &count,
+                                     const int &rows, const int &cols, Features &out) {
+  evaluateAll<Avx2Ops>(boards, count, rows, cols, out);
+}
+
+TARGET_SSE41 static void evaluateSse41(const CompactBoard *boards, const int &count,
+                                       const int &rows, const int &cols, Features &out) {
+  evaluateAll<Sse41Ops>(boards, count, rows, cols, out);
+}
+
+static bool hasAvx2() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+
+static bool hasSse41() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse4.1");
+}
+
+#endif
+
+/**
+ A kernel, and whether the CPU can run it. Best first; scalar always can.
+*/
+struct Kernel {
+  const char *name;
+  void (*evaluate)(const CompactBoard *boards, const int &count, const int &rows,
+                   const int &cols, Features &out);
+  bool (*supported)();
+};
+
+static const Kernel KERNELS[] = {
+#ifdef EVALUATOR_X86
+  { "avx2", evaluateAvx2, hasAvx2 },
+  { "sse4.1", evaluateSse41, hasSse41 },
+#endif
+  { "scalar", evaluateScalar, nullptr }
+};
+static const int KERNEL_COUNT = sizeof(KERNELS) / sizeof(KERNELS[0]);
+
+/**
+ @return: the kernel in use, set to the best one the CPU has on first use.
+*/
+static const Kernel*& current() {
+  static const Kernel *kernel = [] {
+    int i = 0;
+    while (KERNELS[i].supported && !KERNELS[i].supported())
+      i++;
+    return &KERNELS[i];
+  }();
+  return kernel;
+}
+
+// --- END KERNELS ---
+
+// --- BEGIN Features ---
+
+/**
+ Sizes every array for count boards.
+*/
+void Features::resize(const int &count) {
+  this->height.resize(count);
+  this->max_height.resize(count);
+  this->holes.resize(count);
+  this->bumpiness.resize(count);
+  this->row_transitions.resize(count);
+  this->wells.resize(count);
+}
+
+// --- END Features ---
+
+// --- BEGIN Evaluator ---
+
+/**
+ @return: true if boards of the given size fit in a <CompactBoard>; false
+ otherwise.
+*/
+bool Evaluator::fits(const int &rows, const int &cols) {
+  return rows >= 0 && rows <= CompactBoard::MAX_ROWS && cols >= 0 && cols <= CompactBoard::MAX_COLS;
+}
+
+/**
+ Copies a bitboard into compact form: drops the walls and keeps the columns.
+
+ @return: true if the board fit; false, with out untouched, otherwise.
+*/
+bool Evaluator::compact(const Bitboard &board, CompactBoard &out) {
+  if (!Evaluator::fits(board.getRows(), board.getCols()))
+    return false;
+
+  const uint64_t cells = (uint64_t(1) << board.getCols()) - 1;
+  for (int i = 0; i < board.getRows(); i++)
+    out.rows[i] = (uint16_t)((board.getRow(i) >> 1) & cells);
+  return true;
+}
+
+/**
+ Computes the features of count boards of the given size into out, with the
+ kernel in use.
+
+ @return: true if the boards were scored; false, with out untouched, if the
+ size doesn't fit in a <CompactBoard>.
+*/
+bool Evaluator::evaluate(const CompactBoard *boards, const int &count,
+                         const int &rows, const int &cols, Features &out) {
+  if (!Evaluator::fits(rows, cols))
+    return false;
+
+  out.resize(count);
+  current()->evaluate(boards, count, rows, cols, out);
+  return true;
+}
+
+/**
+ Computes the features of one board into out at index i, a row at a time on
+ the full row masks, the same way the kernels do on compact rows. Slower than
+ a batch, but takes any board a <Bitboard> holds.
+*/
+void Evaluator::evaluate(const Bitboard &board, const int &i, Features &out) {
+  const int rows = board.getRows();
+  const int cols = board.getCols();
+  const uint64_t cells = (uint64_t(1) << cols) - 1;
+  // The walls on either side of a row once it is shifted up one bit, and the
+  // bits that hold a boundary between two neighbouring cells (or a wall)
+  const uint64_t walls = 1 | (uint64_t(1) << (cols + 1));
+  const uint64_t boundaries = (uint64_t(1) << (cols + 1)) - 1;
+
+  uint64_t seen = 0;
+  int holes = 0, transitions = 0;
+  int heights[Bitboard::MAX_COLS] = {};
+  for (int r = 0; r < rows; r++) {
+    const uint64_t row = (board.getRow(r) >> 1) & cells;
+
+    // Empty cells under something filled are holes
+    holes += __builtin_popcountll(~row & seen);
+    seen |= row;
+
+    // A column's height is the number of rows at or below its highest cell
+    for (uint64_t bits = seen; bits; bits &= bits - 1)
+      heights[__builtin_ctzll(bits)]++;
+
+    // Count filled/empty changes with the walls attached, skipping rows above
+    // the stack
+    if (seen) {
+      const uint64_t walled = (row << 1) | walls;
+      transitions += __builtin_popcountll((walled ^ (walled >> 1)) & boundaries);
+    }
+  }
+
+  // Fold the column heights into the column features
+  int height = 0, max_height = 0, bumpiness = 0, wells = 0;
+  for (int j = 0; j < cols; j++) {
+    height += heights[j];
+    max_height = std::max(max_height, heights[j]);
+    if (j > 0)
+      bumpiness += std::abs(heights[j] - heights[j - 1]);
+
+    const int left = j > 0 ? heights[j - 1] : rows;
+    const int right = j < cols - 1 ? heights[j + 1] : rows;
+    wells += std::max(std::min(left, right) - heights[j], 0);
+  }
+
+  out.height[i] = height;
+  out.max_height[i] = max_height;
+  out.holes[i] = holes;
+  out.bumpiness[i] = bumpiness;
+  out.row_transitions[i] = transitions;
+  out.wells[i] = wells;
+}
+
+/**
+ @return: the name of the kernel in use.
+*/
+const char* Evaluator::kernel() {
+  return current()->name;
+}
+
+/**
+ @return: the names of the kernels the CPU can run, best first.
+*/
+vector<const char*> Evaluator::kernels() {
+  vector<const char*> names;
+  for (int i = 0; i < KERNEL_COUNT; i++)
+    if (!KERNELS[i].supported || KERNELS[i].supported())
+      names.push_back(KERNELS[i].name);
+  return names;
+}
+
+/**
+ Switches to the named kernel, if the CPU can run it.
+
+ @return: true if the kernel is now in use; false otherwise.
+*/
+bool Evaluator::setKernel(const char *name) {
+  for (int i = 0; i < KERNEL_COUNT; i++) {
+    if (strcmp(KERNELS[i].name, name) != 0)
+      continue;
+    if (KERNELS[i].supported && !KERNELS[i].supported())
+      return false;
+    current() = &KERNELS[i];
+    return true;
+  }
+  return false;
+}
+
+// --- END Evaluator ---
@@ -0,0 +1,126 @@
+//
+//  Evaluator.hpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/16/21.
+//
+
+#ifndef Evaluator_hpp
+#define Evaluator_hpp
+
+#include <cstdint>
+#include <vector>
+#include "Bitboard.hpp"
+
+using std::vector;
+
+/**
+ A board reduced to one 16-bit mask per row, column c at bit c, no walls. The
+ form the batch kernels work on. Holds up to MAX_ROWS rows and MAX_COLS
+ columns.
+*/
+struct CompactBoard {
+  static const int MAX_ROWS = 40;
+  static const int MAX_COLS = 14;
+  uint16_t rows[MAX_ROWS];
+};
+
+/**
+ Feature values for a batch of boards, one array per feature (struct of
+ arrays), so a scoring loop over them vectorizes too.
+*/
+struct Features {
+  /**
+   Sum of the column heights.
+  */
+  vector<int32_t> height;
+  /**
+   Height of the tallest column.
+  */
+  vector<int32_t> max_height;
+  /**
+   Empty cells with a filled cell somewhere above them.
+  */
+  vector<int32_t> holes;
+  /**
+   Sum of the height differences between neighbouring columns.
+  */
+  vector<int32_t> bumpiness;
+  /**
+   Filled/empty changes along each row, walls included, counting only rows at
+   or below the top of the stack.
+  */
+  vector<int32_t> row_transitions;
+  /**
+   Sum of the depths of every well: how far a column sits below the lower of
+   its two neighbours (the walls count as full height).
+  */
+  vector<int32_t> wells;
+
+  /**
+   Sizes every array for count boards. Keeps capacity, so it only allocates
+   when the batch grows.
+  */
+  void resize(const int &count);
+};
+
+/**
+ Extracts board features for whole batches of candidate boards at once. The
+ kernel is written once over a small set of vector operations and built for
+ AVX2 (16 boards per pass), SSE4.1 (8 boards) and plain scalar code. On x86
+ all three are in every build and the best one the CPU supports is picked at
+ run time; elsewhere the scalar one is used.
+*/
+class Evaluator {
+public:
+  /**
+   @return: true if boards of the given size fit in a <CompactBoard> and can
+   be scored in batches; false otherwise.
+  */
+  static bool fits(const int &rows, const int &cols);
+
+  /**
+   Copies a bitboard into compact form.
+
+   @return: true if the board fit; false, with out untouched, otherwise.
+  */
+  static bool compact(const Bitboard &board, CompactBoard &out);
+
+  /**
+   Computes the features of count boards of the given size into out.
+
+   @return: true if the boards were scored; false, with out untouched, if
+   they don't fit in a <CompactBoard>.
+  */
+  static bool evaluate(const CompactBoard *boards, const int &count,
+                       const int &rows, const int &cols, Features &out);
+
+  /**
+   Computes the features of one board of any size into out at index i, which
+   must already be sized for it. One board at a time, for boards that don't
+   fit in a <CompactBoard>.
+  */
+  static void evaluate(const Bitboard &board, const int &i, Features &out);
+
+  /**
+   @return: the name of the kernel in use: "avx2", "sse4.1" or "scalar".
+  */
+  static const char* kernel();
+
+  /**
+   @return: the names of the kernels this CPU can run, best first. "scalar" is
+   always last.
+  */
+  static vector<const char*> kernels();
+
+  /**
+   Switches every evaluation to the named kernel, for checking and measuring
+   the kernels against each other. Not safe while other threads evaluate.
+
+   @return: true if the kernel is now in use; false if there is no such kernel
+   or this CPU can't run it.
+  */
+  static bool setKernel(const char *name);
+};
+
+#endif /* Evaluator_hpp */
@@ -1,16 +0,0 @@
-//
-//  Global.cpp
-//  Tetris
-//
-//  Created by Andy Mina on 5/3/21.
-//
-
-#include "Global.hpp"
-
-// Define global vars
-int ROWS = 20;
-int COLS = 10;
-int WINDOW_WIDTH = 400;
-int WINDOW_HEIGHT = 800;
-int FPS = 60;
-float BLOCK_SIZE = WINDOW_WIDTH / COLS;
@@ -8,11 +8,21 @@
 #ifndef Global_hpp
 #define Global_hpp
 
-extern int ROWS;
-extern int COLS;
-extern int WINDOW_WIDTH;
-extern int WINDOW_HEIGHT;
-extern int FPS;
-extern float BLOCK_SIZE;
+// Settings are fixed at compile time, so every check against them folds to a
+// constant instead of a load
+
+// Visible rows and cols of a standard board
+constexpr int ROWS = 20;
+constexpr int COLS = 10;
+// Rows of a tall board. The ones above the visible ROWS are hidden and pieces
+// spawn in them.
+constexpr int TALL_ROWS = 40;
+constexpr int WINDOW_WIDTH = 400;
+constexpr int WINDOW_HEIGHT = 800;
+constexpr int FPS = 60;
+constexpr int TICK_RATE = 60;
+constexpr int DAS = 10;
+constexpr int ARR = 2;
+constexpr float BLOCK_SIZE = WINDOW_WIDTH / COLS;
 
 #endif /* Global_hpp */
@@ -0,0 +1,69 @@
+//
+//  History.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/23/21.
+//
+
+#include "History.hpp"
+
+/**
+ Public constructor.
+
+ @param capacity - Most snapshots kept.
+*/
+History::History(const int &capacity): states(capacity > 0 ? capacity : 1) {
+  this->head = 0;
+  this->count = 0;
+}
+
+/**
+ Saves a snapshot of the board as the newest one, over the oldest if the ring
+ is full.
+
+ @return: true if it was saved; false if the board is too big to snapshot.
+*/
+bool History::push(const Board &board) {
+  if (!board.save(this->states[this->head]))
+    return false;
+
+  this->head = (this->head + 1) % this->capacity();
+  if (this->count < this->capacity())
+    this->count++;
+  return true;
+}
+
+/**
+ Drops the newest `steps` snapshots and restores the board to the one that is
+ newest after that, which stays in the ring.
+
+ @return: true if the board was restored; false if there aren't that many
+ snapshots to go back through.
+*/
+bool History::undo(Board &board, const int &steps) {
+  if (steps < 0 || steps >= this->count)
+    return false;
+
+  this->count -= steps;
+  this->head = (this->head - steps + this->capacity()) % this->capacity();
+  board.restore(this->states[(this->head - 1 + this->capacity()) % this->capacity()]);
+  return true;
+}
+
+/**
+ Drops every snapshot.
+*/
+void History::clear() {
+  this->head = 0;
+  this->count = 0;
+}
+
+// Gets the number of snapshots kept
+int History::size() const {
+  return this->count;
+}
+
+// Gets the most snapshots the ring holds
+int History::capacity() const {
+  return (int)this->states.size();
+}
@@ -0,0 +1,64 @@
+//
+//  History.hpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/23/21.
+//
+
+#ifndef History_hpp
+#define History_hpp
+
+#include <vector>
+#include "Board.hpp"
+
+using std::vector;
+
+/**
+ A bounded ring of <BoardState> snapshots for multi-level undo and rewind.
+ Every slot is allocated up front, so a push is one snapshot copied into the
+ next slot. Once the ring is full, each push overwrites the oldest snapshot.
+*/
+class History {
+private:
+  vector<BoardState> states;
+  /**
+   The slot the next push writes to, and how many slots hold snapshots.
+  */
+  int head;
+  int count;
+
+public:
+  /**
+   Public constructor.
+
+   @param capacity - Most snapshots kept.
+  */
+  History(const int &capacity = 64);
+
+  /**
+   Saves a snapshot of the board as the newest one.
+
+   @return: true if it was saved; false if the board is too big to snapshot.
+  */
+  bool push(const Board &board);
+
+  /**
+   Drops the newest `steps` snapshots and restores the board to the one that
+   is newest after that, which stays in the ring.
+
+   @return: true if the board was restored; false if there aren't that many
+   snapshots to go back through, leaving everything as it was.
+  */
+  bool undo(Board &board, const int &steps = 1);
+
+  /**
+   Drops every snapshot.
+  */
+  void clear();
+
+  // Getters
+  int size() const;
+  int capacity() const;
+};
+
+#endif /* History_hpp */
@@ -0,0 +1,223 @@
+//
+//  Input.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/18/21.
+//
+
+#include <algorithm>
+#include "Input.hpp"
+
+// --- BEGIN Latency ---
+
+Latency::Latency(): counts(), samples(0), total(0), worst(0) {}
+
+/**
+ Adds a sample, in seconds.
+*/
+void Latency::add(const double &seconds) {
+  const int last = Latency::BUCKETS;
+  const int bucket = std::min(std::max((int)(seconds * 1e4), 0), last);
+  this->counts[bucket]++;
+  this->samples++;
+  this->total += seconds;
+  this->worst = std::max(this->worst, seconds);
+}
+
+/**
+ @return: the latency, in seconds, that the given fraction of samples were at
+ or under.
+*/
+double Latency::percentile(const double &fraction) const {
+  const long target = (long)(fraction * this->samples);
+  long seen = 0;
+  for (int i = 0; i <= Latency::BUCKETS; i++) {
+    seen += this->counts[i];
+    if (seen > target)
+      return (i + 1) * 1e-4;
+  }
+  return Latency::BUCKETS * 1e-4;
+}
+
+// Gets the number of samples
+long Latency::getSamples() const {
+  return this->samples;
+}
+
+// Gets the mean latency in seconds
+double Latency::getMean() const {
+  return this->samples ? this->total / this->samples : 0;
+}
+
+// Gets the worst latency in seconds
+double Latency::getMax() const {
+  return this->worst;
+}
+
+// --- END Latency ---
+
+// --- BEGIN InputHandler ---
+
+/**
+ Applies one event to the held buttons and queues the action it triggers.
+ Repeated presses of a held button and releases of an unheld one are ignored.
+*/
+void InputHandler::apply(const InputEvent &event) {
+  if (this->held[event.button] == event.pressed)
+    return;
+  this->held[event.button] = event.pressed;
+
+  if (event.pressed && (int)this->to_state.size() < InputHandler::CAPACITY)
+    this->to_state.push_back(event.time);
+
+  switch (event.button) {
+    case BUTTON_LEFT:
+    case BUTTON_RIGHT: {
+      const int side = event.button == BUTTON_LEFT ? -1 : 1;
+      if (event.pressed) {
+        // The newest side press wins and moves right away
+        this->shift = side;
+        this->shift_ticks = -1;
+        this->shiftPiece();
+      } else if (this->shift == side) {
+        // Fall back to the other side if it is still held, recharging DAS
+        const BUTTON other = side < 0 ? BUTTON_RIGHT : BUTTON_LEFT;
+        this->shift = this->held[other] ? -side : 0;
+        this->shift_ticks = -1;
+      }
+      break;
+    }
+    case BUTTON_DOWN:
+      if (event.pressed) {
+        this->actions.push_back(MOVE_DOWN);
+        this->down_ticks = -1;
+      }
+      break;
+    case BUTTON_CW:
+      if (event.pressed)
+        this->actions.push_back(ROTATE_CW);
+      break;
+    case BUTTON_CCW:
+      if (event.pressed)
+        this->actions.push_back(ROTATE_CCW);
+      break;
+    case BUTTON_HARD_DROP:
+      if (event.pressed)
+        this->actions.push_back(HARD_DROP);
+      break;
+  }
+}
+
+/**
+ Queues one side move, or a slide to the wall when ARR is 0 and DAS has
+ charged. Moves into the wall are no-ops on the board.
+*/
+void InputHandler::shiftPiece() {
+  const ACTION move = this->shift < 0 ? MOVE_LEFT : MOVE_RIGHT;
+  const bool slide = this->arr == 0 && this->shift_ticks >= this->das;
+  for (int i = slide ? this->cols : 1; i > 0; i--)
+    this->actions.push_back(move);
+}
+
+/**
+ Public constructor.
+
+ @param das - Ticks a side button is held before it repeats.
+ @param arr - Ticks between repeats, 0 for instant.
+ @param cols - The number of cols on the board.
+*/
+InputHandler::InputHandler(const int &das, const int &arr, const int &cols) {
+  this->head = 0;
+  this->count = 0;
+  this->das = das;
+  this->arr = arr;
+  this->cols = cols;
+  std::fill(this->held, this->held + 6, false);
+  this->shift = 0;
+  this->shift_ticks = 0;
+  this->down_ticks = 0;
+
+  // Reserve everything up front so ticks never allocate
+  this->actions.reserve(InputHandler::CAPACITY + cols);
+  this->to_state.reserve(InputHandler::CAPACITY);
+  this->to_present.reserve(InputHandler::CAPACITY);
+}
+
+/**
+ Queues a button going down or up at the given time.
+
+ @return: true if it was queued; false if the queue was full.
+*/
+bool InputHandler::push(const double &time, const BUTTON &button, const bool &pressed) {
+  if (this->count == InputHandler::CAPACITY)
+    return false;
+
+  this->events[(this->head + this->count) % InputHandler::CAPACITY] = { time, button, pressed };
+  this->count++;
+  return true;
+}
+
+/**
+ Runs one tick: consumes every event stamped up to time, then applies the
+ auto-repeat.
+
+ @return: the actions to feed the board for this tick, in order.
+*/
+const vector<ACTION>& InputHandler::tick(const double &time) {
+  this->actions.clear();
+
+  // Everything that happened up to this tick, in the order it happened
+  while (this->count > 0 && this->events[this->head].time <= time) {
+    this->apply(this->events[this->head]);
+    this->head = (this->head + 1) % InputHandler::CAPACITY;
+    this->count--;
+  }
+
+  // Auto-repeat the side move once DAS has charged. The tick of the press
+  // already moved.
+  if (this->shift != 0) {
+    this->shift_ticks++;
+    const int repeat = this->shift_ticks - this->das;
+    if (this->shift_ticks > 0 && repeat >= 0 && (this->arr == 0 || repeat % this->arr == 0))
+      this->shiftPiece();
+  }
+
+  // Soft drop repeats every tick after the press
+  if (this->held[BUTTON_DOWN] && ++this->down_ticks > 0)
+    this->actions.push_back(MOVE_DOWN);
+
+  return this->actions;
+}
+
+/**
+ Marks the actions returned so far as applied to the board at the given time.
+*/
+void InputHandler::markState(const double &time) {
+  for (const double &seen : this->to_state) {
+    this->state_latency.add(time - seen);
+    if ((int)this->to_present.size() < InputHandler::CAPACITY)
+      this->to_present.push_back(seen);
+  }
+  this->to_state.clear();
+}
+
+/**
+ Marks the state applied so far as shown on screen at the given time.
+*/
+void InputHandler::markPresent(const double &time) {
+  for (const double &seen : this->to_present)
+    this->present_latency.add(time - seen);
+  this->to_present.clear();
+}
+
+// Gets the input-to-state latency
+const Latency& InputHandler::getStateLatency() const {
+  return this->state_latency;
+}
+
+// Gets the input-to-present latency
+const Latency& InputHandler::getPresentLatency() const {
+  return this->present_latency;
+}
+
+// --- END InputHandler ---
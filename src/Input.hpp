@@ -0,0 +1,177 @@
+//
+//  Input.hpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/18/21.
+//
+
+#ifndef Input_hpp
+#define Input_hpp
+
+#include <vector>
+#include "Global.hpp"
+#include "Board.hpp"
+
+using std::vector;
+
+// Enums to define the buttons a player can hold
+enum BUTTON {
+  BUTTON_LEFT, BUTTON_RIGHT, BUTTON_DOWN,
+  BUTTON_CW, BUTTON_CCW,
+  BUTTON_HARD_DROP
+};
+
+/**
+ A button going down or up, stamped with the time it was seen, in seconds.
+ Only as fine as the front end can see it: raylib polls the keyboard once per
+ frame, so the game stamps everything from one poll with the same time.
+*/
+struct InputEvent {
+  double time;
+  BUTTON button;
+  bool pressed;
+};
+
+/**
+ Collects latency samples into a histogram of 0.1 ms buckets up to 100 ms, so
+ percentiles can be read without storing every sample.
+*/
+class Latency {
+private:
+  static const int BUCKETS = 1000;
+  long counts[BUCKETS + 1];
+  long samples;
+  double total;
+  double worst;
+
+public:
+  Latency();
+
+  /**
+   Adds a sample, in seconds.
+  */
+  void add(const double &seconds);
+
+  /**
+   @return: the latency, in seconds, that the given fraction of samples were
+   at or under. Samples past 100 ms all count as 100 ms.
+  */
+  double percentile(const double &fraction) const;
+
+  // Getters
+  long getSamples() const;
+  double getMean() const;
+  double getMax() const;
+};
+
+/**
+ Turns timestamped button events into board actions, one simulation tick at a
+ time, with delayed auto-shift and auto-repeat for the side moves.
+
+ Events are queued as they are seen and each tick consumes the ones stamped
+ up to its time, so inputs land on the tick they happened in no matter when
+ frames are drawn. A side move fires on press, then repeats once the button
+ has been held for DAS ticks, every ARR ticks after that. ARR 0 slides the
+ piece all the way to the wall at once. Soft drop repeats every tick.
+
+ It also measures how long inputs take to reach the game state and the screen.
+ The measurements are only as fine as the event timestamps: with frame-rate
+ stamps, a key that went down partway through a frame is counted from the
+ poll, so they can come out up to a frame short.
+*/
+class InputHandler {
+private:
+  /**
+   Events not consumed yet, in a ring. Full rings drop new events.
+  */
+  static const int CAPACITY = 256;
+  InputEvent events[CAPACITY];
+  int head;
+  int count;
+  /**
+   Auto-shift delay and repeat rate, in ticks.
+  */
+  int das;
+  int arr;
+  /**
+   # of cols on the board, as far as a slide can go.
+  */
+  int cols;
+  /**
+   Which buttons are down.
+  */
+  bool held[6];
+  /**
+   The side the piece is being shifted to (-1, 0 or 1), and for how many
+   ticks the button has been held.
+  */
+  int shift;
+  int shift_ticks;
+  /**
+   Ticks soft drop has been held for.
+  */
+  int down_ticks;
+  /**
+   The actions for the current tick. Reused, so ticks never allocate.
+  */
+  vector<ACTION> actions;
+  /**
+   When the presses consumed so far were seen, until they reach the state and
+   then the screen.
+  */
+  vector<double> to_state;
+  vector<double> to_present;
+  Latency state_latency;
+  Latency present_latency;
+
+  /**
+   Applies one event to the held buttons and queues the action it triggers.
+  */
+  void apply(const InputEvent &event);
+
+  /**
+   Queues one side move, or a slide to the wall when ARR is 0.
+  */
+  void shiftPiece();
+
+public:
+  /**
+   Public constructor.
+
+   @param das - Ticks a side button is held before it repeats. Defaults to Global::DAS
+   @param arr - Ticks between repeats, 0 for instant. Defaults to Global::ARR
+   @param cols - The number of cols on the board. Defaults to Global::COLS
+  */
+  InputHandler(const int &das = DAS, const int &arr = ARR, const int &cols = COLS);
+
+  /**
+   Queues a button going down or up at the given time.
+
+   @return: true if it was queued; false if the queue was full.
+  */
+  bool push(const double &time, const BUTTON &button, const bool &pressed);
+
+  /**
+   Runs one tick: consumes every event stamped up to time, then applies the
+   auto-repeat.
+
+   @return: the actions to feed the board for this tick, in order.
+  */
+  const vector<ACTION>& tick(const double &time);
+
+  /**
+   Marks the actions returned so far as applied to the board at the given time.
+  */
+  void markState(const double &time);
+
+  /**
+   Marks the state applied so far as shown on screen at the given time.
+  */
+  void markPresent(const double &time);
+
+  // Getters
+  const Latency& getStateLatency() const;
+  const Latency& getPresentLatency() const;
+};
+
+#endif /* Input_hpp */
@@ -0,0 +1,148 @@
+//
+//  MoveGenerator.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/14/21.
+//
+
+#include <algorithm>
+#include <cstring>
+#include "MoveGenerator.hpp"
+
+/**
+ How far past the edges of the board a pivot can be and still be tracked.
+ Pivots sit inside their piece, so 3 covers every orientation.
+*/
+static const int MARGIN = 3;
+
+// --- BEGIN PRIVATE ---
+
+/**
+ @return: the index of a piece's position in visited, or -1 if it is
+ outside the area the search covers.
+*/
+int MoveGenerator::key(const Piece &piece) const {
+  const int x = piece.getPivot().x + MARGIN;
+  const int y = piece.getPivot().y + MARGIN;
+  const int width = this->cols + 2 * MARGIN;
+  const int height = this->rows + 2 * MARGIN;
+  if (x < 0 || x >= width || y < 0 || y >= height)
+    return -1;
+
+  return (piece.getRotation() * height + y) * width + x;
+}
+
+/**
+ Adds a state to the queue if it hasn't been reached yet.
+*/
+void MoveGenerator::visit(const Piece &piece, const int &parent, const ACTION &action) {
+  const int k = this->key(piece);
+  if (k < 0 || this->visited[k])
+    return;
+
+  this->visited[k] = 1;
+  this->nodes.push_back({ piece, parent, action });
+}
+
+/**
+ Records a resting state as a placement unless one with the same cells
+ has already been found.
+*/
+void MoveGenerator::addPlacement(const int &node) {
+  const Footprint &f = this->nodes[node].piece.getFootprint();
+
+  // Symmetric orientations land on the same cells; keep the first (shortest)
+  for (const Placement &p : this->placements) {
+    const Footprint &other = p.piece.getFootprint();
+    if (other.top == f.top && !memcmp(other.rows, f.rows, sizeof(f.rows)))
+      return;
+  }
+
+  // Walk back to the start to recover the inputs, then put them in order
+  const int start = (int)this->paths.size();
+  for (int i = node; this->nodes[i].parent >= 0; i = this->nodes[i].parent)
+    this->paths.push_back(this->nodes[i].action);
+  std::reverse(this->paths.begin() + start, this->paths.end());
+
+  this->placements.push_back({ this->nodes[node].piece, start,
+                               (int)this->paths.size() - start });
+}
+
+// --- END PRIVATE ---
+
+// --- BEGIN PUBLIC ---
+
+/**
+ Public constructor. Buffers are sized on the first call.
+*/
+MoveGenerator::MoveGenerator() {
+  this->rows = 0;
+  this->cols = 0;
+}
+
+/**
+ Finds every placement reachable from the given piece. Replaces the results
+ of the previous call.
+
+ @return: the placements found.
+*/
+const vector<Placement>& MoveGenerator::generate(const Bitboard &board, const Piece &start) {
+  // Size the visited table for this board
+  if (board.getRows() != this->rows || board.getCols() != this->cols) {
+    this->rows = board.getRows();
+    this->cols = board.getCols();
+    this->visited.resize(4 * (this->rows + 2 * MARGIN) * (this->cols + 2 * MARGIN));
+  }
+  std::fill(this->visited.begin(), this->visited.end(), 0);
+  this->nodes.clear();
+  this->placements.clear();
+  this->paths.clear();
+
+  // Nothing is reachable if the piece doesn't fit to begin with
+  if (start.collides(board))
+    return this->placements;
+  this->visit(start, -1, TICK);
+
+  // BFS. nodes can grow while we loop, so work on a copy of each piece.
+  for (int i = 0; i < (int)this->nodes.size(); i++) {
+    const Piece current = this->nodes[i].piece;
+    Piece next = current;
+
+    if (next.left(board))
+      this->visit(next, i, MOVE_LEFT);
+    next = current;
+    if (next.right(board))
+      this->visit(next, i, MOVE_RIGHT);
+    next = current;
+    if (next.down(board))
+      this->visit(next, i, MOVE_DOWN);
+    else
+      this->addPlacement(i);
+    next = current;
+    if (next.rotateClockwise(board))
+      this->visit(next, i, ROTATE_CW);
+    next = current;
+    if (next.rotateCounterClockwise(board))
+      this->visit(next, i, ROTATE_CCW);
+  }
+
+  return this->placements;
+}
+
+/**
+ Finds every placement reachable from a piece of the given type at its
+ spawn position.
+*/
+const vector<Placement>& MoveGenerator::generate(const Bitboard &board, const PIECE_TYPE &type) {
+  return this->generate(board, Piece(type, board.getRows(), board.getCols()));
+}
+
+/**
+ Gets the inputs that take the piece from the start to the placement.
+*/
+Path MoveGenerator::getPath(const Placement &placement) const {
+  const ACTION *first = this->paths.data() + placement.path;
+  return { first, first + placement.length };
+}
+
+// --- END PUBLIC ---
@@ -0,0 +1,129 @@
+//
+//  MoveGenerator.hpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/14/21.
+//
+
+#ifndef MoveGenerator_hpp
+#define MoveGenerator_hpp
+
+#include <vector>
+#include "Bitboard.hpp"
+#include "Piece.hpp"
+#include "Board.hpp"
+
+using std::vector;
+
+/**
+ A place a piece can come to rest, and where to find the inputs that get it
+ there in the generator's path buffer.
+*/
+struct Placement {
+  /**
+   The piece in its resting position. Follow the path with HARD_DROP to lock it.
+  */
+  Piece piece;
+  /**
+   Offset and length of the path in MoveGenerator::paths.
+  */
+  int path;
+  int length;
+};
+
+/**
+ A range of actions, usable in a range-based for loop.
+*/
+struct Path {
+  const ACTION *first;
+  const ACTION *last;
+
+  const ACTION* begin() const { return first; }
+  const ACTION* end() const { return last; }
+  int size() const { return (int)(last - first); }
+};
+
+/**
+ Finds every distinct resting placement a piece can reach from where it is,
+ using the same left/right/down/rotate moves as the game. Runs a BFS over
+ (x, y, rotation), so every path is as short as possible. Placements that cover
+ the same cells (symmetric orientations of I, S, Z and O) are only reported
+ once. Buffers are kept between calls, so it stops allocating once warm.
+*/
+class MoveGenerator {
+private:
+  /**
+   A state in the search, and how it was reached.
+  */
+  struct Node {
+    Piece piece;
+    int parent;
+    ACTION action;
+  };
+
+  /**
+   Dimensions of the board the buffers are sized for.
+  */
+  int rows;
+  int cols;
+  /**
+   Every state reached, in BFS order. Doubles as the queue.
+  */
+  vector<Node> nodes;
+  /**
+   Marks states already reached, indexed by key().
+  */
+  vector<uint8_t> visited;
+  /**
+   Results of the last call.
+  */
+  vector<Placement> placements;
+  /**
+   The paths of every placement, back to back.
+  */
+  vector<ACTION> paths;
+
+  /**
+   @return: the index of a piece's position in visited, or -1 if it is
+   outside the area the search covers.
+  */
+  int key(const Piece &piece) const;
+
+  /**
+   Adds a state to the queue if it hasn't been reached yet.
+  */
+  void visit(const Piece &piece, const int &parent, const ACTION &action);
+
+  /**
+   Records a resting state as a placement unless one with the same cells
+   has already been found.
+  */
+  void addPlacement(const int &node);
+
+public:
+  /**
+   Public constructor.
+  */
+  MoveGenerator();
+
+  /**
+   Finds every placement reachable from the given piece. Replaces the results
+   of the previous call.
+
+   @return: the placements found.
+  */
+  const vector<Placement>& generate(const Bitboard &board, const Piece &start);
+
+  /**
+   Finds every placement reachable from a piece of the given type at its
+   spawn position.
+  */
+  const vector<Placement>& generate(const Bitboard &board, const PIECE_TYPE &type);
+
+  /**
+   Gets the inputs that take the piece from the start to the placement.
+  */
+  Path getPath(const Placement &placement) const;
+};
+
+#endif /* MoveGenerator_hpp */
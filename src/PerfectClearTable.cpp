@@ -0,0 +1,219 @@
+//
+//  PerfectClearTable.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/25/21.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "PerfectClearTable.hpp"
+
+// --- BEGIN PUBLIC ---
+
+/**
+ @return: the key for a field and the first count pieces of a sequence: the
+ field in the low 40 bits, then the count, then 3 bits per piece.
+*/
+uint64_t PerfectClearTable::key(const uint64_t &field, const PIECE_TYPE *pieces, const int &count) {
+  uint64_t key = field | uint64_t(count) << 40;
+  for (int i = 0; i < count; i++)
+    key |= uint64_t(pieces[i]) << (43 + 3 * i);
+  return key;
+}
+
+/**
+ @return: the slot a key starts probing from, before masking. Keys differ
+ mostly in their low bits, so they are mixed first.
+*/
+uint64_t PerfectClearTable::hash(const uint64_t &key) {
+  uint64_t x = key;
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ull;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBull;
+  x ^= x >> 31;
+  return x;
+}
+
+/**
+ @return: the field covered by a footprint on a board with the given # of
+ rows, or 0 if any of it is above the bottom 4 rows.
+*/
+uint64_t PerfectClearTable::cells(const Footprint &f, const int &rows) {
+  uint64_t field = 0;
+  for (int i = 0; i < 4; i++) {
+    if (f.rows[i] == 0)
+      continue;
+    const int r = rows - 1 - (f.top + i);
+    if (r < 0 || r >= PerfectClearTable::FIELD_ROWS)
+      return 0;
+    field |= ((f.rows[i] >> 1) & 0x3FF) << (PerfectClearTable::FIELD_COLS * r);
+  }
+  return field;
+}
+
+/**
+ Public constructor. The table starts closed.
+*/
+PerfectClearTable::PerfectClearTable() {
+  this->header = nullptr;
+  this->entries = nullptr;
+  this->data = nullptr;
+  this->length = 0;
+  this->mask = 0;
+}
+
+/**
+ Unmaps the file, if one is open.
+*/
+PerfectClearTable::~PerfectClearTable() {
+  this->close();
+}
+
+/**
+ Maps a table file, closing the one open before. Checks the header and that
+ the file is exactly as long as it says, so a lookup never reads past it.
+
+ @return: true if the file is a valid table; false otherwise.
+*/
+bool PerfectClearTable::open(const string &path) {
+  this->close();
+
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(PerfectClearHeader)) {
+    ::close(fd);
+    return false;
+  }
+
+  void *data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping keeps the file alive on its own
+  ::close(fd);
+  if (data == MAP_FAILED)
+    return false;
+
+  const PerfectClearHeader *header = (const PerfectClearHeader *)data;
+  const uint64_t slots = header->slots;
+  const bool valid = memcmp(header->magic, "TPCT", 4) == 0 &&
+                     header->version == PerfectClearTable::VERSION &&
+                     header->rows == (uint32_t)PerfectClearTable::FIELD_ROWS &&
+                     header->cols == (uint32_t)PerfectClearTable::FIELD_COLS &&
+                     header->max_pieces <= (uint32_t)PerfectClearTable::MAX_PIECES &&
+                     slots > 0 && (slots & (slots - 1)) == 0 && header->entries < slots &&
+                     (size_t)info.st_size == sizeof(PerfectClearHeader) + slots * sizeof(PerfectClearEntry);
+  if (!valid) {
+    munmap(data, (size_t)info.st_size);
+    return false;
+  }
+
+  this->data = data;
+  this->length = (size_t)info.st_size;
+  this->header = header;
+  this->entries = (const PerfectClearEntry *)(header + 1);
+  this->mask = slots - 1;
+  return true;
+}
+
+/**
+ Unmaps the file.
+*/
+void PerfectClearTable::close() {
+  if (this->data)
+    munmap(this->data, this->length);
+  this->header = nullptr;
+  this->entries = nullptr;
+  this->data = nullptr;
+  this->length = 0;
+  this->mask = 0;
+}
+
+/**
+ Looks up one key. The table is at most half full, so a probe ends at an
+ empty slot after a step or two. The header's count isn't proof of that, so
+ a damaged file with no empty slot stops after every slot has been looked at.
+
+ @return: true if it is in the table, with the first placement in move;
+ false otherwise.
+*/
+bool PerfectClearTable::find(const uint64_t &key, uint64_t &move) const {
+  if (!this->entries)
+    return false;
+
+  uint64_t i = PerfectClearTable::hash(key) & this->mask;
+  for (uint64_t probes = 0; probes <= this->mask; probes++, i = (i + 1) & this->mask) {
+    const PerfectClearEntry &entry = this->entries[i];
+    if (entry.key == key) {
+      move = entry.move;
+      return true;
+    }
+    if (entry.key == 0)
+      return false;
+  }
+  return false;
+}
+
+/**
+ Looks for the shortest perfect clear of the board using the first pieces of
+ the sequence. Each piece adds 4 cells, so only the lengths that make up a
+ whole number of rows, at least as many as the stack is tall, are tried.
+
+ @return: true if there is one, with the cells of the first placement in move
+ and the # of pieces it takes in used; false otherwise.
+*/
+bool PerfectClearTable::lookup(const Bitboard &board, const PIECE_TYPE *pieces, const int &count,
+                               uint64_t &move, int &used) const {
+  if (!this->header || board.getCols() != PerfectClearTable::FIELD_COLS)
+    return false;
+  for (int col = 0; col < board.getCols(); col++)
+    if (board.getHeight(col) > PerfectClearTable::FIELD_ROWS)
+      return false;
+
+  uint64_t field = 0;
+  int height = 0;
+  for (int r = 0; r < PerfectClearTable::FIELD_ROWS; r++) {
+    const uint64_t row = (board.getRow(board.getRows() - 1 - r) >> 1) & 0x3FF;
+    field |= row << (PerfectClearTable::FIELD_COLS * r);
+    if (row)
+      height = r + 1;
+  }
+
+  const int filled = __builtin_popcountll(field);
+  const int longest = std::min(count, (int)this->header->max_pieces);
+  for (int k = 1; k <= longest; k++) {
+    const int total = filled + 4 * k;
+    if (total % PerfectClearTable::FIELD_COLS != 0)
+      continue;
+    if (total / PerfectClearTable::FIELD_COLS < height)
+      continue;
+    if (this->find(PerfectClearTable::key(field, pieces, k), move)) {
+      used = k;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Checks if a table is open
+bool PerfectClearTable::isOpen() const {
+  return this->header != nullptr;
+}
+
+// Gets the longest piece sequence in the table
+int PerfectClearTable::getMaxPieces() const {
+  return this->header ? (int)this->header->max_pieces : 0;
+}
+
+// Gets the number of positions in the table
+uint64_t PerfectClearTable::getEntries() const {
+  return this->header ? this->header->entries : 0;
+}
+
+// --- END PUBLIC ---
@@ -0,0 +1,146 @@
+//
+//  PerfectClearTable.hpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/25/21.
+//
+
+#ifndef PerfectClearTable_hpp
+#define PerfectClearTable_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "Bitboard.hpp"
+#include "PieceTable.hpp"
+
+using std::string;
+
+/**
+ Start of a perfect-clear table file. The entries follow it directly, as an
+ open-addressed hash table of `slots` entries (a power of two).
+*/
+struct PerfectClearHeader {
+  char magic[4];
+  uint32_t version;
+  /**
+   Size of the field the table covers: the bottom `rows` rows of a board
+   `cols` wide.
+  */
+  uint32_t rows;
+  uint32_t cols;
+  /**
+   Longest piece sequence stored.
+  */
+  uint32_t max_pieces;
+  uint32_t reserved;
+  uint64_t slots;
+  uint64_t entries;
+};
+
+/**
+ One solved position. key is a field and piece sequence as built by
+ PerfectClearTable::key(), 0 for an empty slot. move is the cells of the first
+ placement, in the same layout as the field.
+*/
+struct PerfectClearEntry {
+  uint64_t key;
+  uint64_t move;
+};
+
+/**
+ Answers "can this stack be perfect-cleared with these pieces, and where does
+ the first one go" with one hash probe into a table built offline by
+ tools/PerfectClears.cpp.
+
+ A field is the bottom 4 rows of a 10 column board as a 40-bit mask, row r
+ from the bottom at bits 10r to 10r + 9. A sequence is solved if placing its
+ pieces in order, each one reachable with the game's own moves and locked
+ entirely inside the bottom 4 rows, leaves the board empty.
+
+ The file is mapped read-only rather than read, so opening it is instant
+ whatever its size, and every process using the same file shares its pages.
+*/
+class PerfectClearTable {
+private:
+  const PerfectClearHeader *header;
+  const PerfectClearEntry *entries;
+  void *data;
+  size_t length;
+  uint64_t mask;
+
+public:
+  static const uint32_t VERSION = 1;
+  /**
+   Size of the field, and the longest sequence a key can hold.
+  */
+  static const int FIELD_ROWS = 4;
+  static const int FIELD_COLS = 10;
+  static const int MAX_PIECES = 7;
+
+  /**
+   @return: the key for a field and the first count pieces of a sequence.
+  */
+  static uint64_t key(const uint64_t &field, const PIECE_TYPE *pieces, const int &count);
+
+  /**
+   @return: the slot a key starts probing from, before masking.
+  */
+  static uint64_t hash(const uint64_t &key);
+
+  /**
+   @return: the field covered by a footprint on a board with the given # of
+   rows, or 0 if any of it is above the bottom 4 rows.
+  */
+  static uint64_t cells(const Footprint &f, const int &rows);
+
+  /**
+   Public constructor. The table starts closed.
+  */
+  PerfectClearTable();
+
+  /**
+   Unmaps the file, if one is open.
+  */
+  ~PerfectClearTable();
+
+  PerfectClearTable(const PerfectClearTable &) = delete;
+  PerfectClearTable& operator=(const PerfectClearTable &) = delete;
+
+  /**
+   Maps a table file, closing the one open before.
+
+   @return: true if the file is a valid table; false otherwise.
+  */
+  bool open(const string &path);
+
+  /**
+   Unmaps the file.
+  */
+  void close();
+
+  /**
+   Looks up one key.
+
+   @return: true if it is in the table, with the first placement in move;
+   false otherwise.
+  */
+  bool find(const uint64_t &key, uint64_t &move) const;
+
+  /**
+   Looks for the shortest perfect clear of the board using the first pieces of
+   the sequence, trying only the lengths that fill whole rows.
+
+   @return: true if there is one, with the cells of the first placement in
+   move and the # of pieces it takes in used; false otherwise.
+  */
+  bool lookup(const Bitboard &board, const PIECE_TYPE *pieces, const int &count,
+              uint64_t &move, int &used) const;
+
+  // Getters
+  bool isOpen() const;
+  int getMaxPieces() const;
+  uint64_t getEntries() const;
+};
+
+#endif /* PerfectClearTable_hpp */
@@ -5,230 +5,343 @@
 //  Created by Andy Mina on 5/4/21.
 //
 
+#include <algorithm>
 #include "Piece.hpp"
 
 // --- BEGIN PRIVATE ---
 
+// The helpers that differ by row store run on every move the game or a search
+// tries and are only used in this file, so they are inline.
+
 /**
- Translate piece left by 1 block.
+ Builds the row masks for an orientation with its pivot at the given spot.
+*/
+template <>
+inline void Piece::makeFootprint(const int &rotation, const Point &pivot, Footprint &f) const {
+  const Shape &shape = SHAPES.shapes[this->type][rotation];
+
+  // Shift the precomputed masks into place
+  f.top = pivot.y + shape.top;
+  for (int i = 0; i < 4; i++)
+    f.rows[i] = shape.rows[i] << (pivot.x + shape.left + 1);
+}
+
+/**
+ Builds the row masks for an orientation at the left edge, with bit 1 as its
+ leftmost column. The board shifts them to origin() on every test.
+*/
+template <>
+inline void WidePiece::makeFootprint(const int &rotation, const Point &pivot, Footprint &f) const {
+  const Shape &shape = SHAPES.shapes[this->type][rotation];
+
+  f.top = pivot.y + shape.top;
+  for (int i = 0; i < 4; i++)
+    f.rows[i] = shape.rows[i] << 1;
+}
+
+/**
+ Anything past the walls can't be represented in a row mask, so it has to be
+ ruled out before the footprint is built.
+ @return: true if it fits; false otherwise.
+*/
+template <>
+inline bool Piece::fits(const Bitboard &board, const int &rotation, const Point &pivot,
+                 Footprint &f) const {
+  const Shape &shape = SHAPES.shapes[this->type][rotation];
+  if (pivot.x + shape.left < 0 || pivot.x + shape.right >= board.getCols())
+    return false;
+
+  this->makeFootprint(rotation, pivot, f);
+  return !board.collides(f);
+}
+
+/**
+ The board checks the walls itself, wherever the origin is.
+ @return: true if it fits; false otherwise.
+*/
+template <>
+inline bool WidePiece::fits(const WideBitboard &board, const int &rotation, const Point &pivot,
+                     Footprint &f) const {
+  this->makeFootprint(rotation, pivot, f);
+  return !board.collides(f, pivot.x + SHAPES.shapes[this->type][rotation].left);
+}
+
+/**
+ Tests the whole piece against the board at once, then moves the pivot and
+ the footprint with it.
  @return: true if the piece was moved; false otherwise.
 */
-bool Piece::left() {
-  // Create a copy of the current blocks to be updated
-  vector<Block> updated = this->blocks;
-  
-  // Move each block. If it can't be moved, return false.
-  for (Block &b : updated) {
-    if (!b.left(this->board))
-      return false;
-  }
+template <>
+inline bool Piece::shift(const Bitboard &board, const int &dx, const int &dy) {
+  if (board.collides(this->footprint, dx, dy))
+    return false;
 
-  // Update the current group of blocks and return true
-  this->blocks = updated;
+  this->pivot.x += dx;
+  this->pivot.y += dy;
+  this->footprint.top += dy;
+  for (uint64_t &row : this->footprint.rows)
+    row = dx >= 0 ? row << dx : row >> -dx;
   return true;
 }
 
 /**
- Translate piece right by 1 block.
+ The footprint stays at the left edge, so only the pivot moves sideways.
  @return: true if the piece was moved; false otherwise.
 */
-bool Piece::right() {
-  // Create a copy of the current blocks to be updated
-  vector<Block> updated = this->blocks;
-  
-  // Move each block. If it can't be moved, return false.
-  for (Block &b : updated)
-    if (!b.right(this->board))
-      return false;
-  
-  // Update the current group of blocks and return true
-  this->blocks = updated;
+template <>
+inline bool WidePiece::shift(const WideBitboard &board, const int &dx, const int &dy) {
+  if (board.collides(this->footprint, this->origin() + dx, dy))
+    return false;
+
+  this->pivot.x += dx;
+  this->pivot.y += dy;
+  this->footprint.top += dy;
   return true;
 }
 
+/**
+ @return: the column the footprint's leftmost cell is on.
+*/
+template <class Stack>
+int BasicPiece<Stack>::origin() const {
+  return this->pivot.x + SHAPES.shapes[this->type][this->rotation].left;
+}
+
+/**
+ Rotates the piece using the kick table for its type. Tries the new orientation
+ at each kick offset in order and keeps the first one that fits. O_BLOCKs dont
+ rotate.
+ @return: true if the piece was rotated; false otherwise.
+*/
+template <class Stack>
+template <PIECE_TYPE T>
+bool BasicPiece<Stack>::rotate(const Stack &board, const int &dir) {
+  if (T == O_BLOCK)
+    return false;
+
+  const int target = (this->rotation + (dir ? 3 : 1)) & 3;
+  const Point (&kicks)[5] = kicksFor<T>()[this->rotation][dir];
+
+  for (const Point &kick : kicks) {
+    // Try the move without touching the piece; only commit if it fits
+    const Point moved = { this->pivot.x + kick.x, this->pivot.y + kick.y };
+    Footprint f;
+    if (this->fits(board, target, moved, f)) {
+      this->rotation = target;
+      this->pivot = moved;
+      this->footprint = f;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ rotate<T> for every piece type, indexed by <PIECE_TYPE>.
+*/
+template <class Stack>
+bool (BasicPiece<Stack>::* const BasicPiece<Stack>::ROTATORS[7])(const Stack &, const int &) = {
+  &BasicPiece::rotate<I_BLOCK>, &BasicPiece::rotate<O_BLOCK>,
+  &BasicPiece::rotate<J_BLOCK>, &BasicPiece::rotate<L_BLOCK>,
+  &BasicPiece::rotate<S_BLOCK>, &BasicPiece::rotate<Z_BLOCK>,
+  &BasicPiece::rotate<T_BLOCK>
+};
+
+// --- BEGIN PUBLIC ---
+
+/**
+ Public constructor. Puts the piece at its spawn position.
+
+ @param type - The type of piece to spawn.
+ @param rows - The number of rows on the board. Defaults to Global::ROWS
+ @param cols - The number of cols on the board. Defaults to Global::COLS
+*/
+template <class Stack>
+BasicPiece<Stack>::BasicPiece(const PIECE_TYPE &type, const int &rows, const int &cols) {
+  // Set the piece type and its color
+  this->type = type;
+  this->color = type + 1;
+  this->rotator = BasicPiece::ROTATORS[type];
+
+  // Set the starting position from the spawn table, which is laid out for a
+  // standard board. Wider boards keep the piece centered, and taller ones
+  // spawn it in the two hidden rows just above the visible field.
+  this->rotation = 0;
+  this->pivot = SPAWN_PIVOTS[type];
+  this->pivot.x += (cols - COLS) / 2;
+  this->pivot.y += std::max(rows - ROWS - 2, 0);
+  this->makeFootprint(this->rotation, this->pivot, this->footprint);
+}
+
+/**
+ Public constructor. Puts the piece in the given orientation with its pivot at
+ the given spot, e.g. when restoring a saved game.
+*/
+template <class Stack>
+BasicPiece<Stack>::BasicPiece(const PIECE_TYPE &type, const int &rotation, const Point &pivot) {
+  this->type = type;
+  this->color = type + 1;
+  this->rotator = BasicPiece::ROTATORS[type];
+
+  this->rotation = rotation;
+  this->pivot = pivot;
+  this->makeFootprint(this->rotation, this->pivot, this->footprint);
+}
+
+/**
+ Translate piece left by 1 block.
+ @return: true if the piece was moved; false otherwise.
+*/
+template <class Stack>
+bool BasicPiece<Stack>::left(const Stack &board) {
+  return this->shift(board, -1, 0);
+}
+
+/**
+ Translate piece right by 1 block.
+ @return: true if the piece was moved; false otherwise.
+*/
+template <class Stack>
+bool BasicPiece<Stack>::right(const Stack &board) {
+  return this->shift(board, 1, 0);
+}
+
 /**
  Translate piece down by 1 block.
  @return: true if the piece was moved; false otherwise.
 */
-bool Piece::down() {
-  // Create a copy of the current blocks to be updated
-  vector<Block> updated = this->blocks;
-  
-  // Move each block. If it can't be moved, return false.
-  for (Block &b : updated)
-    if (!b.down(this->board))
-      return false;
-  
-  // Update the current group of blocks and return true
-  this->blocks = updated;
-  return true;
+template <class Stack>
+bool BasicPiece<Stack>::down(const Stack &board) {
+  return this->shift(board, 0, 1);
 }
 
 /**
  Rotate the piece clockwise.
  @return: true if the piece was rotated; false otherwise.
 */
-bool Piece::rotateClockwise() {
-  // Create a new updated position
-  vector<Block> updated = this->blocks;
-  // Define the center of rotation
-  Block &center = updated[1];
-  
-  // Perform the geometric rotation on every block.
-  for (Block &b : updated)
-    if (!b.rotateCW(center, this->board))
-      return false;
-  
-  // Update the blocks
-  this->blocks = updated;
-  return true;
+template <class Stack>
+bool BasicPiece<Stack>::rotateClockwise(const Stack &board) {
+  return (this->*rotator)(board, 0);
 }
 
 /**
  Rotate the piece counter-clockwise.
  @return: true if the piece was rotated; false otherwise.
 */
-bool Piece::rotateCounterClockwise() {
-  // Create a new updated position
-  vector<Block> updated = this->blocks;
-  // Define the center of rotation
-  Block &center = updated[1];
-  
-  // Perform the geometric rotation on every block.
-  for (Block &b : updated)
-    if (!b.rotateCCW(center, this->board))
-      return false;
-  
-  // Update the blocks
-  this->blocks = updated;
-  return true;
+template <class Stack>
+bool BasicPiece<Stack>::rotateCounterClockwise(const Stack &board) {
+  return (this->*rotator)(board, 1);
 }
 
-// --- END PRIVATE ---
+/**
+ Checks if the piece overlaps anything on the board where it is now.
+*/
+template <>
+bool Piece::collides(const Bitboard &board) const {
+  return board.collides(this->footprint);
+}
 
-// --- BEGIN PUBLIC ---
+template <>
+bool WidePiece::collides(const WideBitboard &board) const {
+  return board.collides(this->footprint, this->origin());
+}
 
 /**
- Public constructor.
- 
- @param b - A const ref to the current state of the board. Used in transformations.
+ @return: how many rows the piece can drop before it lands.
 */
-Piece::Piece(vector<vector<Block>> &b, const PIECE_TYPE &type): board(b) {
-  // Generate a random piece type
-  this->type = type;
-  
-  // Set the starting position for each piece
-  switch (this->type) {
-    case I_BLOCK:
-      this->color = SKYBLUE;
-      this->blocks = {
-        Block({ 5, 0 }, this->color),
-        Block({ 5, 1 }, this->color),
-        Block({ 5, 2 }, this->color),
-        Block({ 5, 3 }, this->color)
-      };
-      break;
-      
-    case O_BLOCK:
-      this->color = YELLOW;
-      this->blocks = {
-        Block({ 4, 0 }, this->color),
-        Block({ 4, 1 }, this->color),
-        Block({ 5, 0 }, this->color),
-        Block({ 5, 1 }, this->color)
-      };
-      break;
-  
-    case J_BLOCK:
-      this->color = BLUE;
-      this->blocks = {
-        Block({ 5, 0 }, this->color),
-        Block({ 5, 1 }, this->color),
-        Block({ 5, 2 }, this->color),
-        Block({ 4, 2 }, this->color)
-      };
-      break;
-      
-    case L_BLOCK:
-      this->color = ORANGE;
-      this->blocks = {
-        Block({ 4, 0 }, this->color),
-        Block({ 4, 1 }, this->color),
-        Block({ 4, 2 }, this->color),
-        Block({ 5, 2 }, this->color)
-      };
-      break;
-    
-    case S_BLOCK:
-      this->color = GREEN;
-      this->blocks = {
-        Block({ 4, 0 }, this->color),
-        Block({ 4, 1 }, this->color),
-        Block({ 5, 1 }, this->color),
-        Block({ 5, 2 }, this->color)
-      };
-      break;
-    
-    case Z_BLOCK:
-      this->color = RED;
-      this->blocks = {
-        Block({ 5, 0 }, this->color),
-        Block({ 5, 1 }, this->color),
-        Block({ 4, 1 }, this->color),
-        Block({ 4, 2 }, this->color)
-      };
-      break;
-      
-    case T_BLOCK:
-      this->color = PURPLE;
-      this->blocks = {
-        Block({ 4, 0 }, this->color),
-        Block({ 3, 1 }, this->color),
-        Block({ 4, 1 }, this->color),
-        Block({ 5, 1 }, this->color)
-      };
-      break;
-  }
+template <>
+int Piece::dropDistance(const Bitboard &board) const {
+  return board.dropDistance(this->footprint);
+}
+
+template <>
+int WidePiece::dropDistance(const WideBitboard &board) const {
+  return board.dropDistance(this->footprint, this->origin());
 }
 
 /**
- Allows the piece to be updated by user input. User can use LEFT to move left,
- RIGHT to move right, DOWN to move down, Z to rotate counter-clockwise, and
- X or UP to rotate clockwise.
- */
-void Piece::update() {
-  // Translations
-  if (IsKeyPressed(KEY_LEFT)) this->left();
-  if (IsKeyPressed(KEY_RIGHT)) this->right();
-  if (IsKeyPressed(KEY_DOWN)) this->down();
-  // Rotations - O_BLOCKs dont rotate
-  if (this->type != O_BLOCK && (IsKeyPressed(KEY_UP) || IsKeyPressed(KEY_X)))
-    this->rotateClockwise();
-  if (this->type != O_BLOCK && IsKeyPressed(KEY_Z))
-    this->rotateCounterClockwise();
-}
-
-/**
- Allows the piece to fall. Simulates gravity. If the piece has failed to fall,
- more than three times it should be locked.
- 
- @return: true if the piece fell, false otherwise
+ Allows the piece to fall up to the given # of rows. Simulates gravity.
+
+ @return: the # of rows the piece fell.
  */
-bool Piece::fall() {
-  return this->down();
+template <class Stack>
+int BasicPiece<Stack>::fall(const Stack &board, const int &rows) {
+  const int fallen = std::min(rows, this->dropDistance(board));
+  this->pivot.y += fallen;
+  this->footprint.top += fallen;
+  return fallen;
+}
+
+/**
+ Fills the cells the piece covers on the board, in its color where the board
+ keeps colors.
+*/
+template <>
+void Piece::place(Bitboard &board) const {
+  board.place(this->footprint, this->color);
+}
+
+template <>
+void WidePiece::place(WideBitboard &board) const {
+  board.place(this->footprint, this->origin());
 }
 
 /**
  Gets the blocks of this piece
 */
-vector<Block> Piece::getBlocks() {
-  return this->blocks;
+template <class Stack>
+array<Block, 4> BasicPiece<Stack>::getBlocks() const {
+  const Shape &shape = SHAPES.shapes[this->type][this->rotation];
+
+  array<Block, 4> blocks;
+  for (int i = 0; i < 4; i++)
+    blocks[i] = Block({ this->pivot.x + shape.cells[i].x, this->pivot.y + shape.cells[i].y },
+                      this->color);
+  return blocks;
+}
+
+/**
+ Gets the type of this piece
+*/
+template <class Stack>
+PIECE_TYPE BasicPiece<Stack>::getType() const {
+  return this->type;
+}
+
+/**
+ Gets the orientation of this piece, 0-3
+*/
+template <class Stack>
+int BasicPiece<Stack>::getRotation() const {
+  return this->rotation;
+}
+
+/**
+ Gets the position of the pivot
+*/
+template <class Stack>
+const Point& BasicPiece<Stack>::getPivot() const {
+  return this->pivot;
 }
 
 /**
- Draws the piece on the screen at its current position.
+ Gets the cells covered by this piece as row masks
 */
-void Piece::draw() {
-  for (Block const &b : this->blocks)
-    b.draw();
+template <class Stack>
+const Footprint& BasicPiece<Stack>::getFootprint() const {
+  return this->footprint;
 }
+
+/**
+ Gets the color id of this piece
+*/
+template <class Stack>
+uint8_t BasicPiece<Stack>::getColor() const {
+  return this->color;
+}
+
+// --- END PUBLIC ---
+
+template class BasicPiece<Bitboard>;
+template class BasicPiece<WideBitboard>;
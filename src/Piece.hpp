@@ -8,109 +8,199 @@
 #ifndef Piece_hpp
 #define Piece_hpp
 
+#include <array>
 #include <vector>
 #include <random>
-#include "raylib.h"
 #include "Global.hpp"
 #include "Block.hpp"
+#include "Bitboard.hpp"
+#include "PieceTable.hpp"
+#include "WideBitboard.hpp"
 
+using std::array;
 using std::vector;
 using std::cout; using std::endl;
 using std::to_string;
 
-// Enums to define which type of piece
-enum PIECE_TYPE {
-  I_BLOCK, O_BLOCK,
-  J_BLOCK, L_BLOCK,
-  S_BLOCK, Z_BLOCK,
-  T_BLOCK
-};
-
-class Piece {
+/**
+ The active piece. Small and copyable: it holds no pointers into the board, so
+ every move takes the board it is being tested against. The rules are the same
+ whatever holds the stack; Stack is the row store, a <Bitboard> for <Piece> or
+ a <WideBitboard> for <WidePiece>. On a <Bitboard> the footprint sits at the
+ piece's columns; a <WideBitboard> row doesn't fit in a word, so there it is
+ built at the left edge and shifted to origin() by the board.
+*/
+template <class Stack>
+class BasicPiece {
 private:
   /**
-   Each piece is made up of four <Blocks> arranged in different ways.
-   Holds all of the <Blocks> together.
+   The cells covered by the piece, as row masks. Kept in sync with the position
+   so moves can be tested against the board with a few ANDs.
   */
-  vector<Block> blocks;
-  /**
-   The state of the board this piece is being rendered on.
-  */
-  vector<vector<Block>> &board;
+  Footprint footprint;
   /**
    Type of piece
   */
   PIECE_TYPE type;
   /**
-   The color of the piece.
+   Index into SHAPES[type] of the current orientation.
+  */
+  int rotation;
+  /**
+   Position of the pivot on the board. The cells are SHAPES offsets from it.
+  */
+  Point pivot;
+  /**
+   The color id of the piece.
+  */
+  uint8_t color;
+  /**
+   rotate<type>, picked once when the piece is created.
+  */
+  bool (BasicPiece::*rotator)(const Stack &board, const int &dir);
+
+  /**
+   Builds the row masks for an orientation with its pivot at the given spot.
+  */
+  void makeFootprint(const int &rotation, const Point &pivot, Footprint &f) const;
+
+  /**
+   Builds the footprint for an orientation with its pivot at the given spot
+   into f, if the piece fits there.
+
+   @return: true if it fits; false otherwise.
+  */
+  bool fits(const Stack &board, const int &rotation, const Point &pivot, Footprint &f) const;
+
+  /**
+   Moves the piece by (dx, dy), if it fits there. dx is -1, 0 or 1.
+
+   @return: true if the piece was moved; false otherwise.
+  */
+  bool shift(const Stack &board, const int &dx, const int &dy);
+
+  /**
+   @return: the column the footprint's leftmost cell is on.
+  */
+  int origin() const;
+
+  /**
+   Rotates the piece using the kick table for its type. dir is 0 for clockwise
+   and 1 for counter-clockwise.
+
+   @return: true if the piece was rotated; false otherwise.
+  */
+  template <PIECE_TYPE T>
+  bool rotate(const Stack &board, const int &dir);
+
+  /**
+   rotate<T> for every piece type, indexed by <PIECE_TYPE>.
+  */
+  static bool (BasicPiece::* const ROTATORS[7])(const Stack &board, const int &dir);
+
+public:
+  /**
+   Public constructor. Puts the piece at its spawn position on a board of the
+   given size: centered, and in the hidden rows of a board taller than ROWS.
   */
-  Color color;
-  
+  BasicPiece(const PIECE_TYPE &type = I_BLOCK, const int &rows = ROWS, const int &cols = COLS);
+
+  /**
+   Public constructor. Puts the piece in the given orientation with its pivot
+   at the given spot, without checking it against any board.
+  */
+  BasicPiece(const PIECE_TYPE &type, const int &rotation, const Point &pivot);
+
   /**
    Translate piece left by 1 block.
-   
+
    @return: true if the piece was moved; false otherwise.
   */
-  bool left();
-  
+  bool left(const Stack &board);
+
   /**
    Translate piece right by 1 block.
-   
+
    @return: true if the piece was moved; false otherwise.
   */
-  bool right();
-  
+  bool right(const Stack &board);
+
   /**
    Translate piece down by 1 block.
-   
+
    @return: true if the piece was moved; false otherwise.
   */
-  bool down();
-  
+  bool down(const Stack &board);
+
   /**
    Rotate the piece clockwise.
-   
+
    @return: true if the piece was rotated; false otherwise.
   */
-  bool rotateClockwise();
-  
+  bool rotateClockwise(const Stack &board);
+
   /**
    Rotate the piece counter-clockwise.
-   
+
    @return: true if the piece was rotated; false otherwise.
   */
-  bool rotateCounterClockwise();
-  
-public:
+  bool rotateCounterClockwise(const Stack &board);
+
   /**
-   Public constructor.
+   Checks if the piece overlaps anything on the board where it is now.
   */
-  Piece(vector<vector<Block>> &b, const PIECE_TYPE &type);
-  
+  bool collides(const Stack &board) const;
+
   /**
-   Allows the piece to be updated by user input. User can use LEFT to move left,
-   RIGHT to move right, DOWN to move down, Z to rotate counter-clockwise, and
-   X or UP to rotate clockwise.
+   Allows the piece to fall up to the given # of rows. Simulates gravity: asks
+   the board once how far the piece can drop instead of moving it row by row.
+
+   @return: the # of rows the piece fell.
    */
-  void update();
-  
+  int fall(const Stack &board, const int &rows);
+
   /**
-   Allows the piece to fall. Simulates gravity. If the piece has failed to fall,
-   more than three times it should be locked.
-   
-   @return: true if the piece fell, false otherwise
-   */
-  bool fall();
-  
+   @return: how many rows the piece can drop before it lands.
+  */
+  int dropDistance(const Stack &board) const;
+
+  /**
+   Fills the cells the piece covers on the board.
+  */
+  void place(Stack &board) const;
+
   /**
    Gets the blocks of this piece
   */
-  vector<Block> getBlocks();
+  array<Block, 4> getBlocks() const;
+
+  /**
+   Gets the type of this piece
+  */
+  PIECE_TYPE getType() const;
+
+  /**
+   Gets the orientation of this piece, 0-3
+  */
+  int getRotation() const;
+
+  /**
+   Gets the position of the pivot
+  */
+  const Point& getPivot() const;
 
   /**
-   Draws the piece on the screen at its current position.
+   Gets the cells covered by this piece as row masks
   */
-  void draw();
+  const Footprint& getFootprint() const;
+
+  /**
+   Gets the color id of this piece
+  */
+  uint8_t getColor() const;
 };
 
+typedef BasicPiece<Bitboard> Piece;
+typedef BasicPiece<WideBitboard> WidePiece;
+
 #endif /* Piece_hpp */
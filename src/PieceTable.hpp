@@ -0,0 +1,287 @@
+//
+//  PieceTable.hpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/12/21.
+//
+
+#ifndef PieceTable_hpp
+#define PieceTable_hpp
+
+#include <cstdint>
+#include "Block.hpp"
+
+// Enums to define which type of piece
+enum PIECE_TYPE {
+  I_BLOCK, O_BLOCK,
+  J_BLOCK, L_BLOCK,
+  S_BLOCK, Z_BLOCK,
+  T_BLOCK
+};
+
+/**
+ One orientation of a piece, generated at compile time.
+*/
+struct Shape {
+  /**
+   Offsets of the four cells from the pivot.
+  */
+  Point cells[4];
+  /**
+   Smallest and largest x offset, and smallest y offset.
+  */
+  int left;
+  int right;
+  int top;
+  /**
+   Row masks of the cells with the leftmost column at bit 0, from the top row
+   down. Shifted into place to build a <Footprint>.
+  */
+  uint64_t rows[4];
+};
+
+/**
+ Every orientation of every piece: shapes[type][rotation].
+*/
+struct ShapeTable {
+  Shape shapes[7][4];
+};
+
+/**
+ Where each piece spawns: the cells of rotation 0 relative to the pivot, and
+ the pivot's position on the board. These are the original spawn positions;
+ pieces rotate about the pivot.
+*/
+constexpr Point SPAWN_CELLS[7][4] = {
+  { { 0, -1 }, { 0, 0 }, { 0, 1 }, { 0, 2 } },   // I_BLOCK
+  { { 0, -1 }, { 0, 0 }, { 1, -1 }, { 1, 0 } },  // O_BLOCK
+  { { 0, -1 }, { 0, 0 }, { 0, 1 }, { -1, 1 } },  // J_BLOCK
+  { { 0, -1 }, { 0, 0 }, { 0, 1 }, { 1, 1 } },   // L_BLOCK
+  { { 0, -1 }, { 0, 0 }, { 1, 0 }, { 1, 1 } },   // S_BLOCK
+  { { 0, -1 }, { 0, 0 }, { -1, 0 }, { -1, 1 } }, // Z_BLOCK
+  { { 0, -1 }, { -1, 0 }, { 0, 0 }, { 1, 0 } }   // T_BLOCK
+};
+constexpr Point SPAWN_PIVOTS[7] = {
+  { 5, 1 }, { 4, 1 }, { 5, 1 }, { 4, 1 }, { 4, 1 }, { 5, 1 }, { 4, 1 }
+};
+
+/**
+ Builds the bounds and row masks of a shape from its cells.
+*/
+constexpr Shape makeShape(const Point (&cells)[4]) {
+  Shape s{};
+  s.left = s.right = cells[0].x;
+  s.top = cells[0].y;
+  for (int i = 0; i < 4; i++) {
+    s.cells[i] = cells[i];
+    s.left = cells[i].x < s.left ? cells[i].x : s.left;
+    s.right = cells[i].x > s.right ? cells[i].x : s.right;
+    s.top = cells[i].y < s.top ? cells[i].y : s.top;
+  }
+  for (int i = 0; i < 4; i++)
+    s.rows[cells[i].y - s.top] |= uint64_t(1) << (cells[i].x - s.left);
+  return s;
+}
+
+/**
+ Generates all 4 orientations of every piece by rotating the spawn cells
+ clockwise about the pivot: (x, y) -> (-y, x).
+*/
+constexpr ShapeTable makeShapeTable() {
+  ShapeTable t{};
+  for (int type = 0; type < 7; type++) {
+    Point cells[4] = {};
+    for (int i = 0; i < 4; i++)
+      cells[i] = SPAWN_CELLS[type][i];
+
+    for (int rotation = 0; rotation < 4; rotation++) {
+      t.shapes[type][rotation] = makeShape(cells);
+      for (int i = 0; i < 4; i++)
+        cells[i] = { -cells[i].y, cells[i].x };
+    }
+  }
+  return t;
+}
+
+constexpr ShapeTable SHAPES = makeShapeTable();
+
+// A vertical I turns horizontal, and T points right after one clockwise turn
+static_assert(SHAPES.shapes[I_BLOCK][1].rows[0] == 0xF, "I_BLOCK rotation 1 should be flat");
+static_assert(SHAPES.shapes[T_BLOCK][1].rows[1] == 0x3, "T_BLOCK rotation 1 should point right");
+
+/**
+ Wall kicks: offsets tried in order when a rotation doesn't fit in place.
+ kicks[from][dir], where dir is 0 for clockwise and 1 for counter-clockwise.
+*/
+typedef Point KickTable[4][2][5];
+
+/**
+ The SRS kick tables as published, y up, indexed by SRS state (0, R, 2, L)
+ and direction.
+*/
+constexpr KickTable SRS_JLSTZ_KICKS = {
+  { { { 0, 0 }, { -1, 0 }, { -1, 1 }, { 0, -2 }, { -1, -2 } },   // 0 -> R
+    { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, -2 }, { 1, -2 } } },    // 0 -> L
+  { { { 0, 0 }, { 1, 0 }, { 1, -1 }, { 0, 2 }, { 1, 2 } },       // R -> 2
+    { { 0, 0 }, { 1, 0 }, { 1, -1 }, { 0, 2 }, { 1, 2 } } },     // R -> 0
+  { { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, -2 }, { 1, -2 } },      // 2 -> L
+    { { 0, 0 }, { -1, 0 }, { -1, 1 }, { 0, -2 }, { -1, -2 } } }, // 2 -> R
+  { { { 0, 0 }, { -1, 0 }, { -1, -1 }, { 0, 2 }, { -1, 2 } },    // L -> 0
+    { { 0, 0 }, { -1, 0 }, { -1, -1 }, { 0, 2 }, { -1, 2 } } }   // L -> 2
+};
+
+constexpr KickTable SRS_I_KICKS = {
+  { { { 0, 0 }, { -2, 0 }, { 1, 0 }, { -2, -1 }, { 1, 2 } },     // 0 -> R
+    { { 0, 0 }, { -1, 0 }, { 2, 0 }, { -1, 2 }, { 2, -1 } } },   // 0 -> L
+  { { { 0, 0 }, { -1, 0 }, { 2, 0 }, { -1, 2 }, { 2, -1 } },     // R -> 2
+    { { 0, 0 }, { 2, 0 }, { -1, 0 }, { 2, 1 }, { -1, -2 } } },   // R -> 0
+  { { { 0, 0 }, { 2, 0 }, { -1, 0 }, { 2, 1 }, { -1, -2 } },     // 2 -> L
+    { { 0, 0 }, { 1, 0 }, { -2, 0 }, { 1, -2 }, { -2, 1 } } },   // 2 -> R
+  { { { 0, 0 }, { 1, 0 }, { -2, 0 }, { 1, -2 }, { -2, 1 } },     // L -> 0
+    { { 0, 0 }, { -2, 0 }, { 1, 0 }, { -2, -1 }, { 1, 2 } } }    // L -> 2
+};
+
+/**
+ SRS state 0 of every piece as cells in its SRS box, y down, and the size of
+ the box. Pieces rotate about the center of the box.
+*/
+constexpr Point SRS_CELLS[7][4] = {
+  { { 0, 1 }, { 1, 1 }, { 2, 1 }, { 3, 1 } },  // I_BLOCK
+  { { 0, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 } },  // O_BLOCK
+  { { 0, 0 }, { 0, 1 }, { 1, 1 }, { 2, 1 } },  // J_BLOCK
+  { { 2, 0 }, { 0, 1 }, { 1, 1 }, { 2, 1 } },  // L_BLOCK
+  { { 1, 0 }, { 2, 0 }, { 0, 1 }, { 1, 1 } },  // S_BLOCK
+  { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 2, 1 } },  // Z_BLOCK
+  { { 1, 0 }, { 0, 1 }, { 1, 1 }, { 2, 1 } }   // T_BLOCK
+};
+constexpr int SRS_BOX[7] = { 4, 2, 3, 3, 3, 3, 3 };
+
+/**
+ The SRS state of each piece's rotation 0. The spawn table keeps the original
+ spawn shapes, so only T spawns in SRS state 0: I, L and S spawn in R, and J
+ and Z in L. A vertical I could be either R or L; it is taken as R.
+*/
+constexpr int SRS_STATE[7] = { 1, 0, 3, 1, 1, 3, 0 };
+
+/**
+ Fills out with the cells of a piece's SRS state, in its box.
+*/
+constexpr void srsCells(const int &type, const int &state, Point (&out)[4]) {
+  const int n = SRS_BOX[type];
+  for (int i = 0; i < 4; i++)
+    out[i] = SRS_CELLS[type][i];
+  // Clockwise about the center of the box: (x, y) -> (n - 1 - y, x)
+  for (int r = 0; r < state; r++)
+    for (int i = 0; i < 4; i++)
+      out[i] = { n - 1 - out[i].y, out[i].x };
+}
+
+/**
+ @return: the top left corner of the cells' bounding box.
+*/
+constexpr Point corner(const Point (&cells)[4]) {
+  Point c = cells[0];
+  for (int i = 1; i < 4; i++) {
+    c.x = cells[i].x < c.x ? cells[i].x : c.x;
+    c.y = cells[i].y < c.y ? cells[i].y : c.y;
+  }
+  return c;
+}
+
+/**
+ @return: where a piece's SRS box sits relative to its pivot in the given
+ rotation: the offset that moves the SRS cells of the matching state onto the
+ piece's cells.
+*/
+constexpr Point srsBox(const int &type, const int &rotation) {
+  Point srs[4] = {};
+  srsCells(type, (SRS_STATE[type] + rotation) & 3, srs);
+  const Point a = corner(SHAPES.shapes[type][rotation].cells);
+  const Point b = corner(srs);
+  return { a.x - b.x, a.y - b.y };
+}
+
+/**
+ @return: true if every rotation of the piece has the cells of the SRS state
+ it is mapped to, up to where the box sits; false otherwise.
+*/
+constexpr bool matchesSrs(const int &type) {
+  for (int rotation = 0; rotation < 4; rotation++) {
+    Point srs[4] = {};
+    srsCells(type, (SRS_STATE[type] + rotation) & 3, srs);
+    const Point box = srsBox(type, rotation);
+    for (int i = 0; i < 4; i++) {
+      bool found = false;
+      for (int j = 0; j < 4; j++)
+        found = found || (srs[j].x + box.x == SHAPES.shapes[type][rotation].cells[i].x &&
+                          srs[j].y + box.y == SHAPES.shapes[type][rotation].cells[i].y);
+      if (!found)
+        return false;
+    }
+  }
+  return true;
+}
+
+/**
+ Every piece's kick table: kicks[type][from][dir].
+*/
+struct KickTables {
+  KickTable kicks[7];
+};
+
+/**
+ Builds the kick tables for the pieces as they rotate here. Each rotation is
+ looked up as its SRS state, the published kick is flipped to y down, and the
+ difference between where the SRS box sits before and after is added, so a
+ piece that rotates about a cell (as I does here, where SRS turns it about the
+ middle of its box) ends up where SRS would put it. O doesn't rotate and has
+ no table.
+*/
+constexpr KickTables makeKickTables() {
+  KickTables t{};
+  for (int type = 0; type < 7; type++) {
+    if (type == O_BLOCK)
+      continue;
+    const KickTable &srs = type == I_BLOCK ? SRS_I_KICKS : SRS_JLSTZ_KICKS;
+    for (int from = 0; from < 4; from++) {
+      for (int dir = 0; dir < 2; dir++) {
+        const int to = (from + (dir ? 3 : 1)) & 3;
+        const Point before = srsBox(type, from);
+        const Point after = srsBox(type, to);
+        const int state = (SRS_STATE[type] + from) & 3;
+        for (int k = 0; k < 5; k++)
+          t.kicks[type][from][dir][k] = { srs[state][dir][k].x + before.x - after.x,
+                                          -srs[state][dir][k].y + before.y - after.y };
+      }
+    }
+  }
+  return t;
+}
+
+constexpr KickTables KICKS = makeKickTables();
+
+static_assert(matchesSrs(I_BLOCK) && matchesSrs(J_BLOCK) && matchesSrs(L_BLOCK) &&
+              matchesSrs(S_BLOCK) && matchesSrs(Z_BLOCK) && matchesSrs(T_BLOCK),
+              "every rotation should have the cells of its SRS state");
+// JLSTZ turn about the same cell SRS does, so their kicks are only relabeled:
+// J's 0 -> 1 here is SRS L -> 0
+static_assert(KICKS.kicks[J_BLOCK][0][0][2].x == -1 && KICKS.kicks[J_BLOCK][0][0][2].y == 1 &&
+              KICKS.kicks[J_BLOCK][0][0][3].x == 0 && KICKS.kicks[J_BLOCK][0][0][3].y == -2 &&
+              KICKS.kicks[J_BLOCK][0][0][4].x == -1 && KICKS.kicks[J_BLOCK][0][0][4].y == -2,
+              "J_BLOCK 0 -> 1 should kick as SRS L -> 0");
+// T spawns in SRS state 0, so its 0 -> 1 is SRS 0 -> R
+static_assert(KICKS.kicks[T_BLOCK][0][0][2].x == -1 && KICKS.kicks[T_BLOCK][0][0][2].y == -1,
+              "T_BLOCK 0 -> 1 should kick as SRS 0 -> R");
+// I turns about a cell, so even its first test moves it to where SRS puts it
+static_assert(KICKS.kicks[I_BLOCK][0][0][0].x == 0 && KICKS.kicks[I_BLOCK][0][0][0].y == 1,
+              "I_BLOCK 0 -> 1 should drop a row to land in SRS R -> 2's spot");
+
+/**
+ The kick table a piece type uses, picked at compile time.
+*/
+template <PIECE_TYPE T>
+constexpr const KickTable& kicksFor() {
+  return KICKS.kicks[T];
+}
+
+#endif /* PieceTable_hpp */
@@ -0,0 +1,106 @@
+//
+//  Policy.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/15/21.
+//
+
+#include "Policy.hpp"
+
+// --- BEGIN Policy ---
+
+Policy::~Policy() {}
+
+/**
+ Chooses a placement for the active piece and locks it there, recording the
+ inputs to replay if one is given.
+
+ @return: true if a piece was placed; false if the piece has nowhere to go.
+*/
+bool Policy::playPiece(Board &board, ReplayWriter *replay) {
+  const vector<Placement> &placements =
+    this->generator.generate(board.getBitboard(), board.getActive());
+  if (placements.empty())
+    return false;
+
+  // Walk the piece to the chosen spot and lock it there
+  const Placement &chosen = placements[this->choose(board, placements)];
+  for (const ACTION &action : this->generator.getPath(chosen))
+    replay ? replay->step(board, action) : board.step(action);
+  replay ? replay->step(board, HARD_DROP) : board.step(HARD_DROP);
+  return true;
+}
+
+/**
+ Plays until the game is over or max_pieces have been locked, recording it to
+ replay if one is given.
+*/
+void Policy::play(Board &board, const int &max_pieces, ReplayWriter *replay) {
+  while (!board.isOver() && board.getPieces() < max_pieces)
+    if (!this->playPiece(board, replay))
+      return;
+}
+
+// --- END Policy ---
+
+// --- BEGIN RandomPolicy ---
+
+RandomPolicy::RandomPolicy(const unsigned &seed): rng(seed) {}
+
+/**
+ Picks a placement uniformly at random.
+*/
+int RandomPolicy::choose(const Board &, const vector<Placement> &placements) {
+  return (int)(this->rng() % placements.size());
+}
+
+// --- END RandomPolicy ---
+
+// --- BEGIN HeuristicPolicy ---
+
+HeuristicPolicy::HeuristicPolicy(const Weights &weights): weights(weights), scratch(0, 0) {}
+
+/**
+ Tries every placement on a scratch copy of the board, then scores all the
+ resulting boards in one batch and keeps the best.
+*/
+int HeuristicPolicy::choose(const Board &board, const vector<Placement> &placements) {
+  const int count = (int)placements.size();
+  const Bitboard &b = board.getBitboard();
+  // Boards too big for the batch kernels are scored one at a time
+  const bool batch = Evaluator::fits(b.getRows(), b.getCols());
+  this->candidates.resize(batch ? count : 0);
+  this->lines.resize(count);
+  this->features.resize(count);
+  for (int i = 0; i < count; i++) {
+    // Lock the piece on a copy and clear whatever it completes
+    const Footprint &f = placements[i].piece.getFootprint();
+    this->scratch = b;
+    this->scratch.place(f, 1);
+    this->lines[i] = this->scratch.clearFullRows(f.top, f.top + 3);
+    if (batch)
+      Evaluator::compact(this->scratch, this->candidates[i]);
+    else
+      Evaluator::evaluate(this->scratch, i, this->features);
+  }
+
+  if (batch)
+    Evaluator::evaluate(this->candidates.data(), count, b.getRows(), b.getCols(), this->features);
+
+  int best = 0;
+  double best_score = 0;
+  for (int i = 0; i < count; i++) {
+    const double score = this->weights.height * this->features.height[i] +
+                         this->weights.lines * this->lines[i] +
+                         this->weights.holes * this->features.holes[i] +
+                         this->weights.bumpiness * this->features.bumpiness[i];
+    if (i == 0 || score > best_score) {
+      best = i;
+      best_score = score;
+    }
+  }
+
+  return best;
+}
+
+// --- END HeuristicPolicy ---
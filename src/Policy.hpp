@@ -0,0 +1,104 @@
+//
+//  Policy.hpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/15/21.
+//
+
+#ifndef Policy_hpp
+#define Policy_hpp
+
+#include <random>
+#include <vector>
+#include "Board.hpp"
+#include "Evaluator.hpp"
+#include "MoveGenerator.hpp"
+#include "Replay.hpp"
+
+using std::vector;
+
+/**
+ Plays a headless <Board> by choosing a placement for every piece. Subclasses
+ only decide which placement; play() generates them and feeds the inputs to the
+ board. A policy keeps its own buffers, so use one per thread.
+*/
+class Policy {
+private:
+  /**
+   Finds the placements for each piece.
+  */
+  MoveGenerator generator;
+
+public:
+  virtual ~Policy();
+
+  /**
+   Picks one of the placements for the board's active piece.
+
+   @return: the index of the chosen placement.
+  */
+  virtual int choose(const Board &board, const vector<Placement> &placements) = 0;
+
+  /**
+   Chooses a placement for the active piece and locks it there. Every action
+   goes through replay, if one is given, so the game is recorded.
+
+   @return: true if a piece was placed; false if the piece has nowhere to go.
+  */
+  bool playPiece(Board &board, ReplayWriter *replay = nullptr);
+
+  /**
+   Plays until the game is over or max_pieces have been locked. Every action
+   goes through replay, if one is given, so the game is recorded.
+  */
+  void play(Board &board, const int &max_pieces, ReplayWriter *replay = nullptr);
+};
+
+/**
+ Picks a placement uniformly at random.
+*/
+class RandomPolicy : public Policy {
+private:
+  std::mt19937 rng;
+
+public:
+  RandomPolicy(const unsigned &seed);
+  int choose(const Board &board, const vector<Placement> &placements) override;
+};
+
+/**
+ Weight of each feature a <HeuristicPolicy> scores. Defaults are the usual
+ hand-tuned values.
+*/
+struct Weights {
+  double height = -0.510066;
+  double lines = 0.760666;
+  double holes = -0.35663;
+  double bumpiness = -0.184483;
+};
+
+/**
+ Picks the placement whose resulting board scores best on a weighted sum of
+ aggregate height, lines cleared, holes and bumpiness.
+*/
+class HeuristicPolicy : public Policy {
+private:
+  Weights weights;
+  /**
+   The board after a candidate placement. Reused so scoring never allocates.
+  */
+  Bitboard scratch;
+  /**
+   Every candidate board in compact form, the lines each one cleared, and
+   their features. Reused across pieces.
+  */
+  vector<CompactBoard> candidates;
+  vector<int> lines;
+  Features features;
+
+public:
+  HeuristicPolicy(const Weights &weights = Weights());
+  int choose(const Board &board, const vector<Placement> &placements) override;
+};
+
+#endif /* Policy_hpp */
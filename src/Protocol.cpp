@@ -0,0 +1,194 @@
+//
+//  Protocol.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/22/21.
+//
+
+#include "Protocol.hpp"
+
+// --- BEGIN ENCODING ---
+
+/**
+ Bits of the STATE flags byte.
+*/
+static const uint8_t FLAG_OVER = 1;
+static const uint8_t FLAG_STACK = 2;
+
+/**
+ Size of a STATE body without the stack.
+*/
+static const int STATE_SIZE = 21;
+
+/**
+ Appends a little-endian integer of the given # of bytes.
+*/
+static void putFixed(vector<uint8_t> &out, const uint32_t &value, const int &bytes) {
+  for (int i = 0; i < bytes; i++)
+    out.push_back((uint8_t)(value >> (8 * i)));
+}
+
+/**
+ Reads a little-endian integer of the given # of bytes.
+*/
+static uint32_t getFixed(const uint8_t *p, const int &bytes) {
+  uint32_t value = 0;
+  for (int i = 0; i < bytes; i++)
+    value |= uint32_t(p[i]) << (8 * i);
+  return value;
+}
+
+// --- END ENCODING ---
+
+// --- BEGIN PUBLIC ---
+
+/**
+ Looks for a complete frame at the start of the data.
+
+ @return: the # of bytes the frame takes, with type, body and length set; 0 if
+ more data is needed; -1 if the data isn't a valid frame.
+*/
+int Protocol::frame(const uint8_t *data, const size_t &size, MESSAGE &type,
+                    const uint8_t *&body, int &length) {
+  if (size < 2)
+    return 0;
+
+  const int total = (int)getFixed(data, 2);
+  if (total < 1 || total > Protocol::MAX_BODY + 1)
+    return -1;
+  if (size < (size_t)total + 2)
+    return 0;
+  if (data[2] > MSG_SPECTATE)
+    return -1;
+
+  type = MESSAGE(data[2]);
+  body = data + 3;
+  length = total - 1;
+  return total + 2;
+}
+
+/**
+ Starts a frame. The size is filled in by endFrame().
+
+ @return: where the frame starts in the buffer.
+*/
+size_t Protocol::beginFrame(vector<uint8_t> &out, const MESSAGE &type) {
+  const size_t start = out.size();
+  putFixed(out, 0, 2);
+  out.push_back((uint8_t)type);
+  return start;
+}
+
+/**
+ Writes the size of the frame that starts at the given offset.
+*/
+void Protocol::endFrame(vector<uint8_t> &out, const size_t &start) {
+  const size_t size = out.size() - start - 2;
+  out[start] = (uint8_t)size;
+  out[start + 1] = (uint8_t)(size >> 8);
+}
+
+/**
+ Appends a START frame: the seed of the new game.
+*/
+void Protocol::encodeStart(vector<uint8_t> &out, const uint32_t &seed) {
+  const size_t start = Protocol::beginFrame(out, MSG_START);
+  putFixed(out, seed, 4);
+  Protocol::endFrame(out, start);
+}
+
+/**
+ Appends an INPUT frame: the sequence # to echo, then the action.
+*/
+void Protocol::encodeInput(vector<uint8_t> &out, const uint32_t &sequence, const ACTION &action) {
+  const size_t start = Protocol::beginFrame(out, MSG_INPUT);
+  putFixed(out, sequence, 4);
+  out.push_back((uint8_t)action);
+  Protocol::endFrame(out, start);
+}
+
+/**
+ Appends a STATE frame: the counters, the active piece, a flags byte and, if
+ requested, the stack as one 16-bit mask per row.
+*/
+void Protocol::encodeState(vector<uint8_t> &out, const uint32_t &sequence, const Board &board,
+                           const bool &stack) {
+  const Piece &active = board.getActive();
+  const size_t start = Protocol::beginFrame(out, MSG_STATE);
+  putFixed(out, sequence, 4);
+  putFixed(out, board.getPieces(), 4);
+  putFixed(out, board.getLines(), 4);
+  putFixed(out, board.getScore(), 4);
+  out.push_back((uint8_t)active.getType());
+  out.push_back((uint8_t)active.getRotation());
+  out.push_back((uint8_t)(int8_t)active.getPivot().x);
+  out.push_back((uint8_t)(int8_t)active.getPivot().y);
+  out.push_back((board.isOver() ? FLAG_OVER : 0) | (stack ? FLAG_STACK : 0));
+
+  if (stack) {
+    const Bitboard &b = board.getBitboard();
+    const uint64_t cells = (uint64_t(1) << b.getCols()) - 1;
+    out.push_back((uint8_t)b.getRows());
+    out.push_back((uint8_t)b.getCols());
+    for (int row = 0; row < b.getRows(); row++)
+      putFixed(out, (uint32_t)((b.getRow(row) >> 1) & cells), 2);
+  }
+  Protocol::endFrame(out, start);
+}
+
+/**
+ @return: true if the body is a valid START; false otherwise.
+*/
+bool Protocol::decodeStart(const uint8_t *body, const int &length, uint32_t &seed) {
+  if (length != 4)
+    return false;
+  seed = getFixed(body, 4);
+  return true;
+}
+
+/**
+ @return: true if the body is a valid INPUT; false otherwise.
+*/
+bool Protocol::decodeInput(const uint8_t *body, const int &length, uint32_t &sequence,
+                           ACTION &action) {
+  if (length != 5 || body[4] > TICK)
+    return false;
+  sequence = getFixed(body, 4);
+  action = ACTION(body[4]);
+  return true;
+}
+
+/**
+ Decodes a STATE. The stack is only written if the message has one.
+
+ @return: true if the body is a valid STATE; false otherwise.
+*/
+bool Protocol::decodeState(const uint8_t *body, const int &length, StateMessage &state) {
+  if (length < STATE_SIZE || body[16] > T_BLOCK)
+    return false;
+
+  state.sequence = getFixed(body, 4);
+  state.pieces = getFixed(body + 4, 4);
+  state.lines = getFixed(body + 8, 4);
+  state.score = getFixed(body + 12, 4);
+  state.type = PIECE_TYPE(body[16]);
+  state.rotation = body[17];
+  state.pivot = { (int8_t)body[18], (int8_t)body[19] };
+  state.over = body[20] & FLAG_OVER;
+  state.has_stack = body[20] & FLAG_STACK;
+  if (!state.has_stack)
+    return length == STATE_SIZE;
+
+  if (length < STATE_SIZE + 2)
+    return false;
+  const int rows = body[STATE_SIZE];
+  if (rows > 64 || length != STATE_SIZE + 2 + 2 * rows)
+    return false;
+  state.rows = rows;
+  state.cols = body[STATE_SIZE + 1];
+  for (int row = 0; row < rows; row++)
+    state.stack[row] = (uint16_t)getFixed(body + STATE_SIZE + 2 + 2 * row, 2);
+  return true;
+}
+
+// --- END PUBLIC ---
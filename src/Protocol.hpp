@@ -0,0 +1,138 @@
+//
+//  Protocol.hpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/22/21.
+//
+
+#ifndef Protocol_hpp
+#define Protocol_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Board.hpp"
+
+using std::vector;
+
+// Every message on a server connection is framed as:
+//
+//   size     u16, the # of bytes that follow (type and body)
+//   type     u8, a <MESSAGE>
+//   body     depends on the type
+//
+// Integers are little-endian. A client sends START to begin (or restart) its
+// game, then one INPUT per action. The server answers every INPUT with a
+// STATE that echoes its sequence #, and sends a STATE with sequence 0
+// whenever gravity moves the piece. The stack is only included when it
+// changed since the last STATE, so most updates are under 30 bytes.
+//
+// SPECTATE frames carry the spectator feed in Spectator.hpp, framed the same
+// way.
+
+// Enums to define the message types
+enum MESSAGE {
+  MSG_START, MSG_INPUT, MSG_STATE, MSG_SPECTATE
+};
+
+/**
+ What a STATE message carries.
+*/
+struct StateMessage {
+  /**
+   The INPUT this answers, or 0 for an update from gravity.
+  */
+  uint32_t sequence;
+  uint32_t pieces;
+  uint32_t lines;
+  uint32_t score;
+  /**
+   The active piece.
+  */
+  PIECE_TYPE type;
+  int rotation;
+  Point pivot;
+  bool over;
+  /**
+   Set if the stack below was included; otherwise it is unchanged.
+  */
+  bool has_stack;
+  int rows;
+  int cols;
+  /**
+   One mask per row, column c at bit c.
+  */
+  uint16_t stack[64];
+};
+
+/**
+ Encodes and decodes the messages of the server protocol. Encoders append a
+ whole frame to the buffer; decoders take the body of a frame found by
+ frame().
+*/
+class Protocol {
+public:
+  /**
+   Largest frame body allowed, so a bad size can't make a reader buffer
+   forever.
+  */
+  static const int MAX_BODY = 1024;
+
+  /**
+   Looks for a complete frame at the start of the data.
+
+   @return: the # of bytes the frame takes, with type, body and length set;
+   0 if more data is needed; -1 if the data isn't a valid frame.
+  */
+  static int frame(const uint8_t *data, const size_t &size, MESSAGE &type,
+                   const uint8_t *&body, int &length);
+
+  /**
+   Starts a frame of the given type. The size is filled in by endFrame().
+
+   @return: where the frame starts in the buffer.
+  */
+  static size_t beginFrame(vector<uint8_t> &out, const MESSAGE &type);
+
+  /**
+   Writes the size of the frame that starts at the given offset.
+  */
+  static void endFrame(vector<uint8_t> &out, const size_t &start);
+
+  /**
+   Appends a START frame.
+  */
+  static void encodeStart(vector<uint8_t> &out, const uint32_t &seed);
+
+  /**
+   Appends an INPUT frame.
+  */
+  static void encodeInput(vector<uint8_t> &out, const uint32_t &sequence, const ACTION &action);
+
+  /**
+   Appends a STATE frame for the board, with its stack if requested. The board
+   must be at most 64 rows by 16 cols.
+  */
+  static void encodeState(vector<uint8_t> &out, const uint32_t &sequence, const Board &board,
+                          const bool &stack);
+
+  /**
+   @return: true if the body is a valid START; false otherwise.
+  */
+  static bool decodeStart(const uint8_t *body, const int &length, uint32_t &seed);
+
+  /**
+   @return: true if the body is a valid INPUT; false otherwise.
+  */
+  static bool decodeInput(const uint8_t *body, const int &length, uint32_t &sequence,
+                          ACTION &action);
+
+  /**
+   Decodes a STATE. The stack is only written if the message has one.
+
+   @return: true if the body is a valid STATE; false otherwise.
+  */
+  static bool decodeState(const uint8_t *body, const int &length, StateMessage &state);
+};
+
+#endif /* Protocol_hpp */
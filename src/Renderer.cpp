@@ -0,0 +1,161 @@
+//
+//  Renderer.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/10/21.
+//
+
+#include <algorithm>
+#include <cstring>
+#include "Renderer.hpp"
+
+// --- BEGIN PRIVATE ---
+
+/**
+ Creates the textures and draws the grid into its texture. The stack starts
+ out empty with every row marked as changed.
+*/
+void Renderer::load(const Bitboard &board) {
+  this->grid = LoadRenderTexture(WINDOW_WIDTH, WINDOW_HEIGHT);
+  this->stack = LoadRenderTexture(WINDOW_WIDTH, WINDOW_HEIGHT);
+  this->loaded = true;
+  this->hidden = std::max(board.getRows() - ROWS, 0);
+
+  BeginTextureMode(this->grid);
+  ClearBackground(BLANK);
+  this->drawGrid(board);
+  EndTextureMode();
+
+  BeginTextureMode(this->stack);
+  ClearBackground(BLACK);
+  EndTextureMode();
+
+  // A mask no row can have, so the first frame draws them all
+  this->masks.assign(board.getRows(), 0);
+  this->colors.assign(board.getRows() * board.getCols(), 0);
+}
+
+/**
+ Draws a single cell on the screen. coords are board coords, so cells in the
+ hidden rows land above the window.
+*/
+void Renderer::drawCell(const Point &coords, const Color &color) const {
+  DrawRectangle(coords.x * BLOCK_SIZE, (coords.y - this->hidden) * BLOCK_SIZE,
+                BLOCK_SIZE, BLOCK_SIZE, color);
+}
+
+/**
+ Draws the locked blocks of every row that changed since the last frame into
+ the stack texture. Rows are compared by mask and colors, so a row that only
+ moved down when a line cleared is caught too.
+*/
+void Renderer::drawBlocks(const Bitboard &board) {
+  const int cols = board.getCols();
+  bool drawing = false;
+
+  for (int i = this->hidden; i < board.getRows(); i++) {
+    uint8_t *drawn = &this->colors[i * cols];
+    uint8_t row[64];
+    for (int j = 0; j < cols; j++)
+      row[j] = board.getColor(i, j);
+    if (board.getRow(i) == this->masks[i] && memcmp(row, drawn, cols) == 0)
+      continue;
+
+    // Only switch to the texture if something changed
+    if (!drawing) {
+      BeginTextureMode(this->stack);
+      drawing = true;
+    }
+
+    // Paint over the old row, then draw its blocks
+    DrawRectangle(0, (i - this->hidden) * BLOCK_SIZE, WINDOW_WIDTH, BLOCK_SIZE, BLACK);
+    for (int j = 0; j < cols; j++)
+      if (row[j]) // dont draw the empty blocks
+        this->drawCell({ j, i }, Renderer::getColor(row[j]));
+
+    this->masks[i] = board.getRow(i);
+    memcpy(drawn, row, cols);
+  }
+
+  if (drawing)
+    EndTextureMode();
+}
+
+/**
+ Draws the active piece at its current position.
+*/
+void Renderer::drawPiece(const Piece &piece) const {
+  for (Block const &b : piece.getBlocks())
+    this->drawCell(b.getCoords(), Renderer::getColor(b.getColor()));
+}
+
+/**
+ Draws the grid overlay.
+*/
+void Renderer::drawGrid(const Bitboard &board) const {
+  // Draw the visible rows
+  for (int i = 0; i < board.getRows() - this->hidden; i++)
+    DrawLine(0, i * BLOCK_SIZE, WINDOW_WIDTH, i * BLOCK_SIZE, WHITE);
+
+  // Draw columns
+  for (int i = 0; i < board.getCols(); i++)
+    DrawLine(i * BLOCK_SIZE, 0, i * BLOCK_SIZE, WINDOW_HEIGHT, WHITE);
+}
+
+/**
+ Draws a render texture over the whole window. Render textures are stored
+ upside down, hence the negative height.
+*/
+void Renderer::drawTexture(const RenderTexture2D &texture) const {
+  const Rectangle source = { 0, 0, (float)texture.texture.width, -(float)texture.texture.height };
+  DrawTextureRec(texture.texture, source, { 0, 0 }, WHITE);
+}
+
+// --- END PRIVATE ---
+
+// --- BEGIN PUBLIC ---
+
+Renderer::Renderer(): grid(), stack(), loaded(false), hidden(0) {}
+
+/**
+ Frees the textures.
+*/
+Renderer::~Renderer() {
+  if (this->loaded) {
+    UnloadRenderTexture(this->grid);
+    UnloadRenderTexture(this->stack);
+  }
+}
+
+/**
+ Draws the board, grid, and active piece: brings the cached stack up to date,
+ then draws it, the piece and the cached grid on top.
+*/
+void Renderer::draw(const Board &board) {
+  if (!this->loaded)
+    this->load(board.getBitboard());
+
+  this->drawBlocks(board.getBitboard());
+  this->drawTexture(this->stack);
+  this->drawPiece(board.getActive());
+  this->drawTexture(this->grid);
+}
+
+/**
+ Gets the color a color id is drawn in. Ids are the <PIECE_TYPE> + 1.
+*/
+Color Renderer::getColor(const uint8_t &id) {
+  switch (id) {
+    case I_BLOCK + 1: return SKYBLUE;
+    case O_BLOCK + 1: return YELLOW;
+    case J_BLOCK + 1: return BLUE;
+    case L_BLOCK + 1: return ORANGE;
+    case S_BLOCK + 1: return GREEN;
+    case Z_BLOCK + 1: return RED;
+    case T_BLOCK + 1: return PURPLE;
+  }
+
+  return BLANK;
+}
+
+// --- END PUBLIC ---
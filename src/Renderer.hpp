@@ -0,0 +1,106 @@
+//
+//  Renderer.hpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/10/21.
+//
+
+#ifndef Renderer_hpp
+#define Renderer_hpp
+
+#include <cstdint>
+#include <vector>
+#include "raylib.h"
+#include "Global.hpp"
+#include "Board.hpp"
+
+using std::vector;
+
+/**
+ Draws a <Board> with raylib. Everything that needs a window lives here, so the
+ <Board> itself can run headless.
+
+ The grid and the locked stack only change when a piece locks, so both are kept
+ in render textures. Each frame only the stack rows that changed are drawn
+ again, and the screen is the two textures plus the active piece.
+*/
+class Renderer {
+private:
+  /**
+   The grid lines on a transparent background, drawn once.
+  */
+  RenderTexture2D grid;
+  /**
+   The locked blocks on a black background.
+  */
+  RenderTexture2D stack;
+  /**
+   Set once the textures have been created. That needs a window, so it is done
+   on the first draw.
+  */
+  bool loaded;
+  /**
+   # of rows above the visible field, on a board taller than ROWS. They are
+   not drawn.
+  */
+  int hidden;
+  /**
+   The masks and colors of every row as they are drawn in the stack texture.
+  */
+  vector<uint64_t> masks;
+  vector<uint8_t> colors;
+
+  /**
+   Creates the textures and draws the grid into its texture.
+  */
+  void load(const Bitboard &board);
+
+  /**
+   Draws a single cell on the screen. coords are board coords.
+  */
+  void drawCell(const Point &coords, const Color &color) const;
+
+  /**
+   Draws the locked blocks of every row that changed since the last frame into
+   the stack texture.
+  */
+  void drawBlocks(const Bitboard &board);
+
+  /**
+   Draws the active piece at its current position.
+  */
+  void drawPiece(const Piece &piece) const;
+
+  /**
+   Draws the grid overlay.
+  */
+  void drawGrid(const Bitboard &board) const;
+
+  /**
+   Draws a render texture over the whole window.
+  */
+  void drawTexture(const RenderTexture2D &texture) const;
+
+public:
+  Renderer();
+
+  /**
+   Frees the textures.
+  */
+  ~Renderer();
+
+  Renderer(const Renderer &) = delete;
+  Renderer& operator=(const Renderer &) = delete;
+
+  /**
+   Draws the board, grid, and active piece.
+  */
+  void draw(const Board &board);
+
+  /**
+   Gets the color a color id is drawn in.
+  */
+  static Color getColor(const uint8_t &id);
+};
+
+#endif /* Renderer_hpp */
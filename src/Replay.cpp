@@ -0,0 +1,501 @@
+//
+//  Replay.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/17/21.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Replay.hpp"
+#include "Zobrist.hpp"
+
+// --- BEGIN ENCODING ---
+
+static const char MAGIC[4] = { 'T', 'R', 'P', 'L' };
+static const char END_MAGIC[4] = { 'T', 'R', 'P', 'E' };
+// 4: rotations kick as SRS does for each piece's state, so inputs recorded
+// under 3 would play out differently
+static const uint8_t VERSION = 4;
+static const int HEADER_SIZE = 24;
+static const int FOOTER_SIZE = 20;
+static const int INDEX_ENTRY = 12;
+
+/**
+ Appends a little-endian integer of the given # of bytes.
+*/
+static void putFixed(vector<uint8_t> &out, const uint64_t &value, const int &bytes) {
+  for (int i = 0; i < bytes; i++)
+    out.push_back((uint8_t)(value >> (8 * i)));
+}
+
+/**
+ Reads a little-endian integer of the given # of bytes.
+*/
+static uint64_t getFixed(const uint8_t *p, const int &bytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < bytes; i++)
+    value |= uint64_t(p[i]) << (8 * i);
+  return value;
+}
+
+/**
+ Doubles are stored as their IEEE bits.
+*/
+static uint64_t doubleBits(const double &value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static double bitsDouble(const uint64_t &bits) {
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+/**
+ Appends an unsigned varint: 7 bits per byte, high bit set on all but the last.
+*/
+static void putVarint(vector<uint8_t> &out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back((uint8_t)(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back((uint8_t)value);
+}
+
+/**
+ Reads an unsigned varint and advances p past it.
+
+ @return: false if it runs past end.
+*/
+static bool getVarint(const uint8_t *&p, const uint8_t *end, uint64_t &value) {
+  value = 0;
+  for (int shift = 0; p < end && shift < 64; shift += 7) {
+    const uint8_t byte = *p++;
+    value |= uint64_t(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+/**
+ Maps signed values onto unsigned ones so small negatives stay short.
+*/
+static uint64_t zigzag(const int &value) {
+  return value < 0 ? (uint64_t(-(int64_t)value) << 1) - 1 : uint64_t(value) << 1;
+}
+
+static int unzigzag(const uint64_t &value) {
+  return value & 1 ? -(int)((value + 1) >> 1) : (int)(value >> 1);
+}
+
+// --- END ENCODING ---
+
+// --- BEGIN ReplayWriter ---
+
+/**
+ Stores the pending TICKs, followed by the given action.
+*/
+void ReplayWriter::writeAction(const ACTION &action) {
+  putVarint(this->buffer, this->ticks << 3 | action);
+  this->ticks = 0;
+  if (this->buffer.size() >= 1 << 16)
+    this->flush();
+}
+
+/**
+ Starts a new chunk with a snapshot of the board: stats, active piece,
+ generator state, then every row as a mask followed by the colors of its
+ filled cells, two to a byte.
+*/
+void ReplayWriter::writeSnapshot(const Board &board) {
+  // Any TICKs still pending belong to the chunk before
+  if (this->ticks > 0) {
+    this->ticks--;
+    this->writeAction(TICK);
+  }
+  this->index.push_back(this->written + this->buffer.size());
+  this->starts.push_back(board.pieces);
+
+  putVarint(this->buffer, board.pieces);
+  putVarint(this->buffer, board.lines);
+  putVarint(this->buffer, board.score);
+  putVarint(this->buffer, board.lock_ticks);
+  putFixed(this->buffer, doubleBits(board.gravity_progress), 8);
+  this->buffer.push_back(board.over);
+
+  const Piece &active = board.active;
+  this->buffer.push_back((uint8_t)active.getType());
+  this->buffer.push_back((uint8_t)active.getRotation());
+  putVarint(this->buffer, zigzag(active.getPivot().x));
+  putVarint(this->buffer, zigzag(active.getPivot().y));
+
+  // The engine's state in its standard text form, which works for any engine
+  std::ostringstream state;
+  state << board.generator;
+  const string text = state.str();
+  putVarint(this->buffer, text.size());
+  this->buffer.insert(this->buffer.end(), text.begin(), text.end());
+
+  const Bitboard &bits = board.board;
+  const uint64_t cells = (uint64_t(1) << bits.getCols()) - 1;
+  for (int i = 0; i < bits.getRows(); i++) {
+    const uint64_t mask = (bits.getRow(i) >> 1) & cells;
+    putVarint(this->buffer, mask);
+
+    int n = 0;
+    uint8_t packed = 0;
+    for (uint64_t m = mask; m; m &= m - 1, n++) {
+      const uint8_t color = bits.getColor(i, __builtin_ctzll(m));
+      if (n & 1)
+        this->buffer.push_back(packed | (uint8_t)(color << 4));
+      else
+        packed = color;
+    }
+    if (n & 1)
+      this->buffer.push_back(packed);
+  }
+}
+
+/**
+ Writes the buffer to the file.
+*/
+void ReplayWriter::flush() {
+  if (!this->buffer.empty())
+    fwrite(this->buffer.data(), 1, this->buffer.size(), this->file);
+  this->written += this->buffer.size();
+  this->buffer.clear();
+}
+
+ReplayWriter::ReplayWriter(): file(nullptr), written(0), interval(64), ticks(0), pieces(0) {}
+
+/**
+ Finishes the file if it is still open.
+*/
+ReplayWriter::~ReplayWriter() {
+  this->close();
+}
+
+/**
+ Starts recording a game from the board's current state.
+
+ @param interval - # of pieces between snapshots.
+ @return: true if the file was created; false otherwise.
+*/
+bool ReplayWriter::open(const string &path, const Board &board, const int &interval) {
+  this->close();
+  this->file = fopen(path.c_str(), "wb");
+  if (!this->file)
+    return false;
+
+  this->written = 0;
+  this->buffer.clear();
+  this->index.clear();
+  this->starts.clear();
+  this->interval = interval > 0 ? interval : 1;
+  this->ticks = 0;
+  this->pieces = board.getPieces();
+
+  this->buffer.insert(this->buffer.end(), MAGIC, MAGIC + 4);
+  this->buffer.push_back(VERSION);
+  this->buffer.push_back((uint8_t)board.rows);
+  this->buffer.push_back((uint8_t)board.cols);
+  this->buffer.push_back(0);
+  putFixed(this->buffer, doubleBits(board.gravity), 8);
+  putFixed(this->buffer, board.seed, 4);
+  putFixed(this->buffer, this->interval, 4);
+
+  this->writeSnapshot(board);
+  return true;
+}
+
+/**
+ Applies an action to the board and records it. Actions that change nothing
+ are not stored.
+
+ @return: what Board::step returned.
+*/
+bool ReplayWriter::step(Board &board, const ACTION &action) {
+  const bool changed = board.step(action);
+  if (!this->file || !changed)
+    return changed;
+
+  // Gravity is only counted until the next action is stored
+  if (action == TICK)
+    this->ticks++;
+  else
+    this->writeAction(action);
+
+  // Snapshot right after every interval-th piece locks
+  if (board.getPieces() != this->pieces) {
+    this->pieces = board.getPieces();
+    if (this->pieces % this->interval == 0)
+      this->writeSnapshot(board);
+  }
+
+  return changed;
+}
+
+/**
+ Writes the index and footer and closes the file.
+
+ @return: true if everything was written; false otherwise.
+*/
+bool ReplayWriter::close() {
+  if (!this->file)
+    return false;
+
+  if (this->ticks > 0) {
+    this->ticks--;
+    this->writeAction(TICK);
+  }
+
+  const uint64_t index = this->written + this->buffer.size();
+  for (size_t i = 0; i < this->index.size(); i++) {
+    putFixed(this->buffer, this->index[i], 8);
+    putFixed(this->buffer, this->starts[i], 4);
+  }
+  putFixed(this->buffer, index, 8);
+  putFixed(this->buffer, this->index.size(), 4);
+  putFixed(this->buffer, this->pieces, 4);
+  this->buffer.insert(this->buffer.end(), END_MAGIC, END_MAGIC + 4);
+  this->flush();
+
+  const bool ok = !ferror(this->file);
+  fclose(this->file);
+  this->file = nullptr;
+  return ok;
+}
+
+// --- END ReplayWriter ---
+
+// --- BEGIN ReplayReader ---
+
+/**
+ @return: the file offset of a chunk, or of the index for chunk == chunks.
+*/
+uint64_t ReplayReader::chunkOffset(const int &chunk) const {
+  if (chunk >= this->chunks)
+    return this->index;
+  return getFixed(this->data + this->index + INDEX_ENTRY * chunk, 8);
+}
+
+/**
+ @return: the # of pieces locked when a chunk's snapshot was taken.
+*/
+int ReplayReader::chunkPieces(const int &chunk) const {
+  return (int)getFixed(this->data + this->index + INDEX_ENTRY * chunk + 8, 4);
+}
+
+ReplayReader::ReplayReader(): data(nullptr), size(0) {}
+
+/**
+ Unmaps the file if one is open.
+*/
+ReplayReader::~ReplayReader() {
+  this->close();
+}
+
+/**
+ Maps a replay file and checks its header, footer and index.
+
+ @return: true if it is a complete replay; false otherwise.
+*/
+bool ReplayReader::open(const string &path) {
+  this->close();
+
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size < HEADER_SIZE + FOOTER_SIZE) {
+    ::close(fd);
+    return false;
+  }
+
+  // The mapping stays valid after the descriptor is closed
+  void *mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED)
+    return false;
+  this->data = (const uint8_t*)mapped;
+  this->size = (size_t)info.st_size;
+
+  // Check both ends before trusting anything in between
+  const uint8_t *footer = this->data + this->size - FOOTER_SIZE;
+  if (memcmp(this->data, MAGIC, 4) != 0 || this->data[4] != VERSION ||
+      memcmp(footer + 16, END_MAGIC, 4) != 0) {
+    this->close();
+    return false;
+  }
+
+  this->rows = this->data[5];
+  this->cols = this->data[6];
+  this->gravity = bitsDouble(getFixed(this->data + 8, 8));
+  this->seed = (unsigned)getFixed(this->data + 16, 4);
+  this->interval = (int)getFixed(this->data + 20, 4);
+  this->index = getFixed(footer, 8);
+  this->chunks = (int)getFixed(footer + 8, 4);
+  this->pieces = (int)getFixed(footer + 12, 4);
+
+  // The board has to fit a piece, the walls and the hash tables, and pieces
+  // have to fall, or seeking replays ticks forever
+  const bool sized = this->rows >= 4 && this->rows <= Zobrist::MAX_ROWS &&
+                     this->cols >= 4 && this->cols <= 62 &&
+                     this->gravity >= 1.0 / (60 * TICK_RATE) && this->gravity <= this->rows;
+  const uint64_t body = this->size - FOOTER_SIZE;
+  if (!sized || this->chunks < 1 || this->interval < 1 || this->index < HEADER_SIZE ||
+      this->index > body || (body - this->index) / INDEX_ENTRY != (uint64_t)this->chunks ||
+      (body - this->index) % INDEX_ENTRY != 0) {
+    this->close();
+    return false;
+  }
+
+  // Seeks search the snapshots by piece count and read between offsets
+  for (int chunk = 0; chunk < this->chunks; chunk++) {
+    const bool ordered = chunk == 0 ||
+      (this->chunkOffset(chunk) > this->chunkOffset(chunk - 1) &&
+       this->chunkPieces(chunk) > this->chunkPieces(chunk - 1));
+    if (!ordered || this->chunkOffset(chunk) < HEADER_SIZE ||
+        this->chunkOffset(chunk) >= this->index || this->chunkPieces(chunk) < 0) {
+      this->close();
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ Unmaps the file.
+*/
+void ReplayReader::close() {
+  if (this->data)
+    munmap((void*)this->data, this->size);
+  this->data = nullptr;
+  this->size = 0;
+}
+
+/**
+ Puts the board in the state it had right after the given number of pieces
+ were locked: loads the last snapshot at or before that piece, then replays
+ the actions after it.
+
+ @return: true if the replay got that far; false otherwise.
+*/
+bool ReplayReader::seek(Board &board, const int &piece) const {
+  if (!this->data || piece < 0)
+    return false;
+
+  // The last chunk whose snapshot was taken at or before the piece
+  if (piece < this->chunkPieces(0))
+    return false;
+  int low = 0, high = this->chunks - 1;
+  while (low < high) {
+    const int middle = (low + high + 1) / 2;
+    if (this->chunkPieces(middle) <= piece)
+      low = middle;
+    else
+      high = middle - 1;
+  }
+  const int chunk = low;
+  const uint8_t *p = this->data + this->chunkOffset(chunk);
+  const uint8_t *end = this->data + this->chunkOffset(chunk + 1);
+  if (p >= end || end > this->data + this->index)
+    return false;
+
+  // Load the snapshot into a fresh board
+  board = Board(this->rows, this->cols, this->gravity, this->seed);
+  uint64_t pieces, lines, score, lock_ticks, x, y, length;
+  if (!getVarint(p, end, pieces) || !getVarint(p, end, lines) ||
+      !getVarint(p, end, score) || !getVarint(p, end, lock_ticks) || end - p < 11)
+    return false;
+  board.pieces = (int)pieces;
+  board.lines = (int)lines;
+  board.score = (int)score;
+  board.lock_ticks = (int)lock_ticks;
+  board.gravity_progress = bitsDouble(getFixed(p, 8));
+  board.over = p[8] != 0;
+  // The counters have to be ones a tick could have left behind
+  if ((int)pieces != this->chunkPieces(chunk) || lock_ticks >= Board::LOCK_DELAY ||
+      !(board.gravity_progress >= 0 && board.gravity_progress < 1))
+    return false;
+  const PIECE_TYPE type = PIECE_TYPE(p[9] % 7);
+  const int rotation = p[10] & 3;
+  p += 11;
+
+  if (!getVarint(p, end, x) || !getVarint(p, end, y) || !getVarint(p, end, length) ||
+      x > 0xFF || y > 0xFF || (uint64_t)(end - p) < length)
+    return false;
+  // The piece has to be on the board, or building its footprint overflows
+  const Point pivot = { unzigzag(x), unzigzag(y) };
+  const Shape &shape = SHAPES.shapes[type][rotation];
+  if (pivot.x + shape.left < 0 || pivot.x + shape.right >= this->cols ||
+      pivot.y + shape.top < -4 || pivot.y >= this->rows)
+    return false;
+  board.active = Piece(type, rotation, pivot);
+  // A generator stuck on 0 or past its modulus never draws a piece again. The
+  // engine's own >> doesn't skip leading whitespace, so seed from the value
+  // checked here, which sets the state to exactly that value
+  std::istringstream state(string((const char*)p, length));
+  uint64_t value;
+  if (!(state >> value) || value < 1 || value >= default_random_engine::modulus)
+    return false;
+  board.generator.seed((default_random_engine::result_type)value);
+  p += length;
+
+  const uint64_t cells = (uint64_t(1) << this->cols) - 1;
+  for (int i = 0; i < this->rows; i++) {
+    uint64_t mask;
+    if (!getVarint(p, end, mask) || (mask & ~cells))
+      return false;
+
+    int n = 0;
+    for (uint64_t m = mask; m; m &= m - 1, n++) {
+      if (p >= end)
+        return false;
+      const uint8_t color = n & 1 ? *p++ >> 4 : *p & 0x0F;
+      board.board.set(i, __builtin_ctzll(m), color);
+    }
+    if (n & 1)
+      p++;
+  }
+
+  // Replay until the piece locks or the chunk runs out
+  while (board.getPieces() < piece && !board.isOver() && p < end) {
+    uint64_t token;
+    if (!getVarint(p, end, token) || (token & 7) > TICK)
+      return false;
+    for (uint64_t ticks = token >> 3; ticks > 0 && board.getPieces() < piece && !board.isOver();
+         ticks--)
+      board.step(TICK);
+    if (board.getPieces() < piece)
+      board.step(ACTION(token & 7));
+  }
+
+  return board.getPieces() == piece;
+}
+
+// Gets the number of pieces locked in the whole game
+int ReplayReader::getPieces() const {
+  return this->pieces;
+}
+
+// Gets the number of pieces between snapshots
+int ReplayReader::getInterval() const {
+  return this->interval;
+}
+
+// Gets the seed the game started from
+unsigned ReplayReader::getSeed() const {
+  return this->seed;
+}
+
+// --- END ReplayReader ---
@@ -0,0 +1,194 @@
+//
+//  Replay.hpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/17/21.
+//
+
+#ifndef Replay_hpp
+#define Replay_hpp
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "Board.hpp"
+
+using std::string;
+using std::vector;
+
+// A replay file is laid out as:
+//
+//   header   "TRPL", version, rows, cols, gravity, seed, snapshot interval
+//   chunks   a snapshot of the whole game, then the actions that follow it:
+//            one where recording started, then one every time the piece
+//            count reaches a multiple of `interval`
+//   index    the file offset (8 bytes) and piece count (4 bytes) of every
+//            chunk's snapshot
+//   footer   index offset, # of chunks, # of pieces, "TRPE"
+//
+// Recording can start mid-game, so the piece counts in the index are what a
+// seek goes by, not the interval.
+//
+// Only actions that changed the game are stored. Each one is a varint of
+// (ticks << 3 | action): that many TICKs, then the action. Runs of gravity
+// collapse into the next input, so a piece usually costs a few bytes.
+
+/**
+ Records a game as it is played. Feed every action through step() instead of
+ calling Board::step directly.
+*/
+class ReplayWriter {
+private:
+  /**
+   The open file, and the # of bytes already written to it.
+  */
+  FILE *file;
+  uint64_t written;
+  /**
+   Bytes not yet written to the file.
+  */
+  vector<uint8_t> buffer;
+  /**
+   File offset and piece count of every chunk so far.
+  */
+  vector<uint64_t> index;
+  vector<int> starts;
+  /**
+   # of pieces between snapshots.
+  */
+  int interval;
+  /**
+   TICKs applied since the last action was stored.
+  */
+  uint64_t ticks;
+  /**
+   Pieces locked by the end of the last step.
+  */
+  int pieces;
+
+  /**
+   Stores the pending TICKs, followed by the given action.
+  */
+  void writeAction(const ACTION &action);
+
+  /**
+   Starts a new chunk with a snapshot of the board.
+  */
+  void writeSnapshot(const Board &board);
+
+  /**
+   Writes the buffer to the file.
+  */
+  void flush();
+
+public:
+  ReplayWriter();
+
+  /**
+   Finishes the file if it is still open.
+  */
+  ~ReplayWriter();
+
+  ReplayWriter(const ReplayWriter &) = delete;
+  ReplayWriter& operator=(const ReplayWriter &) = delete;
+
+  /**
+   Starts recording a game from the board's current state.
+
+   @param interval - # of pieces between snapshots.
+   @return: true if the file was created; false otherwise.
+  */
+  bool open(const string &path, const Board &board, const int &interval = 64);
+
+  /**
+   Applies an action to the board and records it.
+
+   @return: what Board::step returned.
+  */
+  bool step(Board &board, const ACTION &action);
+
+  /**
+   Writes the index and footer and closes the file.
+
+   @return: true if everything was written; false otherwise.
+  */
+  bool close();
+};
+
+/**
+ Opens a replay by mapping it into memory. Seeking to any piece loads the
+ nearest snapshot before it and replays at most `interval` pieces of actions.
+ Pieces locked before recording started can't be reached.
+*/
+class ReplayReader {
+private:
+  /**
+   The mapped file.
+  */
+  const uint8_t *data;
+  size_t size;
+  /**
+   Values from the header and footer.
+  */
+  int rows;
+  int cols;
+  double gravity;
+  unsigned seed;
+  int interval;
+  int chunks;
+  int pieces;
+  /**
+   Where the chunk index starts.
+  */
+  uint64_t index;
+
+  /**
+   @return: the file offset of a chunk, or of the index for chunk == chunks.
+  */
+  uint64_t chunkOffset(const int &chunk) const;
+
+  /**
+   @return: the # of pieces locked when a chunk's snapshot was taken.
+  */
+  int chunkPieces(const int &chunk) const;
+
+public:
+  ReplayReader();
+
+  /**
+   Unmaps the file if one is open.
+  */
+  ~ReplayReader();
+
+  ReplayReader(const ReplayReader &) = delete;
+  ReplayReader& operator=(const ReplayReader &) = delete;
+
+  /**
+   Maps a replay file and checks its header, footer and index.
+
+   @return: true if it is a complete replay; false otherwise.
+  */
+  bool open(const string &path);
+
+  /**
+   Unmaps the file.
+  */
+  void close();
+
+  /**
+   Puts the board in the state it had right after the given number of pieces
+   were locked.
+
+   @return: true if the replay got that far; false if it didn't or the file is
+   damaged there, leaving the board at the last state it reached.
+  */
+  bool seek(Board &board, const int &piece) const;
+
+  // Getters
+  int getPieces() const;
+  int getInterval() const;
+  unsigned getSeed() const;
+};
+
+#endif /* Replay_hpp */
@@ -0,0 +1,438 @@
+//
+//  Server.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/22/21.
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "Clock.hpp"
+#include "Server.hpp"
+
+/**
+ Most output a session can have waiting on its socket. A client that falls
+ further behind than this is dropped.
+*/
+static const size_t MAX_PENDING = 1 << 16;
+
+// --- BEGIN PRIVATE ---
+
+/**
+ Adds a bound socket to the listeners.
+
+ @return: true if it is listening; false otherwise.
+*/
+bool Server::addListener(const int &fd) {
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = fd;
+  if (listen(fd, SOMAXCONN) < 0 || epoll_ctl(this->epoll, EPOLL_CTL_ADD, fd, &event) < 0) {
+    close(fd);
+    return false;
+  }
+
+  this->listeners.push_back(fd);
+  return true;
+}
+
+/**
+ Accepts every pending connection on a listener. Each one becomes a session
+ on the shard its id maps to.
+*/
+void Server::accept(const int &listener) {
+  while (true) {
+    const int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0)
+      return;
+
+    // Updates are tiny, so don't let them wait to be batched. Fails harmlessly
+    // on Unix sockets.
+    const int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    epoll_event event = {};
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.fd = fd;
+    if (epoll_ctl(this->epoll, EPOLL_CTL_ADD, fd, &event) < 0) {
+      close(fd);
+      continue;
+    }
+
+    const uint32_t session = this->next_session++;
+    this->connections[fd] = { session, {} };
+    this->post({ CMD_CONNECT, session, fd, 0, TICK });
+    this->sessions++;
+  }
+}
+
+/**
+ Reads what a connection sent and passes each whole message to its shard.
+ Partial messages wait in the connection's buffer for the rest.
+
+ @return: false if the connection is done or broken; true otherwise.
+*/
+bool Server::read(const int &fd, Connection &connection) {
+  uint8_t buffer[4096];
+  while (true) {
+    const ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+    if (n > 0) {
+      connection.in.insert(connection.in.end(), buffer, buffer + n);
+      continue;
+    }
+    if (n == 0)
+      return false;
+    if (errno == EAGAIN || errno == EWOULDBLOCK)
+      break;
+    if (errno != EINTR)
+      return false;
+  }
+
+  size_t offset = 0;
+  while (true) {
+    MESSAGE type;
+    const uint8_t *body;
+    int length;
+    const int size = Protocol::frame(connection.in.data() + offset, connection.in.size() - offset,
+                                     type, body, length);
+    if (size < 0)
+      return false;
+    if (size == 0)
+      break;
+    offset += size;
+
+    uint32_t value;
+    ACTION action;
+    if (type == MSG_START && Protocol::decodeStart(body, length, value))
+      this->post({ CMD_START, connection.session, fd, value, TICK });
+    else if (type == MSG_INPUT && Protocol::decodeInput(body, length, value, action))
+      this->post({ CMD_INPUT, connection.session, fd, value, action });
+    else
+      return false;
+  }
+
+  connection.in.erase(connection.in.begin(), connection.in.begin() + offset);
+  return true;
+}
+
+/**
+ Queues a command for the shard that owns the session. It is handed over by
+ deliver().
+*/
+void Server::post(const Command &command) {
+  this->outbox[command.session % this->shards.size()].push_back(command);
+}
+
+/**
+ Hands the queued commands to their shards and wakes them.
+*/
+void Server::deliver() {
+  for (size_t i = 0; i < this->shards.size(); i++) {
+    if (this->outbox[i].empty())
+      continue;
+
+    Shard &shard = *this->shards[i];
+    {
+      std::lock_guard<std::mutex> lock(shard.lock);
+      shard.inbox.insert(shard.inbox.end(), this->outbox[i].begin(), this->outbox[i].end());
+    }
+    shard.wake.notify_one();
+    this->outbox[i].clear();
+  }
+}
+
+/**
+ The loop each simulation thread runs. Sleeps until the next tick is due or a
+ command arrives, so inputs are applied and answered right away instead of
+ waiting for the tick.
+*/
+void Server::simulate(Shard &shard) {
+  const auto epoch = std::chrono::steady_clock::now();
+  const auto now = [&]() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch).count();
+  };
+
+  Clock clock;
+  clock.advance(now());
+  vector<Command> work;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(shard.lock);
+      const double wait = clock.getTime() + clock.getStep() - now();
+      shard.wake.wait_for(lock, std::chrono::duration<double>(std::max(wait, 0.0)), [&]() {
+        return !shard.inbox.empty() || this->stopping;
+      });
+      work.swap(shard.inbox);
+    }
+
+    for (const Command &command : work)
+      this->handle(shard, command);
+    work.clear();
+    if (this->stopping)
+      break;
+
+    // Gravity for every game, then one update for each that changed
+    const int ticks = clock.advance(now());
+    if (ticks == 0)
+      continue;
+    for (auto &entry : shard.sessions) {
+      Session &session = entry.second;
+      if (session.started && !session.board.isOver()) {
+        for (int i = 0; i < ticks; i++)
+          session.board.step(TICK);
+
+        const Point &pivot = session.board.getActive().getPivot();
+        if (pivot.x != session.pivot.x || pivot.y != session.pivot.y ||
+            session.board.getPieces() != session.pieces) {
+          this->sendState(session, 0);
+          continue;
+        }
+      }
+      // Retry whatever the socket wasn't ready for last time
+      this->flush(session);
+    }
+  }
+
+  // Close every socket this shard owns, including ones it never got to see
+  {
+    std::lock_guard<std::mutex> lock(shard.lock);
+    work.swap(shard.inbox);
+  }
+  for (const Command &command : work)
+    this->handle(shard, command);
+  for (auto &entry : shard.sessions)
+    close(entry.second.fd);
+  shard.sessions.clear();
+}
+
+/**
+ Applies one command to the shard's sessions.
+*/
+void Server::handle(Shard &shard, const Command &command) {
+  if (command.type == CMD_CONNECT) {
+    Session &session = shard.sessions[command.session];
+    session.fd = command.fd;
+    session.started = false;
+    return;
+  }
+
+  auto found = shard.sessions.find(command.session);
+  if (found == shard.sessions.end())
+    return;
+  Session &session = found->second;
+
+  switch (command.type) {
+    case CMD_START:
+      session.board = Board(ROWS, COLS, 1.0 / TICK_RATE, command.value);
+      session.started = true;
+      // Force the stack into the first update
+      session.pieces = -1;
+      this->sendState(session, 0);
+      break;
+    case CMD_INPUT:
+      // Every input is answered, even one that did nothing, so the client can
+      // match up its sequence #s
+      if (!session.started)
+        break;
+      if (!session.board.isOver())
+        session.board.step(command.action);
+      this->sendState(session, command.value);
+      break;
+    case CMD_DISCONNECT:
+      close(session.fd);
+      shard.sessions.erase(found);
+      break;
+    case CMD_CONNECT:
+      break;
+  }
+}
+
+/**
+ Sends a STATE for the session. The stack only changes when a piece locks, so
+ it is only included when the piece count moved.
+*/
+void Server::sendState(Session &session, const uint32_t &sequence) {
+  const int pieces = session.board.getPieces();
+  Protocol::encodeState(session.out, sequence, session.board, pieces != session.pieces);
+  session.pivot = session.board.getActive().getPivot();
+  session.pieces = pieces;
+  this->flush(session);
+}
+
+/**
+ Writes as much of the session's pending output as the socket takes. A client
+ that errors or falls too far behind has its socket shut down, which the
+ network thread sees as a disconnect.
+*/
+void Server::flush(Session &session) {
+  if (session.out.empty())
+    return;
+
+  const ssize_t n = send(session.fd, session.out.data(), session.out.size(),
+                         MSG_NOSIGNAL | MSG_DONTWAIT);
+  if (n > 0)
+    session.out.erase(session.out.begin(), session.out.begin() + n);
+
+  const bool failed = n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR;
+  if (failed || session.out.size() > MAX_PENDING) {
+    shutdown(session.fd, SHUT_RDWR);
+    session.out.clear();
+  }
+}
+
+// --- END PRIVATE ---
+
+// --- BEGIN PUBLIC ---
+
+/**
+ Public constructor. Starts the simulation threads right away; they sleep
+ until there is something to do.
+
+ @param threads - # of simulation threads.
+*/
+Server::Server(const int &threads) {
+  this->epoll = epoll_create1(EPOLL_CLOEXEC);
+  this->next_session = 0;
+  this->stopping = false;
+  this->sessions = 0;
+
+  const int count = std::max(threads, 1);
+  this->outbox.resize(count);
+  for (int i = 0; i < count; i++)
+    this->shards.emplace_back(new Shard());
+  for (int i = 0; i < count; i++) {
+    Shard *shard = this->shards[i].get();
+    shard->thread = std::thread([this, shard]() { this->simulate(*shard); });
+  }
+}
+
+/**
+ Stops the threads and closes every socket.
+*/
+Server::~Server() {
+  this->stop();
+  this->deliver();
+  for (const std::unique_ptr<Shard> &shard : this->shards) {
+    shard->wake.notify_one();
+    shard->thread.join();
+  }
+
+  for (const int &fd : this->listeners)
+    close(fd);
+  for (const string &path : this->paths)
+    unlink(path.c_str());
+  close(this->epoll);
+}
+
+/**
+ Listens for TCP connections on the loopback interface.
+
+ @return: true if it is listening; false otherwise.
+*/
+bool Server::listenTcp(const int &port) {
+  const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return false;
+
+  const int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons((uint16_t)port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(fd, (const sockaddr *)&address, sizeof(address)) < 0) {
+    close(fd);
+    return false;
+  }
+
+  return this->addListener(fd);
+}
+
+/**
+ Listens on a Unix socket at the given path, replacing any file there.
+
+ @return: true if it is listening; false otherwise.
+*/
+bool Server::listenUnix(const string &path) {
+  sockaddr_un address = {};
+  if (path.size() >= sizeof(address.sun_path))
+    return false;
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return false;
+
+  address.sun_family = AF_UNIX;
+  memcpy(address.sun_path, path.c_str(), path.size() + 1);
+  unlink(path.c_str());
+  if (bind(fd, (const sockaddr *)&address, sizeof(address)) < 0) {
+    close(fd);
+    return false;
+  }
+
+  this->paths.push_back(path);
+  return this->addListener(fd);
+}
+
+/**
+ Runs the network loop until stop() is called. Wakes up at least every 100 ms
+ to check.
+*/
+void Server::run() {
+  epoll_event events[256];
+  while (!this->stopping) {
+    const int n = epoll_wait(this->epoll, events, 256, 100);
+    for (int i = 0; i < n; i++) {
+      const int fd = events[i].data.fd;
+      if (std::find(this->listeners.begin(), this->listeners.end(), fd) != this->listeners.end()) {
+        this->accept(fd);
+        continue;
+      }
+
+      auto found = this->connections.find(fd);
+      if (found == this->connections.end())
+        continue;
+
+      // Take whatever was sent before the hangup, then drop the connection.
+      // The shard closes the socket, so its fd can't be reused while the
+      // shard might still write to it.
+      const bool open = this->read(fd, found->second) &&
+                        !(events[i].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR));
+      if (!open) {
+        epoll_ctl(this->epoll, EPOLL_CTL_DEL, fd, nullptr);
+        this->post({ CMD_DISCONNECT, found->second.session, fd, 0, TICK });
+        this->connections.erase(found);
+        this->sessions--;
+      }
+    }
+    this->deliver();
+  }
+}
+
+/**
+ Makes run() return. Safe to call from any thread.
+*/
+void Server::stop() {
+  this->stopping = true;
+  for (const std::unique_ptr<Shard> &shard : this->shards) {
+    std::lock_guard<std::mutex> lock(shard->lock);
+    shard->wake.notify_one();
+  }
+}
+
+// Gets the # of sessions connected
+long Server::getSessions() const {
+  return this->sessions;
+}
+
+// --- END PUBLIC ---
@@ -0,0 +1,203 @@
+//
+//  Server.hpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/22/21.
+//
+
+#ifndef Server_hpp
+#define Server_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Board.hpp"
+#include "Protocol.hpp"
+
+using std::string;
+using std::vector;
+
+/**
+ Hosts many independent games in one process. Each connection is one session
+ with its own headless <Board>, driven over the binary protocol in
+ Protocol.hpp.
+
+ One thread runs an epoll loop that accepts connections and reads their
+ messages. Sessions are sharded across a fixed set of simulation threads by
+ id; each shard owns its boards and their sockets outright, applies inputs as
+ they arrive, runs gravity at TICK_RATE and writes the state updates. The
+ only thing the threads share is each shard's inbox of commands. Linux only.
+*/
+class Server {
+private:
+  // Enums to define what the network thread can ask a shard to do
+  enum COMMAND {
+    CMD_CONNECT, CMD_START, CMD_INPUT, CMD_DISCONNECT
+  };
+
+  struct Command {
+    COMMAND type;
+    uint32_t session;
+    int fd;
+    uint32_t value;
+    ACTION action;
+  };
+
+  /**
+   A game and the socket it talks over. Only its shard touches it.
+  */
+  struct Session {
+    int fd;
+    Board board;
+    /**
+     Bytes the socket wasn't ready for yet.
+    */
+    vector<uint8_t> out;
+    /**
+     What the client was last sent, to tell when gravity changed anything.
+    */
+    Point pivot;
+    int pieces;
+    bool started;
+  };
+
+  /**
+   A simulation thread and the sessions it owns.
+  */
+  struct Shard {
+    std::thread thread;
+    std::mutex lock;
+    std::condition_variable wake;
+    /**
+     Commands from the network thread not handled yet.
+    */
+    vector<Command> inbox;
+    std::unordered_map<uint32_t, Session> sessions;
+  };
+
+  /**
+   A connection as the network thread sees it: which session it is, and the
+   bytes read that don't make a whole message yet.
+  */
+  struct Connection {
+    uint32_t session;
+    vector<uint8_t> in;
+  };
+
+  int epoll;
+  vector<int> listeners;
+  vector<string> paths;
+  vector<std::unique_ptr<Shard>> shards;
+  std::unordered_map<int, Connection> connections;
+  /**
+   Commands for each shard from the current round of events. Handed over in
+   one batch per round so a busy loop doesn't wake the shards for every
+   message.
+  */
+  vector<vector<Command>> outbox;
+  uint32_t next_session;
+  std::atomic<bool> stopping;
+  std::atomic<long> sessions;
+
+  /**
+   Adds a bound socket to the listeners.
+
+   @return: true if it is listening; false otherwise.
+  */
+  bool addListener(const int &fd);
+
+  /**
+   Accepts every pending connection on a listener.
+  */
+  void accept(const int &listener);
+
+  /**
+   Reads what a connection sent and passes each whole message to its shard.
+
+   @return: false if the connection is done or broken; true otherwise.
+  */
+  bool read(const int &fd, Connection &connection);
+
+  /**
+   Queues a command for the shard that owns the session.
+  */
+  void post(const Command &command);
+
+  /**
+   Hands the queued commands to their shards and wakes them.
+  */
+  void deliver();
+
+  /**
+   The loop each simulation thread runs.
+  */
+  void simulate(Shard &shard);
+
+  /**
+   Applies one command to the shard's sessions.
+  */
+  void handle(Shard &shard, const Command &command);
+
+  /**
+   Sends a STATE for the session, with its stack if the stack changed.
+  */
+  void sendState(Session &session, const uint32_t &sequence);
+
+  /**
+   Writes as much of the session's pending output as the socket takes.
+  */
+  void flush(Session &session);
+
+public:
+  /**
+   Public constructor.
+
+   @param threads - # of simulation threads.
+  */
+  Server(const int &threads);
+
+  /**
+   Stops the threads and closes every socket.
+  */
+  ~Server();
+
+  Server(const Server &) = delete;
+  Server& operator=(const Server &) = delete;
+
+  /**
+   Listens for TCP connections on the loopback interface.
+
+   @return: true if it is listening; false otherwise.
+  */
+  bool listenTcp(const int &port);
+
+  /**
+   Listens on a Unix socket at the given path, replacing any file there.
+
+   @return: true if it is listening; false otherwise.
+  */
+  bool listenUnix(const string &path);
+
+  /**
+   Runs the network loop until stop() is called.
+  */
+  void run();
+
+  /**
+   Makes run() return. Safe to call from any thread.
+  */
+  void stop();
+
+  /**
+   Gets the # of sessions connected
+  */
+  long getSessions() const;
+};
+
+#endif /* Server_hpp */
@@ -0,0 +1,318 @@
+//
+//  Spectator.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/25/21.
+//
+
+#include <cstring>
+#include "Spectator.hpp"
+
+// --- BEGIN ENCODING ---
+
+/**
+ Appends an unsigned integer 7 bits at a time, low bits first, with the top
+ bit of each byte set if more follow.
+*/
+static void putVarint(vector<uint8_t> &out, const uint64_t &value) {
+  uint64_t rest = value;
+  while (rest >= 0x80) {
+    out.push_back((uint8_t)(rest | 0x80));
+    rest >>= 7;
+  }
+  out.push_back((uint8_t)rest);
+}
+
+/**
+ Reads an integer written by putVarint(), moving p past it.
+
+ @return: true if a whole one was there; false otherwise.
+*/
+static bool getVarint(const uint8_t *&p, const uint8_t *end, uint64_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 64 && p < end; shift += 7) {
+    const uint8_t byte = *p++;
+    value |= uint64_t(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+/**
+ Masks on the wire count rows from the bottom, where the stack changes, so
+ they fit in a byte or two. Flips a mask between that and row numbers.
+*/
+static uint64_t flipRows(const uint64_t &mask, const int &rows) {
+  uint64_t flipped = 0;
+  for (int row = 0; row < rows; row++)
+    if ((mask >> row) & 1)
+      flipped |= uint64_t(1) << (rows - 1 - row);
+  return flipped;
+}
+
+/**
+ Takes the rows in the mask out of the stack, dropping the rows above them
+ down and filling the top with empty rows, as the board does.
+*/
+static void clearRows(uint16_t *stack, const int &rows, const uint64_t &mask) {
+  int write = rows - 1;
+  for (int row = rows - 1; row >= 0; row--)
+    if (!((mask >> row) & 1))
+      stack[write--] = stack[row];
+  for (; write >= 0; write--)
+    stack[write] = 0;
+}
+
+/**
+ Reads a SPECTATE frame body into the view: a keyframe replaces it, a delta
+ changes it.
+
+ @return: true if the frame was well formed; false otherwise, with the view
+ half changed.
+*/
+static bool parseFrame(const uint8_t *body, const int &length, SpectatorView &view) {
+  if (length < 2)
+    return false;
+  const int flags = body[1];
+  const uint8_t *p = body + 2;
+  const uint8_t *end = body + length;
+
+  if (flags & SPEC_KEYFRAME) {
+    if (end - p < 2 || !(flags & SPEC_PIECE) || !(flags & SPEC_COUNTERS))
+      return false;
+    memset(&view, 0, sizeof(view));
+    view.rows = p[0];
+    view.cols = p[1];
+    p += 2;
+    if (view.rows < 1 || view.rows > 64 || view.cols < 1 || view.cols > 16)
+      return false;
+  }
+  view.cleared = 0;
+  const uint64_t all = view.rows == 64 ? ~uint64_t(0) : (uint64_t(1) << view.rows) - 1;
+
+  if (flags & SPEC_PIECE) {
+    if (end - p < 2 || p[0] > T_BLOCK || p[1] > 3)
+      return false;
+    view.type = PIECE_TYPE(p[0]);
+    view.rotation = p[1];
+    p += 2;
+  }
+  if (flags & (SPEC_PIECE | SPEC_MOVE)) {
+    if (end - p < 2)
+      return false;
+    view.pivot = { (int8_t)p[0], (int8_t)p[1] };
+    p += 2;
+  }
+  if (flags & SPEC_COUNTERS) {
+    uint64_t pieces, lines, score;
+    if (!getVarint(p, end, pieces) || !getVarint(p, end, lines) || !getVarint(p, end, score))
+      return false;
+    view.pieces = (uint32_t)pieces;
+    view.lines = (uint32_t)lines;
+    view.score = (uint32_t)score;
+  }
+  if (flags & SPEC_CLEAR) {
+    uint64_t mask;
+    if (!getVarint(p, end, mask) || (mask & ~all))
+      return false;
+    view.cleared = flipRows(mask, view.rows);
+    clearRows(view.stack, view.rows, view.cleared);
+  }
+  if (flags & SPEC_ROWS) {
+    uint64_t mask;
+    if (!getVarint(p, end, mask) || (mask & ~all) || end - p != 2 * __builtin_popcountll(mask))
+      return false;
+    const uint64_t changed = flipRows(mask, view.rows);
+    for (int row = view.rows - 1; row >= 0; row--) {
+      if (!((changed >> row) & 1))
+        continue;
+      view.stack[row] = (uint16_t)(p[0] | p[1] << 8);
+      p += 2;
+    }
+  }
+  view.over = flags & SPEC_OVER;
+  return p == end;
+}
+
+// --- END ENCODING ---
+
+// --- BEGIN SpectatorEncoder ---
+
+/**
+ Public constructor.
+
+ @param interval - # of frames from one keyframe to the next.
+*/
+SpectatorEncoder::SpectatorEncoder(const int &interval) {
+  this->interval = interval;
+  this->since = 0;
+  this->frame = 0;
+  this->started = false;
+  memset(&this->last, 0, sizeof(this->last));
+}
+
+/**
+ Appends a SPECTATE frame with what changed since the last one. A lock that
+ cleared rows is sent as the rows it cleared plus the ones it filled, so the
+ stack that dropped down isn't sent again.
+
+ @return: the <SPECTATE_FLAG>s of the frame, or 0 if nothing was appended.
+*/
+int SpectatorEncoder::encode(const Board &board, vector<uint8_t> &out) {
+  const Bitboard &b = board.getBitboard();
+  const Piece &active = board.getActive();
+  const int rows = b.getRows();
+  const int cols = b.getCols();
+  SpectatorView &last = this->last;
+
+  const bool key = !this->started || this->since >= this->interval ||
+                   rows != last.rows || cols != last.cols;
+  int flags = key ? SPEC_KEYFRAME | SPEC_PIECE | SPEC_COUNTERS | SPEC_ROWS : 0;
+
+  // Only the last lock's clear is known, so it is only used if there was one
+  uint64_t cleared = 0;
+  if (!key && board.getPieces() == (int)last.pieces + 1)
+    cleared = board.getCleared();
+  if (cleared) {
+    flags |= SPEC_CLEAR;
+    clearRows(last.stack, rows, cleared);
+  }
+
+  const uint64_t cells = (uint64_t(1) << cols) - 1;
+  uint16_t stack[64];
+  uint64_t changed = 0;
+  for (int row = 0; row < rows; row++) {
+    stack[row] = (uint16_t)((b.getRow(row) >> 1) & cells);
+    if (key ? stack[row] != 0 : stack[row] != last.stack[row])
+      changed |= uint64_t(1) << row;
+  }
+  if (changed)
+    flags |= SPEC_ROWS;
+
+  const Point &pivot = active.getPivot();
+  if (!key) {
+    if (active.getType() != last.type || active.getRotation() != last.rotation)
+      flags |= SPEC_PIECE;
+    else if (pivot.x != last.pivot.x || pivot.y != last.pivot.y)
+      flags |= SPEC_MOVE;
+    if ((uint32_t)board.getPieces() != last.pieces || (uint32_t)board.getLines() != last.lines ||
+        (uint32_t)board.getScore() != last.score)
+      flags |= SPEC_COUNTERS;
+  }
+  if (flags == 0 && board.isOver() == last.over)
+    return 0;
+  if (board.isOver())
+    flags |= SPEC_OVER;
+
+  const size_t start = Protocol::beginFrame(out, MSG_SPECTATE);
+  out.push_back(this->frame);
+  out.push_back((uint8_t)flags);
+  if (key) {
+    out.push_back((uint8_t)rows);
+    out.push_back((uint8_t)cols);
+  }
+  if (flags & SPEC_PIECE) {
+    out.push_back((uint8_t)active.getType());
+    out.push_back((uint8_t)active.getRotation());
+  }
+  if (flags & (SPEC_PIECE | SPEC_MOVE)) {
+    out.push_back((uint8_t)(int8_t)pivot.x);
+    out.push_back((uint8_t)(int8_t)pivot.y);
+  }
+  if (flags & SPEC_COUNTERS) {
+    putVarint(out, (uint32_t)board.getPieces());
+    putVarint(out, (uint32_t)board.getLines());
+    putVarint(out, (uint32_t)board.getScore());
+  }
+  if (flags & SPEC_CLEAR)
+    putVarint(out, flipRows(cleared, rows));
+  if (flags & SPEC_ROWS) {
+    putVarint(out, flipRows(changed, rows));
+    for (int row = rows - 1; row >= 0; row--) {
+      if (!((changed >> row) & 1))
+        continue;
+      out.push_back((uint8_t)stack[row]);
+      out.push_back((uint8_t)(stack[row] >> 8));
+    }
+  }
+  Protocol::endFrame(out, start);
+
+  // Remember what the viewers have now
+  last.rows = rows;
+  last.cols = cols;
+  memcpy(last.stack, stack, rows * sizeof(uint16_t));
+  last.type = active.getType();
+  last.rotation = active.getRotation();
+  last.pivot = pivot;
+  last.pieces = (uint32_t)board.getPieces();
+  last.lines = (uint32_t)board.getLines();
+  last.score = (uint32_t)board.getScore();
+  last.over = board.isOver();
+  last.cleared = cleared;
+  this->started = true;
+  this->since = key ? 1 : this->since + 1;
+  this->frame++;
+  return flags;
+}
+
+/**
+ Makes the next frame a keyframe.
+*/
+void SpectatorEncoder::keyframe() {
+  this->started = false;
+}
+
+// --- END SpectatorEncoder ---
+
+// --- BEGIN SpectatorDecoder ---
+
+/**
+ Public constructor. Waits for a keyframe.
+*/
+SpectatorDecoder::SpectatorDecoder() {
+  memset(&this->view, 0, sizeof(this->view));
+  this->synced = false;
+  this->frame = 0;
+}
+
+/**
+ Applies the body of a SPECTATE frame, keeping it only if the whole frame made
+ sense.
+
+ @return: true if the view is up to date with the frame; false otherwise.
+*/
+bool SpectatorDecoder::apply(const uint8_t *body, const int &length) {
+  // A delta only means something on top of the frame before it
+  const bool key = length >= 2 && (body[1] & SPEC_KEYFRAME);
+  const bool next_frame = length >= 2 && body[0] == (uint8_t)(this->frame + 1);
+  SpectatorView next = this->view;
+  if (!(key || (this->synced && next_frame)) || !parseFrame(body, length, next)) {
+    this->synced = false;
+    return false;
+  }
+
+  this->view = next;
+  this->frame = body[0];
+  this->synced = true;
+  return true;
+}
+
+/**
+ Waits for the next keyframe.
+*/
+void SpectatorDecoder::reset() {
+  this->synced = false;
+}
+
+// Checks if the view is following the feed
+bool SpectatorDecoder::isSynced() const {
+  return this->synced;
+}
+
+// Gets the game as of the last frame applied
+const SpectatorView& SpectatorDecoder::getView() const {
+  return this->view;
+}
+
+// --- END SpectatorDecoder ---
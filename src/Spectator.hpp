@@ -0,0 +1,154 @@
+//
+//  Spectator.hpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/25/21.
+//
+
+#ifndef Spectator_hpp
+#define Spectator_hpp
+
+#include <cstdint>
+#include <vector>
+#include "Board.hpp"
+#include "Protocol.hpp"
+
+using std::vector;
+
+// A spectator feed is a run of SPECTATE frames (see Protocol.hpp), each one
+// only what changed since the frame before:
+//
+//   frame    u8, # of the frame mod 256
+//   flags    u8, a set of <SPECTATE_FLAG>
+//   size     u8 rows, u8 cols; keyframes only
+//   piece    u8 type, u8 rotation, i8 x, i8 y; with SPEC_PIECE
+//            i8 x, i8 y; with SPEC_MOVE
+//   counters varint pieces, lines, score; with SPEC_COUNTERS
+//   clear    varint mask of the rows cleared, as they were; with SPEC_CLEAR
+//   rows     varint mask of the rows that follow, then one u16 per row, column
+//            c at bit c; with SPEC_ROWS
+//
+// A keyframe has everything, with only the rows that aren't empty. A frame is
+// only sent when something changed, so while a piece falls one row a second
+// most ticks send nothing, and the ones that do are 7 bytes with the framing.
+// A viewer can start at any keyframe, and one that misses a frame waits for
+// the next keyframe.
+
+// Enums to define what a spectator frame carries
+enum SPECTATE_FLAG {
+  SPEC_KEYFRAME = 1,
+  SPEC_PIECE = 2,
+  SPEC_MOVE = 4,
+  SPEC_COUNTERS = 8,
+  SPEC_CLEAR = 16,
+  SPEC_ROWS = 32,
+  SPEC_OVER = 64
+};
+
+/**
+ The game as a spectator sees it.
+*/
+struct SpectatorView {
+  int rows;
+  int cols;
+  /**
+   One mask per row, column c at bit c.
+  */
+  uint16_t stack[64];
+  /**
+   The active piece.
+  */
+  PIECE_TYPE type;
+  int rotation;
+  Point pivot;
+  uint32_t pieces;
+  uint32_t lines;
+  uint32_t score;
+  bool over;
+  /**
+   Rows cleared by the last frame, as they were before the clear, for drawing
+   the clear. 0 if it cleared none.
+  */
+  uint64_t cleared;
+};
+
+/**
+ Turns a game into a spectator feed. Keeps what the viewers were last sent, so
+ each frame only has what changed since.
+*/
+class SpectatorEncoder {
+private:
+  /**
+   # of frames between keyframes.
+  */
+  int interval;
+  int since;
+  uint8_t frame;
+  bool started;
+  /**
+   What a viewer has after the last frame.
+  */
+  SpectatorView last;
+
+public:
+  /**
+   Public constructor.
+
+   @param interval - # of frames from one keyframe to the next.
+  */
+  SpectatorEncoder(const int &interval = 60);
+
+  /**
+   Appends a SPECTATE frame with what changed since the last one, or a
+   keyframe if one is due. Call it after every step of the board: a lock is
+   only sent as a clear when it was the only one since the frame before.
+   The board must be at most 64 rows by 16 cols.
+
+   @return: the <SPECTATE_FLAG>s of the frame, or 0 if nothing changed and
+   nothing was appended.
+  */
+  int encode(const Board &board, vector<uint8_t> &out);
+
+  /**
+   Makes the next frame a keyframe.
+  */
+  void keyframe();
+};
+
+/**
+ Follows a spectator feed.
+*/
+class SpectatorDecoder {
+private:
+  SpectatorView view;
+  /**
+   Set once a keyframe was applied, and cleared when a frame is missed.
+  */
+  bool synced;
+  uint8_t frame;
+
+public:
+  /**
+   Public constructor. Waits for a keyframe.
+  */
+  SpectatorDecoder();
+
+  /**
+   Applies the body of a SPECTATE frame. Frames are skipped until a keyframe,
+   and a frame out of order or malformed drops back to waiting for one.
+
+   @return: true if the view is up to date with the frame; false otherwise.
+  */
+  bool apply(const uint8_t *body, const int &length);
+
+  /**
+   Waits for the next keyframe, as after missing frames.
+  */
+  void reset();
+
+  // Getters
+  bool isSynced() const;
+  const SpectatorView& getView() const;
+};
+
+#endif /* Spectator_hpp */
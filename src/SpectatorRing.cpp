@@ -0,0 +1,227 @@
+//
+//  SpectatorRing.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/25/21.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "SpectatorRing.hpp"
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+              "the ring's counters must be lock-free to work across processes");
+
+// --- BEGIN PRIVATE ---
+
+/**
+ Maps the memory behind an open descriptor and closes the descriptor.
+
+ @return: true if it is mapped; false otherwise.
+*/
+bool SpectatorRing::map(const int &fd, const size_t &length, const bool &writable) {
+  void *memory = mmap(nullptr, length, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                      MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (memory == MAP_FAILED)
+    return false;
+
+  this->header = (SpectatorRingHeader *)memory;
+  this->data = (uint8_t *)(this->header + 1);
+  this->length = length;
+  return true;
+}
+
+// --- END PRIVATE ---
+
+// --- BEGIN PUBLIC ---
+
+/**
+ Public constructor. The ring starts closed.
+*/
+SpectatorRing::SpectatorRing() {
+  this->header = nullptr;
+  this->data = nullptr;
+  this->length = 0;
+  this->owner = false;
+}
+
+/**
+ Closes the ring, removing it if this is the writer.
+*/
+SpectatorRing::~SpectatorRing() {
+  this->close();
+}
+
+/**
+ Creates the ring as its writer. The header is filled in before the magic is
+ written, so a viewer attaching early never sees half of it.
+
+ @return: true if it was created; false otherwise.
+*/
+bool SpectatorRing::create(const string &name, const size_t &capacity) {
+  this->close();
+
+  size_t size = 1;
+  while (size < capacity)
+    size <<= 1;
+  const size_t length = sizeof(SpectatorRingHeader) + size;
+
+  shm_unlink(name.c_str());
+  const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0)
+    return false;
+  if (ftruncate(fd, (off_t)length) != 0) {
+    ::close(fd);
+    shm_unlink(name.c_str());
+    return false;
+  }
+  if (!this->map(fd, length, true)) {
+    shm_unlink(name.c_str());
+    return false;
+  }
+  this->owner = true;
+  this->name = name;
+
+  SpectatorRingHeader *header = this->header;
+  header->version = SpectatorRing::VERSION;
+  header->capacity = size;
+  header->written.store(0, std::memory_order_relaxed);
+  header->writing.store(0, std::memory_order_relaxed);
+  header->keyframe.store(SpectatorRing::NO_KEYFRAME, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(header->magic, "TSPR", 4);
+  return true;
+}
+
+/**
+ Opens a ring someone else writes, read-only.
+
+ @return: true if it is a valid ring; false otherwise.
+*/
+bool SpectatorRing::attach(const string &name) {
+  this->close();
+
+  const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0)
+    return false;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(SpectatorRingHeader)) {
+    ::close(fd);
+    return false;
+  }
+  if (!this->map(fd, (size_t)info.st_size, false))
+    return false;
+
+  const SpectatorRingHeader *header = this->header;
+  const bool valid = memcmp(header->magic, "TSPR", 4) == 0 &&
+                     header->version == SpectatorRing::VERSION &&
+                     header->capacity > 0 && (header->capacity & (header->capacity - 1)) == 0 &&
+                     this->length == sizeof(SpectatorRingHeader) + header->capacity;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (!valid) {
+    this->close();
+    return false;
+  }
+  return true;
+}
+
+/**
+ Unmaps the ring, and removes it if this is the writer. Viewers that have it
+ mapped keep their mapping.
+*/
+void SpectatorRing::close() {
+  if (this->header)
+    munmap(this->header, this->length);
+  if (this->owner)
+    shm_unlink(this->name.c_str());
+  this->header = nullptr;
+  this->data = nullptr;
+  this->length = 0;
+  this->owner = false;
+  this->name.clear();
+}
+
+/**
+ Appends whole frames. Marks the bytes as being written first, then copies
+ them in, wrapping around the end, then publishes them.
+
+ @return: true if it was published; false if it is over half the ring.
+*/
+bool SpectatorRing::publish(const uint8_t *frames, const size_t &size, const bool &keyframe) {
+  if (!this->owner || size > this->header->capacity / 2)
+    return false;
+
+  SpectatorRingHeader *header = this->header;
+  const uint64_t capacity = header->capacity;
+  const uint64_t start = header->written.load(std::memory_order_relaxed);
+  header->writing.store(start + size, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  const size_t offset = (size_t)(start & (capacity - 1));
+  const size_t first = std::min(size, (size_t)capacity - offset);
+  memcpy(this->data + offset, frames, first);
+  memcpy(this->data, frames + first, size - first);
+
+  header->written.store(start + size, std::memory_order_release);
+  if (keyframe)
+    header->keyframe.store(start, std::memory_order_release);
+  return true;
+}
+
+/**
+ Copies everything published after the cursor. The copy can race with the
+ writer lapping the reader, so it is only trusted if the writer hadn't started
+ on those bytes by the time it was done, as with a seqlock.
+
+ @return: RING_DATA if there was something, RING_EMPTY if not, and RING_LOST
+ if the writer overwrote part of it.
+*/
+RING_READ SpectatorRing::read(uint64_t &cursor, vector<uint8_t> &out) const {
+  const SpectatorRingHeader *header = this->header;
+  const uint64_t capacity = header->capacity;
+  const uint64_t end = header->written.load(std::memory_order_acquire);
+  if (end == cursor)
+    return RING_EMPTY;
+  if (end < cursor || end - cursor > capacity)
+    return RING_LOST;
+
+  const size_t size = (size_t)(end - cursor);
+  const size_t offset = (size_t)(cursor & (capacity - 1));
+  const size_t first = std::min(size, (size_t)capacity - offset);
+  out.resize(size);
+  memcpy(out.data(), this->data + offset, first);
+  memcpy(out.data() + first, this->data, size - first);
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (header->writing.load(std::memory_order_relaxed) - cursor > capacity)
+    return RING_LOST;
+
+  cursor = end;
+  return RING_DATA;
+}
+
+/**
+ @return: where a new viewer should start: the latest keyframe, or the end of
+ the stream if there isn't one yet.
+*/
+uint64_t SpectatorRing::getKeyframe() const {
+  const uint64_t keyframe = this->header->keyframe.load(std::memory_order_acquire);
+  return keyframe == SpectatorRing::NO_KEYFRAME ? this->getWritten() : keyframe;
+}
+
+// Gets the # of bytes published so far
+uint64_t SpectatorRing::getWritten() const {
+  return this->header->written.load(std::memory_order_acquire);
+}
+
+// Checks if a ring is open
+bool SpectatorRing::isOpen() const {
+  return this->header != nullptr;
+}
+
+// --- END PUBLIC ---
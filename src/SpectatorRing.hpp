@@ -0,0 +1,140 @@
+//
+//  SpectatorRing.hpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/25/21.
+//
+
+#ifndef SpectatorRing_hpp
+#define SpectatorRing_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+// Enums to define what a read from a <SpectatorRing> found
+enum RING_READ {
+  RING_EMPTY, RING_DATA, RING_LOST
+};
+
+/**
+ Start of a ring's shared memory. The data follows it directly.
+*/
+struct SpectatorRingHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t capacity;
+  /**
+   # of bytes ever published; everything before it is whole frames.
+  */
+  std::atomic<uint64_t> written;
+  /**
+   # of bytes published once the frame being written is done. Moves before
+   the frame's bytes are written, so a reader can tell if they overwrote
+   what it just copied.
+  */
+  std::atomic<uint64_t> writing;
+  /**
+   Where the latest keyframe starts, or NO_KEYFRAME.
+  */
+  std::atomic<uint64_t> keyframe;
+};
+
+/**
+ Fans one spectator feed out to any number of local viewers through POSIX
+ shared memory. The writer appends frames to a ring of bytes and never waits
+ for anyone; each viewer maps the same memory read-only and keeps its own
+ position in the stream, so viewers cost the writer nothing and can't hold
+ each other up. A viewer that falls a whole ring behind is told so and jumps
+ to the latest keyframe. Linux only.
+*/
+class SpectatorRing {
+private:
+  SpectatorRingHeader *header;
+  uint8_t *data;
+  size_t length;
+  /**
+   Set for the writer, which removes the memory when it closes.
+  */
+  bool owner;
+  string name;
+
+  /**
+   Maps the memory behind an open descriptor.
+
+   @return: true if it is mapped; false otherwise.
+  */
+  bool map(const int &fd, const size_t &length, const bool &writable);
+
+public:
+  static const uint32_t VERSION = 1;
+  static const uint64_t NO_KEYFRAME = ~uint64_t(0);
+
+  /**
+   Public constructor. The ring starts closed.
+  */
+  SpectatorRing();
+
+  /**
+   Closes the ring, removing it if this is the writer.
+  */
+  ~SpectatorRing();
+
+  SpectatorRing(const SpectatorRing &) = delete;
+  SpectatorRing& operator=(const SpectatorRing &) = delete;
+
+  /**
+   Creates the ring as its writer, replacing any ring with the name. The
+   capacity is rounded up to a power of two.
+
+   @return: true if it was created; false otherwise.
+  */
+  bool create(const string &name, const size_t &capacity);
+
+  /**
+   Opens a ring someone else writes, read-only.
+
+   @return: true if it is a valid ring; false otherwise.
+  */
+  bool attach(const string &name);
+
+  /**
+   Unmaps the ring, and removes it if this is the writer.
+  */
+  void close();
+
+  /**
+   Appends whole frames. Writer only.
+
+   @param keyframe - Whether the data starts with a keyframe.
+   @return: true if it was published; false if it is over half the ring.
+  */
+  bool publish(const uint8_t *frames, const size_t &size, const bool &keyframe);
+
+  /**
+   Copies everything published after the cursor into out and moves the
+   cursor past it.
+
+   @return: RING_DATA if there was something, RING_EMPTY if not, and
+   RING_LOST if the writer overwrote part of it: move the cursor to
+   getKeyframe() and start over.
+  */
+  RING_READ read(uint64_t &cursor, vector<uint8_t> &out) const;
+
+  /**
+   @return: where a new viewer should start: the latest keyframe, or the end
+   of the stream if there isn't one yet.
+  */
+  uint64_t getKeyframe() const;
+
+  // Getters
+  uint64_t getWritten() const;
+  bool isOpen() const;
+};
+
+#endif /* SpectatorRing_hpp */
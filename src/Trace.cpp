@@ -0,0 +1,127 @@
+//
+//  Trace.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/19/21.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Trace.hpp"
+
+using std::vector;
+
+/**
+ One recorded span.
+*/
+struct TraceEvent {
+  const char *name;
+  uint64_t start;
+  uint64_t end;
+};
+
+/**
+ The spans of one thread. Only that thread writes to it. writing moves before
+ an event is written and count after, so a reader can tell which of the events
+ it copied the thread may have been overwriting, as with a seqlock.
+*/
+struct TraceRing {
+  static const int SIZE = 1 << 16;
+  TraceEvent events[SIZE];
+  std::atomic<uint64_t> count;
+  std::atomic<uint64_t> writing;
+  int thread;
+};
+
+/**
+ Every ring ever created. Rings are never freed, so spans from threads that
+ have finished are still written out.
+*/
+static std::mutex rings_lock;
+static vector<std::unique_ptr<TraceRing>> rings;
+static thread_local TraceRing *ring = nullptr;
+
+/**
+ Times are measured from when the program started tracing.
+*/
+static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+/**
+ @return: the current time in nanoseconds on the trace clock.
+*/
+uint64_t Trace::now() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now() - epoch).count();
+}
+
+/**
+ Adds a span to the calling thread's ring, creating the ring on first use.
+*/
+void Trace::record(const char *name, const uint64_t &start, const uint64_t &end) {
+  if (!ring) {
+    std::lock_guard<std::mutex> guard(rings_lock);
+    rings.push_back(std::unique_ptr<TraceRing>(new TraceRing()));
+    ring = rings.back().get();
+    ring->count = 0;
+    ring->writing = 0;
+    ring->thread = (int)rings.size();
+  }
+
+  const uint64_t count = ring->count.load(std::memory_order_relaxed);
+  ring->writing.store(count + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  ring->events[count % TraceRing::SIZE] = { name, start, end };
+  ring->count.store(count + 1, std::memory_order_release);
+}
+
+/**
+ Writes every span still in the rings to a trace-event JSON file, as complete
+ ("X") events in microseconds, one track per thread. Threads keep recording
+ while it runs, so each ring is copied first and the copy is only trusted for
+ the events its thread hadn't started overwriting by the time it was done.
+
+ @return: true if the file was written; false otherwise.
+*/
+bool Trace::write(const string &path) {
+  FILE *file = fopen(path.c_str(), "w");
+  if (!file)
+    return false;
+
+  vector<TraceEvent> copy(TraceRing::SIZE);
+  std::lock_guard<std::mutex> guard(rings_lock);
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  bool first = true;
+  for (const std::unique_ptr<TraceRing> &r : rings) {
+    fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+            "\"args\":{\"name\":\"thread %d\"}}", first ? "" : ",", r->thread, r->thread);
+    first = false;
+
+    // Only the newest SIZE spans are still in the ring
+    const uint64_t size = TraceRing::SIZE;
+    const uint64_t count = r->count.load(std::memory_order_acquire);
+    uint64_t from = count > size ? count - size : 0;
+    for (uint64_t i = from; i < count; i++)
+      copy[i % size] = r->events[i % size];
+
+    // Drop what was overwritten while it was copied
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t writing = r->writing.load(std::memory_order_relaxed);
+    from = std::max(from, writing > size ? writing - size : 0);
+    for (uint64_t i = from; i < count; i++) {
+      const TraceEvent &e = copy[i % size];
+      fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+              "\"ts\":%.3f,\"dur\":%.3f}",
+              e.name, r->thread, e.start / 1e3, (e.end - e.start) / 1e3);
+    }
+  }
+  fprintf(file, "\n]}\n");
+
+  const bool ok = !ferror(file);
+  fclose(file);
+  return ok;
+}
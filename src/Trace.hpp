@@ -0,0 +1,76 @@
+//
+//  Trace.hpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/19/21.
+//
+
+#ifndef Trace_hpp
+#define Trace_hpp
+
+#include <cstdint>
+#include <string>
+
+using std::string;
+
+/**
+ Records timed spans into a ring buffer per thread and writes them out as
+ trace-event JSON, which Perfetto and chrome://tracing can open.
+
+ Each ring keeps the most recent spans of its thread, so writing a trace after
+ a slow frame shows what led up to it. Recording a span takes no locks: a
+ thread only touches its own ring, and the rings are only registered, under a
+ lock, the first time a thread records.
+
+ Spans are added with TRACE_SCOPE, which only does anything when the build
+ defines TETRIS_TRACE. Without it the macro expands to nothing.
+*/
+class Trace {
+public:
+  /**
+   @return: the current time in nanoseconds on the trace clock.
+  */
+  static uint64_t now();
+
+  /**
+   Adds a span to the calling thread's ring. name must outlive the trace, e.g.
+   a string literal.
+  */
+  static void record(const char *name, const uint64_t &start, const uint64_t &end);
+
+  /**
+   Writes every span still in the rings to a trace-event JSON file. Safe to
+   call while other threads record: spans recorded while it runs may or may
+   not be included, and the oldest ones may be left out if a thread laps its
+   ring meanwhile, but every span written is whole.
+
+   @return: true if the file was written; false otherwise.
+  */
+  static bool write(const string &path);
+};
+
+/**
+ Records a span from its construction to the end of its scope.
+*/
+class TraceSpan {
+private:
+  const char *name;
+  uint64_t start;
+
+public:
+  TraceSpan(const char *name): name(name), start(Trace::now()) {}
+  ~TraceSpan() { Trace::record(this->name, this->start, Trace::now()); }
+
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan& operator=(const TraceSpan &) = delete;
+};
+
+#ifdef TETRIS_TRACE
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceSpan TRACE_CONCAT(trace_span_, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name)
+#endif
+
+#endif /* Trace_hpp */
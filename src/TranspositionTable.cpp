@@ -0,0 +1,97 @@
+//
+//  TranspositionTable.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/20/21.
+//
+
+#include <cstring>
+#include "TranspositionTable.hpp"
+
+// --- BEGIN PRIVATE ---
+
+/**
+ Packs an entry into one word: score in the low 32 bits, then move, depth and
+ flags.
+*/
+uint64_t TranspositionTable::pack(const TableEntry &entry) {
+  uint32_t score;
+  memcpy(&score, &entry.score, sizeof(score));
+  return uint64_t(score) | uint64_t(uint16_t(entry.move)) << 32 |
+         uint64_t(entry.depth) << 48 | uint64_t(entry.flags) << 56;
+}
+
+TableEntry TranspositionTable::unpack(const uint64_t &data) {
+  TableEntry entry;
+  const uint32_t score = (uint32_t)data;
+  memcpy(&entry.score, &score, sizeof(score));
+  entry.move = (int16_t)(uint16_t)(data >> 32);
+  entry.depth = (uint8_t)(data >> 48);
+  entry.flags = (uint8_t)(data >> 56);
+  return entry;
+}
+
+// --- END PRIVATE ---
+
+// --- BEGIN PUBLIC ---
+
+/**
+ Public constructor.
+
+ @param bits - The table has 2^bits slots, 16 bytes each.
+*/
+TranspositionTable::TranspositionTable(const int &bits) {
+  this->mask = (uint64_t(1) << bits) - 1;
+  this->slots.reset(new Slot[this->mask + 1]);
+  this->clear();
+}
+
+/**
+ Looks up a position. The slot is read without a lock, then checked against
+ the hash so half-written slots are treated as misses. Empty slots are all
+ zeros, which would pass the check for hash 0, so they are misses too.
+
+ @return: true if it was found; false otherwise.
+*/
+bool TranspositionTable::probe(const uint64_t &hash, TableEntry &entry) const {
+  const Slot &slot = this->slots[hash & this->mask];
+  const uint64_t data = slot.data.load(std::memory_order_relaxed);
+  const uint64_t check = slot.check.load(std::memory_order_relaxed);
+  if ((check ^ data) != hash || (check | data) == 0)
+    return false;
+
+  entry = TranspositionTable::unpack(data);
+  return true;
+}
+
+/**
+ Stores what the search found for a position. Keeps the existing entry if it
+ is for the same position and was searched deeper.
+*/
+void TranspositionTable::store(const uint64_t &hash, const TableEntry &entry) {
+  Slot &slot = this->slots[hash & this->mask];
+  TableEntry old;
+  if (this->probe(hash, old) && old.depth > entry.depth)
+    return;
+
+  const uint64_t data = TranspositionTable::pack(entry);
+  slot.data.store(data, std::memory_order_relaxed);
+  slot.check.store(hash ^ data, std::memory_order_relaxed);
+}
+
+/**
+ Empties the table. Not safe while other threads use it.
+*/
+void TranspositionTable::clear() {
+  for (uint64_t i = 0; i <= this->mask; i++) {
+    this->slots[i].check.store(0, std::memory_order_relaxed);
+    this->slots[i].data.store(0, std::memory_order_relaxed);
+  }
+}
+
+// Gets the number of slots
+uint64_t TranspositionTable::size() const {
+  return this->mask + 1;
+}
+
+// --- END PUBLIC ---
@@ -0,0 +1,90 @@
+//
+//  TranspositionTable.hpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/20/21.
+//
+
+#ifndef TranspositionTable_hpp
+#define TranspositionTable_hpp
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/**
+ What a search knows about a position.
+*/
+struct TableEntry {
+  /**
+   The position's value.
+  */
+  float score;
+  /**
+   The best placement found from it, or -1.
+  */
+  int16_t move;
+  /**
+   How many pieces deep the score was searched.
+  */
+  uint8_t depth;
+  /**
+   Free for the search to use, e.g. whether score is exact or a bound.
+  */
+  uint8_t flags;
+};
+
+/**
+ A fixed-size hash table of positions, keyed by their Zobrist hash, that any
+ number of search threads can share without locks.
+
+ Each slot holds two words: the entry, and the hash XORed with the entry. A
+ reader only accepts a slot if the two still agree, so an entry torn by two
+ threads writing at once reads as a miss instead of as wrong data. Empty slots
+ are all zeros and read as misses for every hash, 0 included; the one entry
+ that packs to zero can't be told from them, so it is never found for hash 0.
+ Newer entries replace older ones unless the old one was searched deeper.
+*/
+class TranspositionTable {
+private:
+  struct Slot {
+    std::atomic<uint64_t> check;
+    std::atomic<uint64_t> data;
+  };
+
+  std::unique_ptr<Slot[]> slots;
+  uint64_t mask;
+
+  static uint64_t pack(const TableEntry &entry);
+  static TableEntry unpack(const uint64_t &data);
+
+public:
+  /**
+   Public constructor.
+
+   @param bits - The table has 2^bits slots, 16 bytes each.
+  */
+  TranspositionTable(const int &bits = 20);
+
+  /**
+   Looks up a position.
+
+   @return: true if it was found; false otherwise.
+  */
+  bool probe(const uint64_t &hash, TableEntry &entry) const;
+
+  /**
+   Stores what the search found for a position.
+  */
+  void store(const uint64_t &hash, const TableEntry &entry);
+
+  /**
+   Empties the table. Not safe while other threads use it.
+  */
+  void clear();
+
+  // Gets the number of slots
+  uint64_t size() const;
+};
+
+#endif /* TranspositionTable_hpp */
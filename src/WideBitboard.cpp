@@ -0,0 +1,255 @@
+//
+//  WideBitboard.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/21/21.
+//
+
+#include <algorithm>
+#include <cstring>
+#include "WideBitboard.hpp"
+
+/**
+ Splits a footprint row shifted to the given column origin into the two words
+ it can touch: lo goes in the given word and hi in the one after it.
+
+ @return: false if part of the row would be shifted off the left of the board;
+ true otherwise.
+*/
+static bool shiftRow(const uint64_t &mask, const int &origin, int &word, uint64_t &lo, uint64_t &hi) {
+  if (origin < 0) {
+    // Only the wall bit can take a cell shifted left, anything further is lost
+    if (origin <= -64 || (mask >> -origin) << -origin != mask)
+      return false;
+    word = 0;
+    lo = mask >> -origin;
+    hi = 0;
+    return true;
+  }
+
+  const int s = origin % 64;
+  word = origin / 64;
+  lo = mask << s;
+  hi = s ? mask >> (64 - s) : 0;
+  return true;
+}
+
+// --- BEGIN PRIVATE ---
+
+/**
+ @return: the words of a board row.
+*/
+uint64_t* WideBitboard::row(const int &row) {
+  return &this->masks[(size_t)row * this->words];
+}
+
+/**
+ @return: the words of a board row.
+*/
+const uint64_t* WideBitboard::row(const int &row) const {
+  return &this->masks[(size_t)row * this->words];
+}
+
+// --- END PRIVATE ---
+
+// --- BEGIN PUBLIC ---
+
+/**
+ Public constructor.
+
+ @param rows - The number of rows on the board.
+ @param cols - The number of cols on the board.
+*/
+WideBitboard::WideBitboard(const int &rows, const int &cols) {
+  this->rows = rows;
+  this->cols = cols;
+  // Room for bit 0, the cols, and a spare word of wall for footprints that
+  // cross into the next word
+  this->words = (cols + 1) / 64 + 2;
+  this->top_filled = rows;
+
+  // Everything except the playable columns is wall
+  this->empty_row = vector<uint64_t>(this->words, ~uint64_t(0));
+  for (int col = 0; col < cols; col++)
+    this->empty_row[(col + 1) / 64] &= ~(uint64_t(1) << ((col + 1) % 64));
+
+  // Create an empty board
+  this->masks.resize((size_t)rows * this->words);
+  for (int r = 0; r < rows; r++)
+    memcpy(this->row(r), this->empty_row.data(), this->words * sizeof(uint64_t));
+}
+
+/**
+ Checks if the footprint, shifted to the given column origin and moved down by
+ dy, overlaps a filled cell, a wall, the floor, or the area above the board.
+
+ @return: true if it collides; false if the piece fits.
+*/
+bool WideBitboard::collides(const Footprint &f, const int &origin, const int &dy) const {
+  // Every cell of the piece would be past the last column
+  if (origin > this->cols)
+    return true;
+
+  for (int i = 0; i < 4; i++) {
+    if (f.rows[i] == 0)
+      continue;
+
+    const int r = f.top + dy + i;
+    if (r < 0 || r >= this->rows)
+      return true;
+
+    int word = 0;
+    uint64_t lo = 0, hi = 0;
+    if (!shiftRow(f.rows[i], origin, word, lo, hi))
+      return true;
+    const uint64_t *w = this->row(r) + word;
+    if ((w[0] & lo) || (w[1] & hi))
+      return true;
+  }
+
+  return false;
+}
+
+/**
+ @return: how many rows the footprint, at the given column origin, can move
+ straight down before it collides. Each row of the piece is followed down
+ until it hits something, and the closest hit wins.
+*/
+int WideBitboard::dropDistance(const Footprint &f, const int &origin) const {
+  int distance = this->rows;
+  for (int i = 0; i < 4; i++) {
+    if (f.rows[i] == 0)
+      continue;
+
+    int word = 0;
+    uint64_t lo = 0, hi = 0;
+    if (!shiftRow(f.rows[i], origin, word, lo, hi))
+      return 0;
+
+    const int from = f.top + i;
+    const int limit = std::min(this->rows - 1 - from, distance);
+    int d = 0;
+    while (d < limit) {
+      const uint64_t *w = this->row(from + d + 1) + word;
+      if ((w[0] & lo) || (w[1] & hi))
+        break;
+      d++;
+    }
+    distance = d;
+  }
+
+  return distance;
+}
+
+/**
+ Empties every cell. Only the rows with something in them are reset.
+*/
+void WideBitboard::clear() {
+  for (int r = this->top_filled; r < this->rows; r++)
+    memcpy(this->row(r), this->empty_row.data(), this->words * sizeof(uint64_t));
+  this->top_filled = this->rows;
+}
+
+/**
+ Fills a cell.
+*/
+void WideBitboard::set(const int &row, const int &col) {
+  this->row(row)[(col + 1) / 64] |= uint64_t(1) << ((col + 1) % 64);
+  this->top_filled = std::min(this->top_filled, row);
+}
+
+/**
+ Fills every cell covered by the footprint at the given column origin. The
+ footprint is expected to fit.
+*/
+void WideBitboard::place(const Footprint &f, const int &origin) {
+  for (int i = 0; i < 4; i++) {
+    if (f.rows[i] == 0)
+      continue;
+
+    int word = 0;
+    uint64_t lo = 0, hi = 0;
+    shiftRow(f.rows[i], origin, word, lo, hi);
+    uint64_t *w = this->row(f.top + i) + word;
+    w[0] |= lo;
+    w[1] |= hi;
+    this->top_filled = std::min(this->top_filled, f.top + i);
+  }
+}
+
+/**
+ @return: true if every cell in the row is filled; false otherwise. The walls
+ are set, so the row is full when every word is all ones.
+*/
+bool WideBitboard::isFull(const int &row) const {
+  const uint64_t *w = this->row(row);
+  for (int i = 0; i < this->words; i++)
+    if (w[i] != ~uint64_t(0))
+      return false;
+  return true;
+}
+
+/**
+ Removes every full row between top and bottom (inclusive) in one pass and
+ drops the rows above them. Each row is tested once, and only the stack above
+ the lowest cleared row is moved.
+
+ @param cleared - If given, gets the rows that were full, bit r for row r
+ as it was before the clear. Rows past 63 don't fit and are left out.
+ @return: the number of rows cleared.
+*/
+int WideBitboard::clearFullRows(const int &top, const int &bottom, uint64_t *cleared) {
+  const int first = std::max(top, 0);
+  const int last = std::min(bottom, this->rows - 1);
+  const size_t bytes = this->words * sizeof(uint64_t);
+  if (cleared)
+    *cleared = 0;
+
+  // Compact the stack downward over the full rows
+  int count = 0;
+  int write = last;
+  for (int r = last; r >= this->top_filled; r--) {
+    if (r >= first && this->isFull(r)) {
+      if (cleared && r < 64)
+        *cleared |= uint64_t(1) << r;
+      count++;
+      continue;
+    }
+    if (write != r)
+      memcpy(this->row(write), this->row(r), bytes);
+    write--;
+  }
+
+  if (count == 0)
+    return 0;
+
+  // Whatever is left at the top of the stack is now empty
+  for (; write >= this->top_filled; write--)
+    memcpy(this->row(write), this->empty_row.data(), bytes);
+  this->top_filled = std::min(this->top_filled + count, this->rows);
+  return count;
+}
+
+/**
+ @return: true if the cell is filled; false otherwise.
+*/
+bool WideBitboard::isOccupied(const int &row, const int &col) const {
+  return (this->row(row)[(col + 1) / 64] >> ((col + 1) % 64)) & 1;
+}
+
+// Gets the number of rows
+int WideBitboard::getRows() const {
+  return this->rows;
+}
+
+// Gets the number of cols
+int WideBitboard::getCols() const {
+  return this->cols;
+}
+
+// Gets the number of words per row
+int WideBitboard::getWords() const {
+  return this->words;
+}
+
+// --- END PUBLIC ---
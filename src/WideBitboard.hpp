@@ -0,0 +1,120 @@
+//
+//  WideBitboard.hpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/21/21.
+//
+
+#ifndef WideBitboard_hpp
+#define WideBitboard_hpp
+
+#include <cstdint>
+#include <vector>
+#include "Bitboard.hpp"
+
+using std::vector;
+
+/**
+ Occupancy of a board too wide for one word per row, for the large-board stress
+ and variant modes. Each row is a run of words, so full rows are found a word
+ at a time no matter how many columns there are.
+
+ Pieces keep their usual <Footprint>, built as if the piece were near the left
+ edge, and every call takes the column origin to shift it to: footprint bit 1
+ lands on column origin. Only occupancy is kept; there is no color plane and
+ no hash.
+*/
+class WideBitboard {
+private:
+  /**
+   Occupancy, `words` words per row, rows top to bottom. Column c is at bit
+   c + 1 of the row, counting from the low bit of its first word. Bit 0,
+   every bit past the last column and one spare word at the end of the row are
+   walls, so a footprint that straddles a word boundary never reads past its
+   row.
+  */
+  vector<uint64_t> masks;
+  /**
+   # of rows and cols on the board, and words per row.
+  */
+  int rows;
+  int cols;
+  int words;
+  /**
+   Every row above this one is empty.
+  */
+  int top_filled;
+  /**
+   A row with nothing in it but the walls.
+  */
+  vector<uint64_t> empty_row;
+
+  /**
+   @return: the words of a board row.
+  */
+  uint64_t* row(const int &row);
+  const uint64_t* row(const int &row) const;
+
+public:
+  /**
+   Public constructor. Any number of cols works.
+  */
+  WideBitboard(const int &rows, const int &cols);
+
+  /**
+   Checks if the footprint, shifted to the given column origin and moved down
+   by dy, overlaps a filled cell, a wall, the floor, or the area above the
+   board.
+
+   @return: true if it collides; false if the piece fits.
+  */
+  bool collides(const Footprint &f, const int &origin, const int &dy = 0) const;
+
+  /**
+   @return: how many rows the footprint, at the given column origin, can move
+   straight down before it collides.
+  */
+  int dropDistance(const Footprint &f, const int &origin) const;
+
+  /**
+   Empties every cell. Doesn't allocate.
+  */
+  void clear();
+
+  /**
+   Fills a cell.
+  */
+  void set(const int &row, const int &col);
+
+  /**
+   Fills every cell covered by the footprint at the given column origin.
+  */
+  void place(const Footprint &f, const int &origin);
+
+  /**
+   @return: true if every cell in the row is filled; false otherwise.
+  */
+  bool isFull(const int &row) const;
+
+  /**
+   Removes every full row between top and bottom (inclusive) in one pass and
+   drops the rows above them.
+
+   @param cleared - If given, gets the rows that were full, bit r for row r
+   as it was before the clear, for rows that fit in the word.
+   @return: the number of rows cleared.
+  */
+  int clearFullRows(const int &top, const int &bottom, uint64_t *cleared = nullptr);
+
+  /**
+   @return: true if the cell is filled; false otherwise.
+  */
+  bool isOccupied(const int &row, const int &col) const;
+
+  // Getters
+  int getRows() const;
+  int getCols() const;
+  int getWords() const;
+};
+
+#endif /* WideBitboard_hpp */
@@ -0,0 +1,160 @@
+//
+//  WorkStealingPool.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/15/21.
+//
+
+#include "WorkStealingPool.hpp"
+
+/**
+ The pool and worker index of the calling thread, if it is a worker.
+*/
+static thread_local const WorkStealingPool *current_pool = nullptr;
+static thread_local int current_worker = -1;
+
+// --- BEGIN PRIVATE ---
+
+/**
+ Takes a task from the back of the worker's own deque, or steals one from
+ the front of another.
+
+ @return: true if a task was found; false otherwise.
+*/
+bool WorkStealingPool::take(const int &worker, Task &task) {
+  const int count = (int)this->queues.size();
+
+  // Newest task from our own deque first: it's the one most likely in cache
+  for (int i = 0; i < count; i++) {
+    Queue &queue = *this->queues[(worker + i) % count];
+    std::lock_guard<std::mutex> guard(queue.lock);
+    if (queue.tasks.empty())
+      continue;
+
+    // Steal the oldest task from everyone else
+    if (i == 0) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    } else {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    }
+    this->queued--;
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ The loop each worker thread runs.
+*/
+void WorkStealingPool::run(const int worker) {
+  current_pool = this;
+  current_worker = worker;
+
+  Task task;
+  while (true) {
+    if (this->take(worker, task)) {
+      task(worker);
+      task = nullptr;
+      // Let wait() know once the last task finishes
+      if (this->pending.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> guard(this->sleep_lock);
+        this->done.notify_all();
+      }
+      continue;
+    }
+
+    // Nothing to do anywhere: sleep until something is submitted
+    std::unique_lock<std::mutex> guard(this->sleep_lock);
+    if (this->stopping && this->queued == 0)
+      return;
+    this->wake.wait(guard, [this] { return this->stopping || this->queued > 0; });
+  }
+}
+
+// --- END PRIVATE ---
+
+// --- BEGIN PUBLIC ---
+
+/**
+ Public constructor. Starts the workers.
+
+ @param threads - # of workers. Defaults to one per hardware thread.
+*/
+WorkStealingPool::WorkStealingPool(const int &threads) {
+  this->pending = 0;
+  this->queued = 0;
+  this->next = 0;
+  this->stopping = false;
+
+  const int count = threads > 0 ? threads : 1;
+  for (int i = 0; i < count; i++)
+    this->queues.emplace_back(new Queue());
+  for (int i = 0; i < count; i++)
+    this->threads.emplace_back(&WorkStealingPool::run, this, i);
+}
+
+/**
+ Finishes the tasks already queued and joins the workers.
+*/
+WorkStealingPool::~WorkStealingPool() {
+  this->wait();
+  {
+    std::lock_guard<std::mutex> guard(this->sleep_lock);
+    this->stopping = true;
+  }
+  this->wake.notify_all();
+
+  for (std::thread &thread : this->threads)
+    thread.join();
+}
+
+/**
+ Queues a task. Called from inside a task, it goes on that worker's own
+ deque; otherwise the deques are filled round-robin.
+*/
+void WorkStealingPool::submit(Task task) {
+  const int worker = current_pool == this ? current_worker
+                                          : (int)(this->next++ % this->queues.size());
+
+  this->pending++;
+  {
+    Queue &queue = *this->queues[worker];
+    std::lock_guard<std::mutex> guard(queue.lock);
+    queue.tasks.push_back(std::move(task));
+  }
+  this->queued++;
+
+  // Taking the lock orders this against a worker deciding to sleep
+  {
+    std::lock_guard<std::mutex> guard(this->sleep_lock);
+  }
+  this->wake.notify_one();
+}
+
+/**
+ Blocks until every task submitted so far has finished.
+*/
+void WorkStealingPool::wait() {
+  std::unique_lock<std::mutex> guard(this->sleep_lock);
+  this->done.wait(guard, [this] { return this->pending == 0; });
+}
+
+/**
+ Gets the number of workers
+*/
+int WorkStealingPool::size() const {
+  return (int)this->threads.size();
+}
+
+/**
+ Gets the index of the worker running the calling thread, or -1 outside
+ the pool.
+*/
+int WorkStealingPool::currentWorker() {
+  return current_worker;
+}
+
+// --- END PUBLIC ---
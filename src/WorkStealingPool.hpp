@@ -0,0 +1,121 @@
+//
+//  WorkStealingPool.hpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/15/21.
+//
+
+#ifndef WorkStealingPool_hpp
+#define WorkStealingPool_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using std::vector;
+
+/**
+ A fixed set of worker threads, each with its own task deque. Workers take
+ work from the back of their own deque and, when it runs dry, steal from the
+ front of someone else's, so long tasks at the end of a batch don't leave the
+ other cores idle. Each deque has its own lock, which is only contended when
+ a steal happens; nothing is shared between workers while a task runs.
+
+ Tasks get the index of the worker running them so they can keep per-thread
+ state in an array indexed by it.
+*/
+class WorkStealingPool {
+public:
+  typedef std::function<void(int worker)> Task;
+
+private:
+  /**
+   One worker's deque. Padded so neighbouring locks don't share a cache line.
+  */
+  struct Queue {
+    std::mutex lock;
+    std::deque<Task> tasks;
+    char padding[64];
+  };
+
+  /**
+   The worker threads and their deques.
+  */
+  vector<std::thread> threads;
+  vector<std::unique_ptr<Queue>> queues;
+  /**
+   # of tasks submitted but not finished yet, and # still sitting in a deque.
+  */
+  std::atomic<long> pending;
+  std::atomic<long> queued;
+  /**
+   Where the next task submitted from outside the pool goes.
+  */
+  std::atomic<unsigned> next;
+  /**
+   Used only to put idle workers (and wait()) to sleep.
+  */
+  std::mutex sleep_lock;
+  std::condition_variable wake;
+  std::condition_variable done;
+  bool stopping;
+
+  /**
+   Takes a task from the back of the worker's own deque, or steals one from
+   the front of another.
+
+   @return: true if a task was found; false otherwise.
+  */
+  bool take(const int &worker, Task &task);
+
+  /**
+   The loop each worker thread runs.
+  */
+  void run(const int worker);
+
+public:
+  /**
+   Public constructor. Starts the workers.
+
+   @param threads - # of workers. Defaults to one per hardware thread.
+  */
+  WorkStealingPool(const int &threads = (int)std::thread::hardware_concurrency());
+
+  /**
+   Finishes the tasks already queued and joins the workers.
+  */
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool &) = delete;
+
+  /**
+   Queues a task. Called from inside a task, it goes on that worker's own
+   deque; otherwise the deques are filled round-robin.
+  */
+  void submit(Task task);
+
+  /**
+   Blocks until every task submitted so far has finished. Must not be called
+   from inside a task.
+  */
+  void wait();
+
+  /**
+   Gets the number of workers
+  */
+  int size() const;
+
+  /**
+   Gets the index of the worker running the calling thread, or -1 outside
+   the pool.
+  */
+  static int currentWorker();
+};
+
+#endif /* WorkStealingPool_hpp */
@@ -0,0 +1,47 @@
+//
+//  Zobrist.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/20/21.
+//
+
+#include "Zobrist.hpp"
+
+uint64_t Zobrist::ROWS[Zobrist::MAX_ROWS][Zobrist::MAX_COLS / 8][256];
+uint64_t Zobrist::PIECES[7][4];
+const bool Zobrist::ready = Zobrist::init();
+
+/**
+ splitmix64: a fast generator whose outputs are well mixed even for
+ consecutive states.
+*/
+static uint64_t nextKey(uint64_t &state) {
+  uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+/**
+ Fills in the keys. Runs once at startup.
+*/
+bool Zobrist::init() {
+  uint64_t state = 0x5A0B3157D1A2B3C4ULL;
+  for (int r = 0; r < Zobrist::MAX_ROWS; r++) {
+    for (int b = 0; b < Zobrist::MAX_COLS / 8; b++) {
+      // One random key per cell, then every combination of a byte of them
+      uint64_t cells[8];
+      for (int i = 0; i < 8; i++)
+        cells[i] = nextKey(state);
+      Zobrist::ROWS[r][b][0] = 0;
+      for (int v = 1; v < 256; v++)
+        Zobrist::ROWS[r][b][v] = Zobrist::ROWS[r][b][v & (v - 1)] ^ cells[__builtin_ctz(v)];
+    }
+  }
+
+  for (int t = 0; t < 7; t++)
+    for (int o = 0; o < 4; o++)
+      Zobrist::PIECES[t][o] = nextKey(state);
+
+  return true;
+}
@@ -0,0 +1,74 @@
+//
+//  Zobrist.hpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/20/21.
+//
+
+#ifndef Zobrist_hpp
+#define Zobrist_hpp
+
+#include <cstdint>
+#include "PieceTable.hpp"
+
+/**
+ Random keys for Zobrist hashing. A board's hash is the XOR of the key of every
+ filled cell, so filling or emptying cells updates it with a few XORs instead
+ of rehashing the board. The keys are fixed, so hashes match across runs and
+ threads.
+*/
+class Zobrist {
+public:
+  /**
+   Rows and columns the keys cover.
+  */
+  static const int MAX_ROWS = 64;
+  static const int MAX_COLS = 64;
+
+  /**
+   @return: the XOR of the keys of the given cells of a row. cells has column
+   c at bit c, no walls.
+  */
+  static uint64_t row(const int &row, uint64_t cells);
+
+  /**
+   @return: the key of an active piece of the given type and orientation.
+  */
+  static uint64_t piece(const PIECE_TYPE &type, const int &rotation);
+
+private:
+  /**
+   ROWS[r][b][v] is the XOR of the cell keys of row r for the columns set in
+   v, where v is byte b of the row's mask, so a row is hashed a byte at a time.
+  */
+  static uint64_t ROWS[MAX_ROWS][MAX_COLS / 8][256];
+  static uint64_t PIECES[7][4];
+
+  /**
+   Fills in the keys. Runs once at startup.
+  */
+  static bool init();
+  static const bool ready;
+};
+
+// Hashing runs on every lock and clear, so the lookups are defined here where
+// they can be inlined.
+
+/**
+ @return: the XOR of the keys of the given cells of a row.
+*/
+inline uint64_t Zobrist::row(const int &row, uint64_t cells) {
+  uint64_t key = 0;
+  for (int b = 0; cells; b++, cells >>= 8)
+    key ^= Zobrist::ROWS[row][b][cells & 0xFF];
+  return key;
+}
+
+/**
+ @return: the key of an active piece of the given type and orientation.
+*/
+inline uint64_t Zobrist::piece(const PIECE_TYPE &type, const int &rotation) {
+  return Zobrist::PIECES[type][rotation];
+}
+
+#endif /* Zobrist_hpp */
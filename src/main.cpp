@@ -5,17 +5,58 @@
 //  Created by Andy Mina on 4/27/21.
 //
 
+#include <algorithm>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <stdlib.h>
 #include <time.h>
 #include "raylib.h"
 #include "Global.hpp"
+#include "BeamPolicy.hpp"
 #include "Board.hpp"
+#include "Clock.hpp"
+#include "History.hpp"
+#include "Input.hpp"
+#include "PerfectClearTable.hpp"
+#include "Replay.hpp"
+#include "Renderer.hpp"
+#include "Trace.hpp"
 
 using std::cout; using std::endl;
 using std::to_string;
 
+/**
+ Queues every key that went down or up since the last frame. raylib only polls
+ the keyboard once a frame, so they all get the time of this call: timestamps
+ and the latency figures built on them have frame resolution. User can use
+ LEFT to move left, RIGHT to move right, DOWN to move down, Z to rotate
+ counter-clockwise, X or UP to rotate clockwise, and SPACE to hard drop.
+ Holding LEFT or RIGHT auto-repeats.
+ */
+void pollInput(InputHandler &input) {
+  static const struct { int key; BUTTON button; } KEYS[] = {
+    { KEY_LEFT, BUTTON_LEFT }, { KEY_RIGHT, BUTTON_RIGHT }, { KEY_DOWN, BUTTON_DOWN },
+    { KEY_UP, BUTTON_CW }, { KEY_X, BUTTON_CW }, { KEY_Z, BUTTON_CCW },
+    { KEY_SPACE, BUTTON_HARD_DROP }
+  };
+
+  const double now = GetTime();
+  for (const auto &k : KEYS) {
+    if (IsKeyPressed(k.key)) input.push(now, k.button, true);
+    if (IsKeyReleased(k.key)) input.push(now, k.button, false);
+  }
+}
+
+/**
+ Prints a latency summary in milliseconds.
+*/
+void printLatency(const string &name, const Latency &latency) {
+  cout << name << ": " << latency.getSamples() << " inputs, mean "
+       << latency.getMean() * 1e3 << " ms, p99 " << latency.percentile(0.99) * 1e3
+       << " ms, max " << latency.getMax() * 1e3 << " ms" << endl;
+}
+
 int main() {
   // Create the window
   InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Tetris");
@@ -23,32 +64,105 @@ int main() {
   SetTargetFPS(FPS);
   // Create the board
   Board board(ROWS, COLS);
-  // Create frames counter
-  int frames = 0;
+  // Record the game. The file is finished when the writer goes out of scope.
+  // Each undo starts a new branch of the game in its own file,
+  // last_game.1.replay and so on, so the recordings before it are kept whole.
+  ReplayWriter replay;
+  int branch = 0;
+  replay.open("last_game.replay", board);
+  // Create the renderer
+  Renderer renderer;
+  // Create the simulation clock. It ticks at TICK_RATE whatever the frame rate.
+  Clock clock;
+  // Create the input queue, with auto-repeat across the board's width
+  InputHandler input(DAS, ARR, board.getBitboard().getCols());
+  // Keep a snapshot from every spawn, so BACKSPACE can take back a piece
+  History history;
+  history.push(board);
+  int pieces = board.getPieces();
+  // The bot finishes perfect clears from the table built by
+  // tools/PerfectClears.cpp, if there is one next to the game
+  PerfectClearTable perfect_clears;
+  // B hands the game to the bot. It places one piece per frame and has to
+  // decide within half a frame, whatever the gravity.
+  BeamSettings settings;
+  settings.preview = 5;
+  settings.budget = 0.5 / FPS;
+  settings.threads = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+  BeamPolicy bot(settings);
+  if (perfect_clears.open("perfect_clears.bin"))
+    bot.setPerfectClears(&perfect_clears);
+  bool autoplay = false;
 
   // Game loop
   while (!WindowShouldClose()) {
+    TRACE_SCOPE("frame");
+
     // --- BEGIN UPDATE PHASE
-    
-    // Increase frame counter
-    frames++;
-    // Drop the active if we need to
-    board.fall(frames);
-    
-    // Take user input
-    board.update();
-    
+    {
+      TRACE_SCOPE("update");
+
+      // Queue the input seen since the last frame
+      pollInput(input);
+
+      // Run every tick that has come due since the last frame. Each one takes
+      // the input stamped up to its own time.
+      const int ticks = clock.advance(GetTime());
+      for (int i = ticks - 1; i >= 0; i--) {
+        TRACE_SCOPE("tick");
+        for (const ACTION &action : input.tick(clock.getTime() - i * clock.getStep()))
+          replay.step(board, action);
+        replay.step(board, TICK);
+      }
+      input.markState(GetTime());
+
+      if (IsKeyPressed(KEY_B))
+        autoplay = !autoplay;
+      if (autoplay && !board.isOver())
+        bot.playPiece(board, &replay);
+
+      // Remember where each new piece started
+      if (board.getPieces() != pieces)
+        history.push(board);
+      // BACKSPACE goes back to where the last piece started. The replay only
+      // holds actions, so the game from there on goes to a new file.
+      if (IsKeyPressed(KEY_BACKSPACE) && history.undo(board)) {
+        replay.close();
+        replay.open("last_game." + to_string(++branch) + ".replay", board);
+      }
+      pieces = board.getPieces();
+    }
     // --- END UPDATE PHASE
     
     // --- BEGIN DRAW PHASE ---
-    BeginDrawing();
-    
-    // Clear the canvas
-    ClearBackground(BLACK);
-    // Draw everything on the board
-    board.draw();
-    
-    EndDrawing();
+    {
+      TRACE_SCOPE("draw");
+      BeginDrawing();
+
+      // Clear the canvas
+      ClearBackground(BLACK);
+      // Draw everything on the board
+      renderer.draw(board);
+    }
+    {
+      // Swaps the buffers, and waits out the rest of the frame
+      TRACE_SCOPE("present");
+      EndDrawing();
+    }
+    input.markPresent(GetTime());
     // --- END DRAW PHASE ---
+
+#ifdef TETRIS_TRACE
+    // F1 saves the recent frames, e.g. right after a stutter
+    if (IsKeyPressed(KEY_F1))
+      Trace::write("trace.json");
+#endif
   }
+
+#ifdef TETRIS_TRACE
+  Trace::write("trace.json");
+#endif
+
+  printLatency("input to state", input.getStateLatency());
+  printLatency("input to present", input.getPresentLatency());
 }
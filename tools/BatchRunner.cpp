@@ -0,0 +1,196 @@
+//
+//  BatchRunner.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/15/21.
+//
+//  Plays N independent seeded games across every core and prints aggregate
+//  stats. Runs headless. Build from the repo root with:
+//
+//    c++ -std=c++14 -faligned-new -O2 -pthread -Isrc tools/BatchRunner.cpp
+//        src/Block.cpp src/Bitboard.cpp src/Piece.cpp src/Board.cpp
+//        src/WideBitboard.cpp src/MoveGenerator.cpp src/Evaluator.cpp
+//        src/Policy.cpp src/Replay.cpp src/WorkStealingPool.cpp src/Trace.cpp
+//        src/Zobrist.cpp src/BeamPolicy.cpp src/TranspositionTable.cpp
+//        src/PerfectClearTable.cpp -o batch
+//
+//  Usage: batch [--games N] [--threads T] [--seed S] [--max-pieces M]
+//               [--policy random|heuristic|beam] [--replays DIR] [--trace FILE]
+//               [--perfect-clears FILE]
+//
+//  Games already run one per core, so the beam policy searches each one on a
+//  single thread. --perfect-clears maps a table from tools/PerfectClears.cpp
+//  once and lets every beam policy play from it. With --replays, game i is
+//  recorded to DIR/<i>.replay; games whose replay can't be written are still
+//  played, and the run exits with 1.
+//  --trace writes the spans of the last games to FILE when built with
+//  -DTETRIS_TRACE.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Global.hpp"
+#include "BeamPolicy.hpp"
+#include "Board.hpp"
+#include "PerfectClearTable.hpp"
+#include "Policy.hpp"
+#include "Trace.hpp"
+#include "WorkStealingPool.hpp"
+
+using std::string;
+using std::vector;
+
+// The per-worker stats live in a vector, which only honors their cache-line
+// alignment with aligned new
+#ifndef __cpp_aligned_new
+#error "build with -faligned-new (or -std=c++17)"
+#endif
+
+/**
+ Totals for the games one worker played. Aligned to a cache line so workers
+ never write to the same line.
+*/
+struct alignas(64) Stats {
+  long games = 0;
+  long pieces = 0;
+  long lines = 0;
+  long score = 0;
+  long min_lines = LONG_MAX;
+  long max_lines = 0;
+  long lost_replays = 0;
+
+  void add(const Board &board) {
+    this->games++;
+    this->pieces += board.getPieces();
+    this->lines += board.getLines();
+    this->score += board.getScore();
+    this->min_lines = std::min(this->min_lines, (long)board.getLines());
+    this->max_lines = std::max(this->max_lines, (long)board.getLines());
+  }
+
+  void add(const Stats &other) {
+    this->games += other.games;
+    this->pieces += other.pieces;
+    this->lines += other.lines;
+    this->score += other.score;
+    this->min_lines = std::min(this->min_lines, other.min_lines);
+    this->max_lines = std::max(this->max_lines, other.max_lines);
+    this->lost_replays += other.lost_replays;
+  }
+};
+
+/**
+ Makes the policy named on the command line.
+*/
+static std::unique_ptr<Policy> makePolicy(const string &name, const unsigned &seed,
+                                          const PerfectClearTable *perfect_clears) {
+  if (name == "random")
+    return std::unique_ptr<Policy>(new RandomPolicy(seed));
+  if (name == "beam") {
+    BeamPolicy *beam = new BeamPolicy();
+    beam->setPerfectClears(perfect_clears);
+    return std::unique_ptr<Policy>(beam);
+  }
+  return std::unique_ptr<Policy>(new HeuristicPolicy());
+}
+
+int main(int argc, char **argv) {
+  long games = 1000;
+  int threads = (int)std::thread::hardware_concurrency();
+  unsigned seed = 1;
+  int max_pieces = 10000;
+  string policy = "heuristic";
+  string replays;
+  string trace;
+  string perfect_clears;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--games")) games = atol(argv[i + 1]);
+    else if (!strcmp(argv[i], "--threads")) threads = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--seed")) seed = (unsigned)atol(argv[i + 1]);
+    else if (!strcmp(argv[i], "--max-pieces")) max_pieces = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--policy")) policy = argv[i + 1];
+    else if (!strcmp(argv[i], "--replays")) replays = argv[i + 1];
+    else if (!strcmp(argv[i], "--trace")) trace = argv[i + 1];
+    else if (!strcmp(argv[i], "--perfect-clears")) perfect_clears = argv[i + 1];
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  PerfectClearTable table;
+  if (!perfect_clears.empty() && !table.open(perfect_clears)) {
+    fprintf(stderr, "could not open %s\n", perfect_clears.c_str());
+    return 1;
+  }
+
+  WorkStealingPool pool(threads);
+
+  // Per-worker state: each worker owns its policy (and its buffers) and stats
+  vector<std::unique_ptr<Policy>> policies;
+  for (int i = 0; i < pool.size(); i++)
+    policies.push_back(makePolicy(policy, seed ^ (0x9E3779B9u * (i + 1)), &table));
+  vector<Stats> stats(pool.size());
+
+  const auto start = std::chrono::steady_clock::now();
+
+  // One task per game. Game i is always seeded with seed + i, so results don't
+  // depend on the number of threads (except for the random policy's choices).
+  for (long i = 0; i < games; i++) {
+    pool.submit([&, i](int worker) {
+      TRACE_SCOPE("game");
+      Board board(ROWS, COLS, 1.0 / TICK_RATE, seed + (unsigned)i);
+      if (replays.empty()) {
+        policies[worker]->play(board, max_pieces);
+      } else {
+        ReplayWriter replay;
+        const string path = replays + "/" + std::to_string(i) + ".replay";
+        if (replay.open(path, board)) {
+          policies[worker]->play(board, max_pieces, &replay);
+        } else {
+          fprintf(stderr, "could not write %s\n", path.c_str());
+          stats[worker].lost_replays++;
+          policies[worker]->play(board, max_pieces);
+        }
+      }
+      stats[worker].add(board);
+    });
+  }
+  pool.wait();
+
+  const double seconds = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - start).count();
+
+#ifdef TETRIS_TRACE
+  if (!trace.empty())
+    Trace::write(trace);
+#endif
+
+  Stats total;
+  for (const Stats &s : stats)
+    total.add(s);
+  if (total.games == 0)
+    total.min_lines = 0;
+
+  printf("games,%ld\n", total.games);
+  printf("threads,%d\n", pool.size());
+  printf("seconds,%.3f\n", seconds);
+  printf("games_per_sec,%.1f\n", total.games / seconds);
+  printf("pieces_per_sec,%.1f\n", total.pieces / seconds);
+  printf("mean_pieces,%.2f\n", (double)total.pieces / std::max(total.games, 1L));
+  printf("mean_lines,%.2f\n", (double)total.lines / std::max(total.games, 1L));
+  printf("min_lines,%ld\n", total.min_lines);
+  printf("max_lines,%ld\n", total.max_lines);
+  printf("mean_score,%.2f\n", (double)total.score / std::max(total.games, 1L));
+  if (!replays.empty())
+    printf("lost_replays,%ld\n", total.lost_replays);
+  return total.lost_replays == 0 ? 0 : 1;
+}
@@ -0,0 +1,455 @@
+//
+//  Benchmark.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/11/21.
+//
+//  Microbenchmarks for the piece, board and whole-game hot paths. Runs headless.
+//  Build from the repo root with:
+//
+//    c++ -std=c++14 -O2 -pthread -Isrc tools/Benchmark.cpp src/Block.cpp
+//        src/Bitboard.cpp src/Piece.cpp src/Board.cpp src/MoveGenerator.cpp
+//        src/Evaluator.cpp src/Trace.cpp src/Zobrist.cpp src/WideBitboard.cpp
+//        src/Environment.cpp src/Policy.cpp src/Replay.cpp
+//        src/BeamPolicy.cpp src/WorkStealingPool.cpp src/TranspositionTable.cpp
+//        src/PerfectClearTable.cpp -o benchmark
+//
+//  Every evaluation kernel the CPU can run is measured; no -mavx2 needed.
+//
+//  Usage: benchmark [--json] [--min-time seconds]
+//  Prints one result per line as CSV (default) or a JSON array.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "Global.hpp"
+#include "BeamPolicy.hpp"
+#include "Bitboard.hpp"
+#include "Piece.hpp"
+#include "Board.hpp"
+#include "MoveGenerator.hpp"
+#include "Environment.hpp"
+#include "Evaluator.hpp"
+#include "WideBitboard.hpp"
+
+using std::string;
+using std::vector;
+
+/**
+ One measured result.
+*/
+struct Result {
+  string name;
+  string workload;
+  double ns_per_op;
+  long ops;
+};
+
+/**
+ Accumulates results so the compiler can't throw the measured work away.
+*/
+static volatile long sink = 0;
+
+/**
+ Minimum time spent on each benchmark, in seconds.
+*/
+static double min_time = 0.25;
+
+/**
+ Runs body(iterations) with a growing iteration count until it takes at least
+ min_time, then returns the time per op. body returns the # of ops it did.
+*/
+template <typename F>
+static Result measure(const string &name, const string &workload, F body) {
+  long iterations = 1000;
+  while (true) {
+    const auto start = std::chrono::steady_clock::now();
+    const long ops = body(iterations);
+    const double elapsed = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+
+    if (elapsed >= min_time || iterations > (1L << 40))
+      return { name, workload, elapsed * 1e9 / (ops ? ops : 1), ops };
+    iterations *= 4;
+  }
+}
+
+/**
+ Fills the bottom `height` rows of a board with a seeded random stack. Every row
+ gets one or two holes so nothing is full.
+*/
+static void fillStack(Bitboard &board, const int &height, const unsigned &seed) {
+  std::mt19937 rng(seed);
+  for (int i = board.getRows() - height; i < board.getRows(); i++) {
+    const int hole = rng() % board.getCols();
+    const int extra = rng() % board.getCols();
+    for (int j = 0; j < board.getCols(); j++)
+      if (j != hole && j != extra)
+        board.set(i, j, 1 + rng() % 7);
+  }
+}
+
+/**
+ The fixed workloads: stack heights the board is pre-filled to.
+*/
+struct Workload {
+  const char *name;
+  int height;
+};
+static const Workload WORKLOADS[] = {
+  { "empty", 0 },
+  { "midgame", 8 },
+  { "near_topout", 15 }
+};
+
+/**
+ Measures the piece moves on a board at the given workload.
+*/
+static void benchPiece(const Workload &w, vector<Result> &results) {
+  Bitboard board(ROWS, COLS);
+  fillStack(board, w.height, 1);
+  // T pieces can rotate in every direction from the spawn position
+  const Piece spawn(T_BLOCK);
+
+  results.push_back(measure("Piece::left", w.name, [&](long n) {
+    Piece p = spawn;
+    long moved = 0;
+    // Alternate so the piece never runs into a wall
+    for (long i = 0; i < n; i++)
+      moved += (i & 1) ? p.right(board) : p.left(board);
+    sink += moved;
+    return n;
+  }));
+
+  results.push_back(measure("Piece::right", w.name, [&](long n) {
+    Piece p = spawn;
+    long moved = 0;
+    for (long i = 0; i < n; i++)
+      moved += (i & 1) ? p.left(board) : p.right(board);
+    sink += moved;
+    return n;
+  }));
+
+  results.push_back(measure("Piece::down", w.name, [&](long n) {
+    // Copy the spawn piece and drop it to the stack, n times
+    long moved = 0;
+    for (long i = 0; i < n; i++) {
+      Piece p = spawn;
+      while (p.down(board))
+        moved++;
+    }
+    sink += moved;
+    return moved;
+  }));
+
+  results.push_back(measure("Piece::dropDistance", w.name, [&](long n) {
+    // The landing row for the spawn piece slid to every column, in turn
+    vector<Piece> pieces(1, spawn);
+    Piece p = spawn;
+    while (p.left(board))
+      pieces.push_back(p);
+    p = spawn;
+    while (p.right(board))
+      pieces.push_back(p);
+    long distance = 0;
+    for (long i = 0; i < n; i++)
+      distance += pieces[i % pieces.size()].dropDistance(board);
+    sink += distance;
+    return n;
+  }));
+
+  results.push_back(measure("Piece::rotateClockwise", w.name, [&](long n) {
+    Piece p = spawn;
+    p.down(board);
+    long moved = 0;
+    for (long i = 0; i < n; i++)
+      moved += p.rotateClockwise(board);
+    sink += moved;
+    return n;
+  }));
+
+  results.push_back(measure("Piece::rotateCounterClockwise", w.name, [&](long n) {
+    Piece p = spawn;
+    p.down(board);
+    long moved = 0;
+    for (long i = 0; i < n; i++)
+      moved += p.rotateCounterClockwise(board);
+    sink += moved;
+    return n;
+  }));
+
+  results.push_back(measure("MoveGenerator::generate", w.name, [&](long n) {
+    // One call per piece type in turn
+    MoveGenerator generator;
+    n = n / 100 + 1;
+    for (long i = 0; i < n; i++)
+      sink += generator.generate(board, PIECE_TYPE(i % 7)).size();
+    return n;
+  }));
+
+  // Every board a T piece can leave behind, scored as one batch
+  MoveGenerator generator;
+  vector<CompactBoard> candidates;
+  for (const Placement &p : generator.generate(board, T_BLOCK)) {
+    Bitboard b = board;
+    b.place(p.piece.getFootprint(), 1);
+    candidates.push_back(CompactBoard());
+    Evaluator::compact(b, candidates.back());
+  }
+
+  // Each kernel the CPU can run, then back to the one picked for it
+  const char *best = Evaluator::kernel();
+  for (const char *kernel : Evaluator::kernels()) {
+    Evaluator::setKernel(kernel);
+    results.push_back(measure(string("Evaluator::evaluate(") + kernel + ")",
+                              w.name, [&](long n) {
+      // Time per candidate board
+      Features features;
+      n = n / candidates.size() + 1;
+      for (long i = 0; i < n; i++) {
+        Evaluator::evaluate(candidates.data(), (int)candidates.size(), board.getRows(),
+                            board.getCols(), features);
+        sink += features.holes[0];
+      }
+      return n * (long)candidates.size();
+    }));
+  }
+  Evaluator::setKernel(best);
+}
+
+/**
+ Measures the row checks and clears on a board at the given workload.
+*/
+static void benchRows(const Workload &w, vector<Result> &results) {
+  Bitboard board(ROWS, COLS);
+  fillStack(board, w.height, 2);
+
+  results.push_back(measure("Board::checkRow", w.name, [&](long n) {
+    long full = 0;
+    for (long i = 0; i < n; i++)
+      full += board.isFull(i % board.getRows());
+    sink += full;
+    return n;
+  }));
+
+  // Fill the bottom 1 or 4 rows and clear them again, keeping the stack the
+  // same height
+  const int counts[] = { 1, 4 };
+  for (const int &count : counts) {
+    const string name = count == 1 ? "Board::clearRows(single)" : "Board::clearRows(tetris)";
+    results.push_back(measure(name, w.name, [&](long n) {
+      Bitboard b = board;
+      const int bottom = b.getRows() - 1;
+      for (long i = 0; i < n; i++) {
+        for (int row = bottom - count + 1; row <= bottom; row++)
+          for (int j = 0; j < b.getCols(); j++)
+            b.set(row, j, 1);
+        sink += b.clearFullRows(bottom - 3, bottom);
+      }
+      return n;
+    }));
+  }
+}
+
+/**
+ Measures the row checks and clears on a board thousands of columns wide, with
+ the same stack heights as the workloads.
+*/
+static void benchWide(const Workload &w, vector<Result> &results) {
+  WideBitboard board(ROWS, 4096);
+  std::mt19937 rng(2);
+  for (int i = board.getRows() - w.height; i < board.getRows(); i++) {
+    const int hole = rng() % board.getCols();
+    for (int j = 0; j < board.getCols(); j++)
+      if (j != hole)
+        board.set(i, j);
+  }
+
+  const string workload = string(w.name) + "_4096";
+  results.push_back(measure("WideBitboard::isFull", workload, [&](long n) {
+    long full = 0;
+    for (long i = 0; i < n; i++)
+      full += board.isFull(i % board.getRows());
+    sink += full;
+    return n;
+  }));
+
+  results.push_back(measure("WideBitboard::clearFullRows(tetris)", workload, [&](long n) {
+    WideBitboard b = board;
+    const int bottom = b.getRows() - 1;
+    n = n / 100 + 1;
+    for (long i = 0; i < n; i++) {
+      for (int row = bottom - 3; row <= bottom; row++)
+        for (int j = 0; j < b.getCols(); j++)
+          b.set(row, j);
+      sink += b.clearFullRows(bottom - 3, bottom);
+    }
+    return n;
+  }));
+}
+
+/**
+ Picks a placement at random for every piece and hard drops it. Shared by the
+ lockPiece and whole-game benchmarks.
+
+ @return: true if the game is still going.
+*/
+static bool playPiece(Board &board, std::mt19937 &rng) {
+  const int rotations = rng() % 4;
+  for (int r = 0; r < rotations; r++)
+    board.step(ROTATE_CW);
+
+  const int shift = (int)(rng() % board.getBitboard().getCols()) - board.getBitboard().getCols() / 2;
+  for (int s = 0; s < std::abs(shift); s++)
+    board.step(shift < 0 ? MOVE_LEFT : MOVE_RIGHT);
+
+  board.step(HARD_DROP);
+  return !board.isOver();
+}
+
+/**
+ Measures locking pieces and whole games.
+*/
+static void benchGame(vector<Result> &results) {
+  results.push_back(measure("Board::lockPiece", "hard_drop", [&](long n) {
+    // Hard drops with no moves in between, restarting the game when it ends
+    Board *board = new Board(ROWS, COLS, 1.0 / TICK_RATE, 3);
+    for (long i = 0; i < n; i++) {
+      if (!board->step(HARD_DROP)) {
+        delete board;
+        board = new Board(ROWS, COLS, 1.0 / TICK_RATE, 3 + i);
+      }
+    }
+    sink += board->getPieces();
+    delete board;
+    return n;
+  }));
+
+  results.push_back(measure("WideBoard::lockPiece", "hard_drop_4096", [&](long n) {
+    // The same on a board only the wide path can hold
+    WideBoard board(ROWS, 4096, 1.0 / TICK_RATE, 3);
+    for (long i = 0; i < n; i++)
+      if (!board.step(HARD_DROP))
+        board.reset(3 + i);
+    sink += board.getPieces();
+    return n;
+  }));
+
+  results.push_back(measure("BeamPolicy::choose", "width_32_preview_2", [&](long n) {
+    // Time per board scored, one search thread, playing a game from the start
+    BeamSettings settings;
+    settings.width = 32;
+    settings.preview = 2;
+    BeamPolicy policy(settings);
+    Board board(ROWS, COLS, 1.0 / TICK_RATE, 4);
+    long nodes = 0;
+    while (nodes < n) {
+      if (board.isOver() || !policy.playPiece(board))
+        board.reset(board.getSeed() + 1);
+      nodes += policy.getNodes();
+    }
+    sink += board.getPieces();
+    return nodes;
+  }));
+
+  results.push_back(measure("Board::save+restore", "midgame", [&](long n) {
+    // A game some way in, so the stack isn't empty
+    Board board(ROWS, COLS, 1.0 / TICK_RATE, 5);
+    std::mt19937 rng(5);
+    for (int i = 0; i < 30 && playPiece(board, rng); i++);
+
+    BoardState state;
+    for (long i = 0; i < n; i++) {
+      board.save(state);
+      board.restore(state);
+    }
+    sink += board.getPieces();
+    return n;
+  }));
+
+  results.push_back(measure("Environment::step", "batch_256", [&](long n) {
+    // Time per game stepped, random actions
+    const int count = 256;
+    Environment env(count, 6);
+    vector<uint8_t> grid(count * ROWS * COLS), done(count);
+    vector<int32_t> piece(count), rotation(count), actions(count);
+    vector<float> reward(count);
+    const TetrisEnvBuffers out = { grid.data(), piece.data(), rotation.data(), reward.data(), done.data() };
+    std::mt19937 rng(6);
+
+    env.reset(out);
+    n = n / count + 1;
+    for (long i = 0; i < n; i++) {
+      for (int32_t &action : actions)
+        action = rng() % 7;
+      env.step(actions.data(), out);
+    }
+    sink += grid[0];
+    return n * count;
+  }));
+
+  long total_pieces = 0;
+  Result games = measure("game", "random_policy", [&](long n) {
+    std::mt19937 rng(4);
+    total_pieces = 0;
+    // Scale down: one game is hundreds of ops
+    const long count = n / 1000 + 1;
+    for (long g = 0; g < count; g++) {
+      Board board(ROWS, COLS, 1.0 / TICK_RATE, (unsigned)g);
+      while (playPiece(board, rng));
+      total_pieces += board.getPieces();
+    }
+    return count;
+  });
+  results.push_back(games);
+
+  // Report throughput from the same run
+  const double seconds = games.ns_per_op * games.ops / 1e9;
+  results.push_back({ "games_per_sec", "random_policy", 1e9 / games.ns_per_op, games.ops });
+  results.push_back({ "pieces_per_sec", "random_policy", total_pieces / seconds, total_pieces });
+}
+
+/**
+ Prints the results as CSV or JSON.
+*/
+static void print(const vector<Result> &results, const bool &json) {
+  if (json) {
+    printf("[\n");
+    for (size_t i = 0; i < results.size(); i++)
+      printf("  {\"name\": \"%s\", \"workload\": \"%s\", \"value\": %.3f, \"ops\": %ld}%s\n",
+             results[i].name.c_str(), results[i].workload.c_str(),
+             results[i].ns_per_op, results[i].ops, i + 1 < results.size() ? "," : "");
+    printf("]\n");
+  } else {
+    printf("name,workload,value,ops\n");
+    for (const Result &r : results)
+      printf("%s,%s,%.3f,%ld\n", r.name.c_str(), r.workload.c_str(), r.ns_per_op, r.ops);
+  }
+}
+
+int main(int argc, char **argv) {
+  bool json = false;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--json"))
+      json = true;
+    else if (!strcmp(argv[i], "--min-time") && i + 1 < argc)
+      min_time = atof(argv[++i]);
+  }
+
+  // Values are ns/op, except for the *_per_sec rows
+  vector<Result> results;
+  for (const Workload &w : WORKLOADS) {
+    benchPiece(w, results);
+    benchRows(w, results);
+    benchWide(w, results);
+  }
+  benchGame(results);
+
+  print(results, json);
+  return 0;
+}
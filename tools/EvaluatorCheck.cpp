@@ -0,0 +1,200 @@
+//
+//  EvaluatorCheck.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/25/21.
+//
+//  Checks every evaluation kernel the CPU can run against the features worked
+//  out one cell at a time, straight from their definitions in
+//  src/Evaluator.hpp. Covers every board size the kernels take and batches
+//  that don't fill the last pass, then the one-board path on every size a
+//  <Bitboard> holds, up to 64 rows by 62 cols. Runs headless. Build from the
+//  repo root with:
+//
+//    c++ -std=c++14 -O2 -Isrc tools/EvaluatorCheck.cpp src/Evaluator.cpp
+//        src/Bitboard.cpp src/Zobrist.cpp -o evaluatorcheck
+//
+//  Usage: evaluatorcheck [--boards N] [--seed S]
+//
+//  Prints one CSV line per kernel, then one for the one-board path, and exits
+//  with 1 if any of them got a feature wrong or a board too big for the
+//  kernels was let through.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "Bitboard.hpp"
+#include "Evaluator.hpp"
+#include "Zobrist.hpp"
+
+using std::vector;
+
+/**
+ Works out the features of one board cell by cell into out at index k.
+*/
+static void reference(const Bitboard &board, const int &k, Features &out) {
+  const int rows = board.getRows();
+  const int cols = board.getCols();
+  vector<int> heights(cols, 0);
+  int holes = 0;
+  for (int j = 0; j < cols; j++) {
+    bool covered = false;
+    for (int i = 0; i < rows; i++) {
+      if (board.isOccupied(i, j)) {
+        if (!covered)
+          heights[j] = rows - i;
+        covered = true;
+      } else if (covered) {
+        holes++;
+      }
+    }
+  }
+
+  // Rows at or below the top of the stack, walls counted as filled
+  int transitions = 0;
+  bool stack = false;
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < cols; j++)
+      stack = stack || board.isOccupied(i, j);
+    if (!stack)
+      continue;
+    bool last = true;
+    for (int j = 0; j <= cols; j++) {
+      const bool cell = j == cols || board.isOccupied(i, j);
+      transitions += cell != last;
+      last = cell;
+    }
+  }
+
+  int height = 0, max_height = 0, bumpiness = 0, wells = 0;
+  for (int j = 0; j < cols; j++) {
+    height += heights[j];
+    max_height = std::max(max_height, heights[j]);
+    if (j > 0)
+      bumpiness += std::abs(heights[j] - heights[j - 1]);
+    const int left = j > 0 ? heights[j - 1] : rows;
+    const int right = j < cols - 1 ? heights[j + 1] : rows;
+    wells += std::max(std::min(left, right) - heights[j], 0);
+  }
+
+  out.height[k] = height;
+  out.max_height[k] = max_height;
+  out.holes[k] = holes;
+  out.bumpiness[k] = bumpiness;
+  out.row_transitions[k] = transitions;
+  out.wells[k] = wells;
+}
+
+/**
+ Fills the board with a random stack: columns of random heights, some cells
+ knocked out below the surface and some rows left empty or full.
+*/
+static void randomBoard(std::mt19937 &rng, Bitboard &board) {
+  const int rows = board.getRows();
+  const int cols = board.getCols();
+  vector<uint64_t> cells(rows, 0);
+  const int top = rng() % (rows + 1);
+  for (int j = 0; j < cols; j++) {
+    const int height = std::min(rows, (int)(rng() % (top + 2)));
+    for (int i = rows - height; i < rows; i++)
+      if (rng() % 5 != 0)
+        cells[i] |= uint64_t(1) << j;
+  }
+  for (int i = 0; i < rows; i++) {
+    if (rng() % 16 == 0)
+      cells[i] = (uint64_t(1) << cols) - 1;
+    else if (rng() % 16 == 0)
+      cells[i] = 0;
+  }
+
+  board.clear();
+  for (int i = 0; i < rows; i++)
+    for (int j = 0; j < cols; j++)
+      if ((cells[i] >> j) & 1)
+        board.set(i, j, 1);
+}
+
+/**
+ @return: the # of boards where the two disagree on any feature.
+*/
+static long differences(const Features &a, const Features &b, const int &count) {
+  long wrong = 0;
+  for (int k = 0; k < count; k++)
+    wrong += a.height[k] != b.height[k] || a.max_height[k] != b.max_height[k] ||
+             a.holes[k] != b.holes[k] || a.bumpiness[k] != b.bumpiness[k] ||
+             a.row_transitions[k] != b.row_transitions[k] || a.wells[k] != b.wells[k];
+  return wrong;
+}
+
+int main(int argc, char **argv) {
+  int boards = 37;
+  unsigned seed = 1;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--boards")) boards = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--seed")) seed = (unsigned)atol(argv[i + 1]);
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  printf("kernel,sizes,boards,mismatches\n");
+  long failures = 0;
+  Features expected, actual;
+  for (const char *kernel : Evaluator::kernels()) {
+    Evaluator::setKernel(kernel);
+    std::mt19937 rng(seed);
+    long sizes = 0, checked = 0, wrong = 0;
+    vector<CompactBoard> batch;
+    for (int rows = 1; rows <= CompactBoard::MAX_ROWS; rows++) {
+      for (int cols = 1; cols <= CompactBoard::MAX_COLS; cols++, sizes++) {
+        Bitboard board(rows, cols);
+        // Every batch size up to the given one, so every lane count is covered
+        for (int count = 1; count <= boards; count++) {
+          batch.resize(count);
+          expected.resize(count);
+          for (int k = 0; k < count; k++) {
+            randomBoard(rng, board);
+            reference(board, k, expected);
+            Evaluator::compact(board, batch[k]);
+          }
+          Evaluator::evaluate(batch.data(), count, rows, cols, actual);
+          wrong += differences(expected, actual, count);
+          checked += count;
+        }
+      }
+    }
+    printf("%s,%ld,%ld,%ld\n", kernel, sizes, checked, wrong);
+    failures += wrong;
+  }
+
+  // One board at a time, on every size, and the batch path turning down the
+  // ones it can't hold
+  std::mt19937 rng(seed);
+  long sizes = 0, checked = 0, wrong = 0;
+  for (int rows = 1; rows <= Zobrist::MAX_ROWS; rows++) {
+    for (int cols = 1; cols <= Bitboard::MAX_COLS; cols++, sizes++) {
+      Bitboard board(rows, cols);
+      CompactBoard compact;
+      if (!Evaluator::fits(rows, cols) &&
+          (Evaluator::compact(board, compact) || Evaluator::evaluate(&compact, 1, rows, cols, actual)))
+        wrong++;
+      expected.resize(1);
+      actual.resize(1);
+      for (int k = 0; k < 4; k++, checked++) {
+        randomBoard(rng, board);
+        reference(board, 0, expected);
+        Evaluator::evaluate(board, 0, actual);
+        wrong += differences(expected, actual, 1);
+      }
+    }
+  }
+  printf("bitboard,%ld,%ld,%ld\n", sizes, checked, wrong);
+  failures += wrong;
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+//
+//  GameServer.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/22/21.
+//
+//  Hosts games for remote clients, one session per connection, over the
+//  protocol in src/Protocol.hpp. Linux only. Build from the repo root with:
+//
+//    c++ -std=c++14 -O2 -pthread -Isrc tools/GameServer.cpp src/Server.cpp
+//        src/Protocol.cpp src/Clock.cpp src/Block.cpp src/Bitboard.cpp
+//        src/Piece.cpp src/Board.cpp src/WideBitboard.cpp src/Trace.cpp
+//        src/Zobrist.cpp -o server
+//
+//  Usage: server [--port P] [--unix PATH] [--threads T]
+//
+//  Listens on 127.0.0.1:7777 unless --port or --unix says otherwise, and
+//  prints the session count every second until interrupted.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <sys/resource.h>
+#include "Server.hpp"
+
+using std::string;
+
+/**
+ Set by SIGINT and SIGTERM.
+*/
+static volatile sig_atomic_t interrupted = 0;
+
+static void onSignal(int) {
+  interrupted = 1;
+}
+
+int main(int argc, char **argv) {
+  int port = -1;
+  string path;
+  int threads = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--port")) port = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--unix")) path = argv[i + 1];
+    else if (!strcmp(argv[i], "--threads")) threads = atoi(argv[i + 1]);
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (port < 0 && path.empty())
+    port = 7777;
+
+  // Every session is a socket, so allow as many as the system will
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+
+  Server server(threads);
+  if (port >= 0 && !server.listenTcp(port)) {
+    fprintf(stderr, "could not listen on port %d\n", port);
+    return 1;
+  }
+  if (!path.empty() && !server.listenUnix(path)) {
+    fprintf(stderr, "could not listen on %s\n", path.c_str());
+    return 1;
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  std::thread network([&]() { server.run(); });
+
+  while (!interrupted) {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    printf("sessions,%ld\n", server.getSessions());
+    fflush(stdout);
+  }
+
+  server.stop();
+  network.join();
+  return 0;
+}
@@ -0,0 +1,268 @@
+//
+//  LoadClient.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/22/21.
+//
+//  Stands in for many players on the loopback: opens one connection per
+//  session to a game server, sends inputs at a steady rate and measures how
+//  long each takes to be answered. Linux only. Build from the repo root with:
+//
+//    c++ -std=c++14 -O2 -pthread -Isrc tools/LoadClient.cpp src/Server.cpp
+//        src/Protocol.cpp src/Clock.cpp src/Input.cpp src/Block.cpp
+//        src/Bitboard.cpp src/Piece.cpp src/Board.cpp src/WideBitboard.cpp
+//        src/Trace.cpp src/Zobrist.cpp -o loadclient
+//
+//  Usage: loadclient [--sessions N] [--port P] [--unix PATH] [--seconds S]
+//                    [--rate R] [--local T]
+//
+//  Each session sends R inputs per second, one at a time, and restarts its
+//  game when it tops out. --local hosts the server in this process on T
+//  threads instead of connecting to one. Prints the results as CSV.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "Input.hpp"
+#include "Protocol.hpp"
+#include "Server.hpp"
+
+using std::string;
+using std::vector;
+
+/**
+ One player.
+*/
+struct Player {
+  int fd;
+  vector<uint8_t> in;
+  vector<uint8_t> out;
+  /**
+   The input waiting for an answer (0 if none), when it was sent, and when
+   the next one is due.
+  */
+  uint32_t pending;
+  double sent;
+  double next;
+  /**
+   Set from the update that ended the game until the restart is seen.
+  */
+  bool over;
+};
+
+/**
+ Actions the players send. Mostly moves, with a hard drop now and then so
+ games keep going.
+*/
+static const ACTION ACTIONS[] = {
+  MOVE_LEFT, MOVE_RIGHT, MOVE_LEFT, MOVE_RIGHT, ROTATE_CW, ROTATE_CCW, MOVE_DOWN, HARD_DROP
+};
+
+/**
+ @return: a connected socket, or -1 if the server couldn't be reached.
+*/
+static int connectTo(const int &port, const string &path) {
+  int fd;
+  if (!path.empty()) {
+    sockaddr_un address = {};
+    if (path.size() >= sizeof(address.sun_path))
+      return -1;
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (const sockaddr *)&address, sizeof(address)) < 0) {
+      close(fd);
+      return -1;
+    }
+  } else {
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (const sockaddr *)&address, sizeof(address)) < 0) {
+      close(fd);
+      return -1;
+    }
+    const int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  }
+
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  return fd;
+}
+
+/**
+ Writes as much of the player's output as the socket takes.
+*/
+static void flush(Player &player) {
+  if (player.out.empty())
+    return;
+  const ssize_t n = send(player.fd, player.out.data(), player.out.size(), MSG_NOSIGNAL);
+  if (n > 0)
+    player.out.erase(player.out.begin(), player.out.begin() + n);
+}
+
+int main(int argc, char **argv) {
+  int sessions = 1000;
+  int port = 7777;
+  string path;
+  double seconds = 10;
+  double rate = 10;
+  int local = 0;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--sessions")) sessions = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--port")) port = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--unix")) path = argv[i + 1];
+    else if (!strcmp(argv[i], "--seconds")) seconds = atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--rate")) rate = atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--local")) local = atoi(argv[i + 1]);
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  // Two sockets per session when the server is in this process
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+
+  std::unique_ptr<Server> server;
+  std::thread network;
+  if (local > 0) {
+    path = "/tmp/tetris-load-" + std::to_string(getpid()) + ".sock";
+    server.reset(new Server(local));
+    if (!server->listenUnix(path)) {
+      fprintf(stderr, "could not listen on %s\n", path.c_str());
+      return 1;
+    }
+    network = std::thread([&]() { server->run(); });
+  }
+
+  const auto epoch = std::chrono::steady_clock::now();
+  const auto now = [&]() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch).count();
+  };
+
+  const int poll = epoll_create1(EPOLL_CLOEXEC);
+  std::mt19937 rng(1);
+  vector<Player> players(sessions);
+  for (int i = 0; i < sessions; i++) {
+    Player &player = players[i];
+    player.fd = connectTo(port, path);
+    if (player.fd < 0) {
+      fprintf(stderr, "could not connect session %d\n", i);
+      return 1;
+    }
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u32 = (uint32_t)i;
+    epoll_ctl(poll, EPOLL_CTL_ADD, player.fd, &event);
+
+    Protocol::encodeStart(player.out, (uint32_t)rng());
+    flush(player);
+    player.pending = 0;
+    player.over = false;
+    // Spread the first inputs over one interval so they don't all line up
+    player.next = now() + std::uniform_real_distribution<double>(0, 1 / rate)(rng);
+  }
+
+  Latency latency;
+  long inputs = 0, states = 0, bytes = 0, games = 0;
+  uint32_t sequence = 0;
+  const double start = now();
+  epoll_event events[256];
+
+  while (now() - start < seconds) {
+    const int n = epoll_wait(poll, events, 256, 1);
+    for (int e = 0; e < n; e++) {
+      Player &player = players[events[e].data.u32];
+      uint8_t buffer[4096];
+      ssize_t got;
+      while ((got = recv(player.fd, buffer, sizeof(buffer), 0)) > 0) {
+        player.in.insert(player.in.end(), buffer, buffer + got);
+        bytes += got;
+      }
+
+      size_t offset = 0;
+      MESSAGE type;
+      const uint8_t *body;
+      int length, size;
+      while ((size = Protocol::frame(player.in.data() + offset, player.in.size() - offset,
+                                     type, body, length)) > 0) {
+        offset += size;
+        StateMessage state;
+        if (type != MSG_STATE || !Protocol::decodeState(body, length, state))
+          continue;
+        states++;
+        if (state.sequence != 0 && state.sequence == player.pending) {
+          latency.add(now() - player.sent);
+          player.pending = 0;
+        }
+        if (state.over && !player.over) {
+          Protocol::encodeStart(player.out, (uint32_t)rng());
+          games++;
+        }
+        player.over = state.over;
+      }
+      player.in.erase(player.in.begin(), player.in.begin() + offset);
+      flush(player);
+    }
+
+    // Send the inputs that are due, one outstanding per player
+    const double t = now();
+    for (Player &player : players) {
+      if (player.pending != 0 || t < player.next)
+        continue;
+      player.pending = ++sequence;
+      player.sent = t;
+      player.next += 1 / rate;
+      Protocol::encodeInput(player.out, player.pending, ACTIONS[rng() % 8]);
+      flush(player);
+      inputs++;
+    }
+  }
+
+  const double elapsed = now() - start;
+  for (const Player &player : players)
+    close(player.fd);
+  close(poll);
+  if (server) {
+    server->stop();
+    network.join();
+  }
+
+  printf("sessions,%d\n", sessions);
+  printf("seconds,%.3f\n", elapsed);
+  printf("inputs_per_sec,%.1f\n", inputs / elapsed);
+  printf("answered,%ld\n", latency.getSamples());
+  printf("states_per_sec,%.1f\n", states / elapsed);
+  printf("bytes_per_state,%.1f\n", states ? (double)bytes / states : 0);
+  printf("games_restarted,%ld\n", games);
+  printf("latency_p50_ms,%.2f\n", latency.percentile(0.5) * 1e3);
+  printf("latency_p99_ms,%.2f\n", latency.percentile(0.99) * 1e3);
+  printf("latency_max_ms,%.2f\n", latency.getMax() * 1e3);
+  return 0;
+}
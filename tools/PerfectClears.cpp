@@ -0,0 +1,291 @@
+//
+//  PerfectClears.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/25/21.
+//
+//  Builds the perfect-clear table that src/PerfectClearTable.hpp maps: every
+//  bottom-4-row stack and piece sequence of up to N pieces that ends with an
+//  empty board, and the first placement of each. Runs offline. Build from the
+//  repo root with:
+//
+//    c++ -std=c++14 -O2 -Isrc tools/PerfectClears.cpp src/Block.cpp
+//        src/Bitboard.cpp src/Piece.cpp src/Board.cpp src/WideBitboard.cpp
+//        src/MoveGenerator.cpp src/PerfectClearTable.cpp src/Trace.cpp
+//        src/Zobrist.cpp -o perfectclears
+//
+//  Usage: perfectclears [--pieces N] [--out FILE]
+//
+//  Works backwards from the empty board, one piece at a time: a stack is
+//  solved with pieces p, q, ... if placing p on it leaves a stack solved with
+//  q, .... Each step undoes a placement, putting back any rows it cleared, and
+//  keeps it only if the move generator can really reach it on a board of
+//  ROWS x COLS. Prints the counts for each length as CSV.
+//
+//  Each extra piece makes the table about 100 times bigger: 3 pieces is 1.4M
+//  positions in a 64 MB file and a few minutes of work, 4 would be hours and
+//  gigabytes.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Global.hpp"
+#include "Bitboard.hpp"
+#include "MoveGenerator.hpp"
+#include "PerfectClearTable.hpp"
+#include "Piece.hpp"
+
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+static const int FIELD_ROWS = PerfectClearTable::FIELD_ROWS;
+static const int FIELD_COLS = PerfectClearTable::FIELD_COLS;
+static const uint64_t FULL_ROW = (uint64_t(1) << FIELD_COLS) - 1;
+
+/**
+ Every way a piece can sit in the field, as cells.
+*/
+struct Spot {
+  PIECE_TYPE type;
+  uint64_t cells;
+};
+
+/**
+ @return: one row of a field.
+*/
+static uint64_t row(const uint64_t &field, const int &r) {
+  return (field >> (FIELD_COLS * r)) & FULL_ROW;
+}
+
+/**
+ @return: the # of rows up to the highest filled one.
+*/
+static int height(const uint64_t &field) {
+  int h = 0;
+  for (int r = 0; r < FIELD_ROWS; r++)
+    if (row(field, r))
+      h = r + 1;
+  return h;
+}
+
+/**
+ Lists every position of every orientation of every piece inside the field.
+ The orientations come from the pieces themselves, turned on an empty board.
+*/
+static vector<Spot> listSpots() {
+  vector<Spot> spots;
+  const Bitboard empty(ROWS, COLS);
+  for (int t = 0; t < 7; t++) {
+    const PIECE_TYPE type = PIECE_TYPE(t);
+    Piece piece(type);
+    vector<uint64_t> seen;
+    for (int turn = 0; turn < 4; turn++, piece.rotateClockwise(empty)) {
+      // Normalize the footprint to the bottom left corner of the field
+      const Footprint &f = piece.getFootprint();
+      int low = 4, left = 64, bottom = -1;
+      for (int i = 0; i < 4; i++) {
+        if (f.rows[i] == 0)
+          continue;
+        low = std::min(low, i);
+        bottom = i;
+        left = std::min(left, __builtin_ctzll(f.rows[i]));
+      }
+      uint64_t base = 0;
+      int width = 0;
+      for (int i = low; i <= bottom; i++) {
+        const uint64_t bits = f.rows[i] >> left;
+        base |= bits << (FIELD_COLS * (bottom - i));
+        width = std::max(width, 64 - __builtin_clzll(bits));
+      }
+      if (std::find(seen.begin(), seen.end(), base) != seen.end())
+        continue;
+      seen.push_back(base);
+
+      const int tall = bottom - low + 1;
+      for (int r = 0; r + tall <= FIELD_ROWS; r++)
+        for (int c = 0; c + width <= FIELD_COLS; c++)
+          spots.push_back({ type, base << (FIELD_COLS * r + c) });
+    }
+  }
+  return spots;
+}
+
+/**
+ Finds which placements the move generator can reach on a stack, caching the
+ answer for every stack and piece asked about.
+*/
+class Reach {
+private:
+  MoveGenerator generator;
+  Bitboard board;
+  unordered_map<uint64_t, vector<uint64_t>> cache;
+
+public:
+  Reach(): board(ROWS, COLS) {}
+
+  /**
+   @return: true if a piece of the type can come to rest on the cells. Only
+   the placements tucked under the stack need a search.
+  */
+  bool reaches(const uint64_t &field, const PIECE_TYPE &type, const uint64_t &cells) {
+    // It has to rest there, on the floor or on the stack
+    const uint64_t below = cells >> FIELD_COLS;
+    if ((cells & FULL_ROW) == 0 && (below & field) == 0)
+      return false;
+    // Anything that can fall straight in from above gets there from the
+    // spawn, which has the whole empty board above the field to turn in
+    bool open = true;
+    for (int up = 1; up < FIELD_ROWS && open; up++)
+      open = ((cells << (FIELD_COLS * up)) & field) == 0;
+    if (open)
+      return true;
+
+    const uint64_t key = field | uint64_t(type) << 40;
+    auto found = this->cache.find(key);
+    if (found == this->cache.end()) {
+      this->board.clear();
+      for (int r = 0; r < FIELD_ROWS; r++)
+        for (int c = 0; c < FIELD_COLS; c++)
+          if ((row(field, r) >> c) & 1)
+            this->board.set(ROWS - 1 - r, c, 1);
+
+      vector<uint64_t> reached;
+      for (const Placement &p : this->generator.generate(this->board, type)) {
+        const uint64_t placed = PerfectClearTable::cells(p.piece.getFootprint(), ROWS);
+        if (placed)
+          reached.push_back(placed);
+      }
+      found = this->cache.emplace(key, reached).first;
+    }
+    const vector<uint64_t> &reached = found->second;
+    return std::find(reached.begin(), reached.end(), cells) != reached.end();
+  }
+};
+
+int main(int argc, char **argv) {
+  int pieces = 3;
+  string out = "perfect_clears.bin";
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--pieces")) pieces = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--out")) out = argv[i + 1];
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (pieces < 1 || pieces > PerfectClearTable::MAX_PIECES || COLS != FIELD_COLS) {
+    fprintf(stderr, "need 1 to %d pieces on a board %d wide\n", PerfectClearTable::MAX_PIECES, FIELD_COLS);
+    return 1;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  const vector<Spot> spots = listSpots();
+  Reach reach;
+
+  // Solved stacks by # of pieces, each with the sequences that solve it (3
+  // bits per piece, first piece lowest). No pieces solve the empty stack.
+  vector<unordered_map<uint64_t, vector<uint32_t>>> levels(pieces + 1);
+  levels[0][0].push_back(0);
+  unordered_map<uint64_t, uint64_t> moves;
+
+  printf("pieces,entries,seconds\n");
+  for (int k = 1; k <= pieces; k++) {
+    long entries = 0;
+    for (const auto &solved : levels[k - 1]) {
+      const uint64_t after = solved.first;
+      const int h = height(after);
+
+      // The placement may have filled rows that then cleared. Put back each
+      // choice of up to 4 - h full rows among the stack's rows.
+      for (int added = 0; h + added <= FIELD_ROWS; added++) {
+        const int n = h + added;
+        for (unsigned full = 0; full < (1u << n); full++) {
+          if (__builtin_popcount(full) != added)
+            continue;
+          uint64_t before = 0;
+          for (int r = 0, from = 0; r < n; r++)
+            before |= ((full >> r) & 1 ? FULL_ROW : row(after, from++)) << (FIELD_COLS * r);
+
+          for (const Spot &spot : spots) {
+            // The piece has to be part of the stack, and to be what filled
+            // every row that cleared
+            if ((spot.cells & before) != spot.cells)
+              continue;
+            bool filled = true;
+            for (int r = 0; r < n && filled; r++)
+              filled = !((full >> r) & 1) || row(spot.cells, r);
+            if (!filled)
+              continue;
+
+            const uint64_t stack = before & ~spot.cells;
+            if (!reach.reaches(stack, spot.type, spot.cells))
+              continue;
+
+            for (const uint32_t &rest : solved.second) {
+              const uint32_t sequence = uint32_t(spot.type) | rest << 3;
+              PIECE_TYPE order[PerfectClearTable::MAX_PIECES];
+              for (int i = 0; i < k; i++)
+                order[i] = PIECE_TYPE((sequence >> (3 * i)) & 7);
+              const uint64_t key = PerfectClearTable::key(stack, order, k);
+              if (!moves.emplace(key, spot.cells).second)
+                continue;
+              // The last level is never extended, so only its moves are kept
+              if (k < pieces)
+                levels[k][stack].push_back(sequence);
+              entries++;
+            }
+          }
+        }
+      }
+    }
+
+    const double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+    printf("%d,%ld,%.2f\n", k, entries, seconds);
+    fflush(stdout);
+  }
+
+  // Lay the entries out as the runtime probes them, at most half full
+  uint64_t slots = 1;
+  while (slots < 2 * moves.size() + 2)
+    slots <<= 1;
+  vector<PerfectClearEntry> table(slots, PerfectClearEntry{ 0, 0 });
+  for (const auto &entry : moves) {
+    uint64_t i = PerfectClearTable::hash(entry.first) & (slots - 1);
+    while (table[i].key != 0)
+      i = (i + 1) & (slots - 1);
+    table[i] = { entry.first, entry.second };
+  }
+
+  PerfectClearHeader header = {};
+  memcpy(header.magic, "TPCT", 4);
+  header.version = PerfectClearTable::VERSION;
+  header.rows = FIELD_ROWS;
+  header.cols = FIELD_COLS;
+  header.max_pieces = (uint32_t)pieces;
+  header.slots = slots;
+  header.entries = moves.size();
+
+  FILE *file = fopen(out.c_str(), "wb");
+  if (!file) {
+    fprintf(stderr, "could not write %s\n", out.c_str());
+    return 1;
+  }
+  const bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                       fwrite(table.data(), sizeof(PerfectClearEntry), slots, file) == slots;
+  if (fclose(file) != 0 || !written) {
+    fprintf(stderr, "could not write %s\n", out.c_str());
+    return 1;
+  }
+
+  printf("bytes,%zu\n", sizeof(header) + slots * sizeof(PerfectClearEntry));
+  return 0;
+}
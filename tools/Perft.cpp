@@ -0,0 +1,266 @@
+//
+//  Perft.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/21/21.
+//
+//  Counts every placement sequence reachable from a board with a fixed piece
+//  sequence, the same way chess engines check their move generators. Each
+//  placement is locked and its full rows cleared before the next piece, so the
+//  counts cover the whole move/lock/clear pipeline. Runs headless. Build from
+//  the repo root with:
+//
+//    c++ -std=c++14 -O2 -Isrc tools/Perft.cpp src/Block.cpp src/Bitboard.cpp
+//        src/Piece.cpp src/Board.cpp src/WideBitboard.cpp src/MoveGenerator.cpp
+//        src/Trace.cpp src/Zobrist.cpp -o perft
+//
+//  Usage: perft [--depth D] [--pieces IOJLSZT] [--board FILE] [--hash BITS]
+//               [--divide]
+//
+//  Prints the count for every depth from 1 to D as CSV. The sequence repeats
+//  if it is shorter than D. --board reads the starting stack from a text file,
+//  one line per row with the bottom row last, '.' for empty cells. --hash
+//  memoizes subtree counts by board hash in a table of 2^BITS entries; counts
+//  must match the run without it. --divide also prints the count under every
+//  placement of the first piece.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Global.hpp"
+#include "Bitboard.hpp"
+#include "Piece.hpp"
+#include "MoveGenerator.hpp"
+
+using std::string;
+using std::vector;
+
+/**
+ A memoized subtree count. key is the full position key, so collisions between
+ positions that share a slot are caught.
+*/
+struct CountEntry {
+  uint64_t key;
+  uint64_t count;
+};
+
+/**
+ Runs the search. Keeps one generator per ply, since each call to generate()
+ replaces the results of the last one.
+*/
+class Perft {
+private:
+  vector<PIECE_TYPE> sequence;
+  vector<MoveGenerator> generators;
+  /**
+   Memoized counts, or empty if hashing is off.
+  */
+  vector<CountEntry> table;
+  uint64_t mask;
+  /**
+   Table lookups and how many of them hit.
+  */
+  long probes;
+  long hits;
+
+  /**
+   @return: the key of a position: the stack, the ply its piece comes from
+   and the plies left to search.
+  */
+  uint64_t key(const Bitboard &board, const int &ply, const int &depth) const {
+    uint64_t z = ((uint64_t)ply << 8 | (uint64_t)depth) * 0x9E3779B97F4A7C15ull;
+    z ^= z >> 31;
+    return board.getHash() ^ z;
+  }
+
+public:
+  Perft(const vector<PIECE_TYPE> &sequence, const int &hash_bits)
+    : sequence(sequence), mask(0), probes(0), hits(0) {
+    if (hash_bits > 0) {
+      this->table.assign((size_t)1 << hash_bits, { 0, 0 });
+      this->mask = ((uint64_t)1 << hash_bits) - 1;
+    }
+  }
+
+  /**
+   @return: the # of placement sequences of length depth, starting with the
+   piece at the given ply of the sequence.
+  */
+  uint64_t count(const Bitboard &board, const int &ply, const int &depth) {
+    if (depth == 0)
+      return 1;
+    if ((int)this->generators.size() <= ply)
+      this->generators.resize(ply + 1);
+
+    const PIECE_TYPE type = this->sequence[ply % this->sequence.size()];
+    const vector<Placement> &placements = this->generators[ply].generate(board, type);
+    // The last ply only needs the number of placements, not the boards
+    if (depth == 1)
+      return placements.size();
+
+    CountEntry *entry = nullptr;
+    uint64_t k = 0;
+    if (!this->table.empty()) {
+      k = this->key(board, ply, depth);
+      entry = &this->table[k & this->mask];
+      this->probes++;
+      if (entry->key == k) {
+        this->hits++;
+        return entry->count;
+      }
+    }
+
+    uint64_t total = 0;
+    Bitboard next = board;
+    for (const Placement &p : placements) {
+      // Lock the piece and clear whatever it completes, as Board::lockPiece does
+      const Footprint &f = p.piece.getFootprint();
+      next = board;
+      next.place(f, p.piece.getColor());
+      next.clearFullRows(f.top, f.top + 3);
+      total += this->count(next, ply + 1, depth - 1);
+    }
+
+    if (entry)
+      *entry = { k, total };
+    return total;
+  }
+
+  /**
+   Prints the count under every placement of the first piece.
+  */
+  void divide(const Bitboard &board, const int &depth) {
+    // Copy them out, the search reuses the generator for ply 0
+    MoveGenerator generator;
+    const vector<Placement> placements = generator.generate(board, this->sequence[0]);
+
+    printf("x,y,rotation,nodes\n");
+    Bitboard next = board;
+    for (const Placement &p : placements) {
+      const Footprint &f = p.piece.getFootprint();
+      next = board;
+      next.place(f, p.piece.getColor());
+      next.clearFullRows(f.top, f.top + 3);
+      printf("%d,%d,%d,%llu\n", p.piece.getPivot().x, p.piece.getPivot().y,
+             p.piece.getRotation(), (unsigned long long)this->count(next, 1, depth - 1));
+    }
+  }
+
+  // Getters
+  long getProbes() const { return this->probes; }
+  long getHits() const { return this->hits; }
+};
+
+/**
+ Parses a piece sequence such as "IOJLSZT".
+
+ @return: true if every letter is a piece; false otherwise.
+*/
+static bool parseSequence(const char *text, vector<PIECE_TYPE> &sequence) {
+  static const char LETTERS[] = "IOJLSZT";
+  sequence.clear();
+  for (const char *c = text; *c; c++) {
+    const char *found = strchr(LETTERS, *c);
+    if (!found)
+      return false;
+    sequence.push_back(PIECE_TYPE(found - LETTERS));
+  }
+  return !sequence.empty();
+}
+
+/**
+ Loads a stack from a text file into the bottom rows of the board. Anything
+ but '.' or a space is a filled cell.
+
+ @return: true if the file fit on the board; false otherwise.
+*/
+static bool loadBoard(const char *path, Bitboard &board) {
+  FILE *file = fopen(path, "r");
+  if (!file)
+    return false;
+
+  vector<string> lines;
+  char line[256];
+  while (fgets(line, sizeof(line), file)) {
+    string row(line);
+    while (!row.empty() && (row.back() == '\n' || row.back() == '\r'))
+      row.pop_back();
+    if (!row.empty())
+      lines.push_back(row);
+  }
+  fclose(file);
+
+  if ((int)lines.size() > board.getRows())
+    return false;
+
+  const int top = board.getRows() - (int)lines.size();
+  for (int i = 0; i < (int)lines.size(); i++) {
+    if ((int)lines[i].size() > board.getCols())
+      return false;
+    for (int j = 0; j < (int)lines[i].size(); j++)
+      if (lines[i][j] != '.' && lines[i][j] != ' ')
+        board.set(top + i, j, 8);
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  int depth = 3;
+  int hash_bits = 0;
+  bool divide = false;
+  const char *pieces = "IOJLSZT";
+  const char *path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--depth") && i + 1 < argc)
+      depth = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--pieces") && i + 1 < argc)
+      pieces = argv[++i];
+    else if (!strcmp(argv[i], "--board") && i + 1 < argc)
+      path = argv[++i];
+    else if (!strcmp(argv[i], "--hash") && i + 1 < argc)
+      hash_bits = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--divide"))
+      divide = true;
+  }
+
+  vector<PIECE_TYPE> sequence;
+  if (!parseSequence(pieces, sequence)) {
+    fprintf(stderr, "bad piece sequence: %s\n", pieces);
+    return 1;
+  }
+  if (depth < 1 || hash_bits < 0 || hash_bits > 30) {
+    fprintf(stderr, "depth must be at least 1 and hash bits at most 30\n");
+    return 1;
+  }
+
+  Bitboard board(ROWS, COLS);
+  if (path && !loadBoard(path, board)) {
+    fprintf(stderr, "could not load board from %s\n", path);
+    return 1;
+  }
+
+  Perft perft(sequence, hash_bits);
+  if (divide) {
+    perft.divide(board, depth);
+    return 0;
+  }
+
+  // Every depth is its own search, so each line is a complete perft(d)
+  printf("depth,nodes,seconds,nodes_per_sec\n");
+  for (int d = 1; d <= depth; d++) {
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t nodes = perft.count(board, 0, d);
+    const double elapsed = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+    printf("%d,%llu,%.3f,%.0f\n", d, (unsigned long long)nodes, elapsed,
+           elapsed > 0 ? nodes / elapsed : 0);
+  }
+
+  if (hash_bits > 0)
+    printf("# hash: %ld probes, %ld hits\n", perft.getProbes(), perft.getHits());
+  return 0;
+}
@@ -0,0 +1,285 @@
+//
+//  ReplayCheck.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/25/21.
+//
+//  Checks the replay format end to end: records bot games with
+//  <ReplayWriter>, reads them back with <ReplayReader> and compares every
+//  piece against the game as it was played. Runs headless. Build from the repo
+//  root with:
+//
+//    c++ -std=c++14 -O2 -Isrc tools/ReplayCheck.cpp src/Block.cpp
+//        src/Bitboard.cpp src/Piece.cpp src/Board.cpp src/WideBitboard.cpp
+//        src/MoveGenerator.cpp src/Evaluator.cpp src/Policy.cpp src/Replay.cpp
+//        src/Trace.cpp src/Zobrist.cpp -o replaycheck
+//
+//  Usage: replaycheck [--dir DIR]
+//
+//  Writes its replays to DIR (default /tmp). Also damages a good replay in
+//  ways a crash or a bad download would and checks the reader turns them down
+//  instead of reading past the file. Prints one CSV line per check and exits
+//  with 1 if any failed.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Global.hpp"
+#include "Board.hpp"
+#include "Policy.hpp"
+#include "Replay.hpp"
+
+using std::string;
+using std::vector;
+
+/**
+ What a board should look like after a given piece.
+*/
+struct Expected {
+  uint64_t hash;
+  int lines;
+  int score;
+};
+
+static int failures = 0;
+
+/**
+ Prints the result of a check and counts the failures.
+*/
+static void report(const char *name, const bool &passed) {
+  printf("%s,%s\n", name, passed ? "pass" : "FAIL");
+  if (!passed)
+    failures++;
+}
+
+/**
+ @return: what the board looks like now.
+*/
+static Expected expect(const Board &board) {
+  return { board.getHash(), board.getLines(), board.getScore() };
+}
+
+/**
+ Seeks to every piece from first to last and compares it with what was played.
+
+ @return: true if every seek got there and matched; false otherwise.
+*/
+static bool seekAll(const ReplayReader &reader, const vector<Expected> &expected,
+                    const int &first, const int &last) {
+  Board board;
+  for (int piece = first; piece <= last; piece++) {
+    if (!reader.seek(board, piece))
+      return false;
+    const Expected &e = expected[piece];
+    if (board.getHash() != e.hash || board.getLines() != e.lines || board.getScore() != e.score)
+      return false;
+  }
+  return true;
+}
+
+/**
+ Reads a whole file.
+*/
+static vector<uint8_t> readFile(const string &path) {
+  vector<uint8_t> bytes;
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file)
+    return bytes;
+  int c;
+  while ((c = fgetc(file)) != EOF)
+    bytes.push_back((uint8_t)c);
+  fclose(file);
+  return bytes;
+}
+
+/**
+ Writes a whole file.
+*/
+static void writeFile(const string &path, const vector<uint8_t> &bytes) {
+  FILE *file = fopen(path.c_str(), "wb");
+  if (!file)
+    return;
+  fwrite(bytes.data(), 1, bytes.size(), file);
+  fclose(file);
+}
+
+/**
+ Opens a damaged replay and seeks through all of it.
+
+ @return: true if the reader turned it down or every seek it allowed ended on
+ a board that makes sense; false if a seek got somewhere it shouldn't.
+*/
+static bool survives(const string &path, const vector<uint8_t> &bytes) {
+  writeFile(path, bytes);
+  ReplayReader reader;
+  if (!reader.open(path))
+    return true;
+  Board board;
+  for (int piece = 0; piece <= reader.getPieces(); piece++)
+    if (reader.seek(board, piece) && board.getPieces() != piece)
+      return false;
+  return true;
+}
+
+/**
+ @return: true if the reader turns the damaged replay down; false otherwise.
+*/
+static bool rejects(const string &path, const vector<uint8_t> &bytes) {
+  writeFile(path, bytes);
+  ReplayReader reader;
+  return !reader.open(path);
+}
+
+int main(int argc, char **argv) {
+  string dir = "/tmp";
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--dir")) dir = argv[i + 1];
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  const string path = dir + "/replaycheck.replay";
+
+  // A whole game recorded from the start
+  {
+    HeuristicPolicy policy;
+    Board board(ROWS, COLS, 1.0 / TICK_RATE, 7);
+    vector<Expected> expected(1, expect(board));
+    ReplayWriter writer;
+    const bool opened = writer.open(path, board, 16);
+    for (int i = 0; i < 150 && !board.isOver() && policy.playPiece(board, &writer); i++)
+      expected.push_back(expect(board));
+    const bool closed = writer.close();
+
+    ReplayReader reader;
+    report("record_from_start", opened && closed && reader.open(path) &&
+           seekAll(reader, expected, 0, (int)expected.size() - 1));
+  }
+
+  // Recording started mid-game, between two snapshot boundaries
+  {
+    HeuristicPolicy policy;
+    Board board(ROWS, COLS, 1.0 / TICK_RATE, 11);
+    vector<Expected> expected(1, expect(board));
+    for (int i = 0; i < 37; i++) {
+      policy.playPiece(board);
+      expected.push_back(expect(board));
+    }
+    ReplayWriter writer;
+    const bool opened = writer.open(path, board, 16);
+    for (int i = 0; i < 100 && !board.isOver() && policy.playPiece(board, &writer); i++)
+      expected.push_back(expect(board));
+    const bool closed = writer.close();
+
+    ReplayReader reader;
+    Board scratch;
+    report("reopen_mid_game", opened && closed && reader.open(path) &&
+           seekAll(reader, expected, 37, (int)expected.size() - 1));
+    report("seek_before_recording", reader.open(path) && !reader.seek(scratch, 36));
+  }
+
+  // Taking back pieces and starting the recording over, as the game does
+  {
+    HeuristicPolicy policy;
+    Board board(ROWS, COLS, 1.0 / TICK_RATE, 13);
+    vector<Expected> expected(1, expect(board));
+    vector<BoardState> states(1);
+    board.save(states[0]);
+    ReplayWriter writer;
+    bool opened = writer.open(path, board, 16);
+    for (int i = 0; i < 50; i++) {
+      policy.playPiece(board, &writer);
+      expected.push_back(expect(board));
+      states.emplace_back();
+      board.save(states.back());
+    }
+
+    // Back to piece 45, then play on from there
+    board.restore(states[45]);
+    expected.resize(46);
+    writer.close();
+    opened = opened && writer.open(path, board, 16);
+    for (int i = 0; i < 60 && !board.isOver() && policy.playPiece(board, &writer); i++)
+      expected.push_back(expect(board));
+    const bool closed = writer.close();
+
+    ReplayReader reader;
+    report("reopen_after_undo", opened && closed && reader.open(path) &&
+           seekAll(reader, expected, 45, (int)expected.size() - 1));
+  }
+
+  // Damaged copies of a good replay
+  {
+    HeuristicPolicy policy;
+    Board board(ROWS, COLS, 1.0 / TICK_RATE, 17);
+    ReplayWriter writer;
+    writer.open(path, board, 16);
+    // Snapshots that have a block in the last column
+    vector<int> wide;
+    for (int i = 0; i < 64 && !board.isOver() && policy.playPiece(board, &writer); i++) {
+      const Bitboard &b = board.getBitboard();
+      bool last = false;
+      for (int row = 0; row < b.getRows(); row++)
+        last = last || ((b.getRow(row) >> COLS) & 1);
+      if (last && board.getPieces() % 16 == 0)
+        wide.push_back(board.getPieces());
+    }
+    writer.close();
+    const vector<uint8_t> good = readFile(path);
+    // The footer is the index offset, # of chunks, # of pieces and the magic
+    const size_t footer = good.size() - 20;
+
+    vector<uint8_t> bad = good;
+    bad.resize(good.size() / 2);
+    report("truncated", rejects(path, bad));
+
+    const uint8_t sizes[][2] = { { 0, COLS }, { 200, COLS }, { ROWS, 0 }, { ROWS, 63 } };
+    bool sized = true;
+    for (const auto &size : sizes) {
+      bad = good;
+      bad[5] = size[0];
+      bad[6] = size[1];
+      sized = rejects(path, bad) && sized;
+    }
+    report("bad_dimensions", sized);
+
+    // Index offset past the end, and one chunk too many
+    bad = good;
+    bad[footer + 7] = 0x7F;
+    bool indexed = rejects(path, bad);
+    bad = good;
+    bad[footer + 8]++;
+    indexed = rejects(path, bad) && indexed;
+    report("bad_index", indexed);
+
+    // Narrow the board: a stored row with a block in the last column is now
+    // wider than the board
+    bad = good;
+    bad[6] = COLS - 1;
+    writeFile(path, bad);
+    ReplayReader reader;
+    Board scratch;
+    bool narrowed = !wide.empty() && reader.open(path);
+    for (const int &piece : wide)
+      narrowed = narrowed && !reader.seek(scratch, piece);
+    report("rows_wider_than_board", narrowed);
+
+    // Random damage anywhere, with the footer's magic left alone
+    srand(5);
+    bool flipped = true;
+    for (int i = 0; i < 2000; i++) {
+      bad = good;
+      for (int n = 1 + rand() % 4; n > 0; n--)
+        bad[rand() % footer] ^= (uint8_t)(1 + rand() % 255);
+      flipped = survives(path, bad) && flipped;
+    }
+    report("random_damage", flipped);
+  }
+
+  remove(path.c_str());
+  return failures == 0 ? 0 : 1;
+}
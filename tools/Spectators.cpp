@@ -0,0 +1,240 @@
+//
+//  Spectators.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/25/21.
+//
+//  Broadcasts one bot game to many local viewers through the spectator feed
+//  in src/Spectator.hpp and the shared-memory ring in src/SpectatorRing.hpp,
+//  and checks that every viewer ends up seeing the game as it is. Linux only.
+//  Build from the repo root with:
+//
+//    c++ -std=c++14 -O2 -pthread -Isrc tools/Spectators.cpp src/Spectator.cpp
+//        src/SpectatorRing.cpp src/Protocol.cpp src/Policy.cpp
+//        src/Evaluator.cpp src/MoveGenerator.cpp src/Replay.cpp src/Block.cpp
+//        src/Bitboard.cpp src/Piece.cpp src/Board.cpp src/WideBitboard.cpp
+//        src/Trace.cpp src/Zobrist.cpp -o spectators
+//
+//  Usage: spectators [--viewers N] [--ticks T] [--rate R] [--interval K]
+//                    [--capacity BYTES] [--seed S] [--ring NAME]
+//
+//  The bot makes one input per tick, as a fast player would, and the game gets
+//  one tick of gravity after each. Every tick is encoded against the one
+//  before and published to the ring; each viewer is a thread with its own
+//  mapping of the ring, as another process would have. --rate paces the game
+//  at R ticks per second, 0 for as fast as it goes. Viewers that fall a ring
+//  behind start again from the latest keyframe, counted as resyncs. Prints
+//  the results as CSV, with the bytes a full STATE every tick would take for
+//  comparison.
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "Global.hpp"
+#include "Board.hpp"
+#include "MoveGenerator.hpp"
+#include "Policy.hpp"
+#include "Protocol.hpp"
+#include "Spectator.hpp"
+#include "SpectatorRing.hpp"
+
+using std::string;
+using std::vector;
+
+/**
+ One viewer: what it decoded and how it went.
+*/
+struct Viewer {
+  std::thread thread;
+  SpectatorDecoder decoder;
+  long frames = 0;
+  long resyncs = 0;
+  bool attached = false;
+};
+
+/**
+ Follows the ring until the game is done and the viewer has caught up.
+*/
+static void watch(Viewer &viewer, const string &name, const std::atomic<bool> &done) {
+  SpectatorRing ring;
+  while (!ring.attach(name))
+    if (done)
+      return;
+  viewer.attached = true;
+
+  uint64_t cursor = ring.getKeyframe();
+  vector<uint8_t> in;
+  while (true) {
+    // Only stop on an empty read that started after the writer was done
+    const bool finished = done;
+    const RING_READ result = ring.read(cursor, in);
+    if (result == RING_LOST) {
+      cursor = ring.getKeyframe();
+      viewer.decoder.reset();
+      viewer.resyncs++;
+      continue;
+    }
+    if (result == RING_EMPTY) {
+      if (finished)
+        return;
+      std::this_thread::yield();
+      continue;
+    }
+
+    size_t offset = 0;
+    while (offset < in.size()) {
+      MESSAGE type;
+      const uint8_t *body;
+      int length;
+      const int size = Protocol::frame(in.data() + offset, in.size() - offset, type, body, length);
+      if (size <= 0)
+        break;
+      offset += size;
+      if (type == MSG_SPECTATE && viewer.decoder.apply(body, length))
+        viewer.frames++;
+    }
+  }
+}
+
+/**
+ @return: true if the view matches the board; false otherwise.
+*/
+static bool matches(const SpectatorView &view, const Board &board) {
+  const Bitboard &b = board.getBitboard();
+  const Piece &active = board.getActive();
+  if (view.rows != b.getRows() || view.cols != b.getCols())
+    return false;
+  for (int row = 0; row < b.getRows(); row++)
+    if (view.stack[row] != ((b.getRow(row) >> 1) & ((1u << b.getCols()) - 1)))
+      return false;
+  return view.type == active.getType() && view.rotation == active.getRotation() &&
+         view.pivot.x == active.getPivot().x && view.pivot.y == active.getPivot().y &&
+         view.pieces == (uint32_t)board.getPieces() && view.lines == (uint32_t)board.getLines() &&
+         view.score == (uint32_t)board.getScore() && view.over == board.isOver();
+}
+
+int main(int argc, char **argv) {
+  int viewers = 64;
+  long ticks = 100000;
+  double rate = 0;
+  int interval = 60;
+  long capacity = 1 << 16;
+  unsigned seed = 1;
+  string name = "/tetris-spectate-" + std::to_string(getpid());
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--viewers")) viewers = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--ticks")) ticks = atol(argv[i + 1]);
+    else if (!strcmp(argv[i], "--rate")) rate = atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--interval")) interval = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--capacity")) capacity = atol(argv[i + 1]);
+    else if (!strcmp(argv[i], "--seed")) seed = (unsigned)atol(argv[i + 1]);
+    else if (!strcmp(argv[i], "--ring")) name = argv[i + 1];
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  SpectatorRing ring;
+  if (capacity < 1024 || !ring.create(name, (size_t)capacity)) {
+    fprintf(stderr, "could not create the ring %s\n", name.c_str());
+    return 1;
+  }
+
+  std::atomic<bool> done(false);
+  vector<std::unique_ptr<Viewer>> watching;
+  for (int i = 0; i < viewers; i++) {
+    watching.emplace_back(new Viewer());
+    Viewer *viewer = watching.back().get();
+    viewer->thread = std::thread([viewer, &name, &done]() { watch(*viewer, name, done); });
+  }
+
+  Board board(ROWS, COLS, 1.0 / TICK_RATE, seed);
+  HeuristicPolicy policy;
+  MoveGenerator generator;
+  SpectatorEncoder encoder(interval);
+  vector<ACTION> path;
+  size_t next = 0;
+  int planned = -1;
+  unsigned games = 0;
+
+  // What sending the whole state every tick would cost
+  vector<uint8_t> full;
+  Protocol::encodeState(full, 0, board, true);
+
+  vector<uint8_t> frame;
+  long frames = 0, keyframes = 0, bytes = 0;
+  double encoding = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (long tick = 0; tick < ticks; tick++) {
+    if (board.isOver()) {
+      board.reset(seed + ++games);
+      planned = -1;
+    }
+    // Walk each new piece to where the bot wants it
+    if (board.getPieces() != planned) {
+      planned = board.getPieces();
+      path.clear();
+      next = 0;
+      const vector<Placement> &placements = generator.generate(board.getBitboard(), board.getActive());
+      if (!placements.empty()) {
+        const Path steps = generator.getPath(placements[policy.choose(board, placements)]);
+        path.assign(steps.begin(), steps.end());
+        path.push_back(HARD_DROP);
+      }
+    }
+    if (next < path.size())
+      board.step(path[next++]);
+    board.step(TICK);
+
+    const auto before = std::chrono::steady_clock::now();
+    const int flags = encoder.encode(board, frame);
+    if (flags) {
+      ring.publish(frame.data(), frame.size(), flags & SPEC_KEYFRAME);
+      frames++;
+      keyframes += (flags & SPEC_KEYFRAME) != 0;
+      bytes += (long)frame.size();
+      frame.clear();
+    }
+    encoding += std::chrono::duration<double>(std::chrono::steady_clock::now() - before).count();
+
+    if (rate > 0)
+      std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>((tick + 1) / rate)));
+  }
+  const double seconds = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - start).count();
+
+  done = true;
+  long viewed = 0, resyncs = 0, mismatches = 0;
+  for (const std::unique_ptr<Viewer> &viewer : watching) {
+    viewer->thread.join();
+    viewed += viewer->frames;
+    resyncs += viewer->resyncs;
+    if (!viewer->attached || !viewer->decoder.isSynced() || !matches(viewer->decoder.getView(), board))
+      mismatches++;
+  }
+
+  printf("ticks,%ld\n", ticks);
+  printf("frames,%ld\n", frames);
+  printf("keyframes,%ld\n", keyframes);
+  printf("bytes_per_tick,%.2f\n", (double)bytes / std::max(ticks, 1L));
+  printf("bytes_per_frame,%.2f\n", (double)bytes / std::max(frames, 1L));
+  printf("full_state_bytes_per_tick,%zu\n", full.size());
+  printf("encode_ns_per_tick,%.1f\n", encoding * 1e9 / std::max(ticks, 1L));
+  printf("seconds,%.3f\n", seconds);
+  printf("viewers,%d\n", viewers);
+  printf("viewer_frames,%ld\n", viewed);
+  printf("resyncs,%ld\n", resyncs);
+  printf("mismatches,%ld\n", mismatches);
+  return mismatches == 0 ? 0 : 1;
+}
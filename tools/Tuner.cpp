@@ -0,0 +1,300 @@
+//
+//  Tuner.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/24/21.
+//
+//  Evolves the heuristic weights with a genetic algorithm, scoring every
+//  candidate by playing seeded headless games with <HeuristicPolicy>. The
+//  games use the same Board and Piece code as the shipped game, and are spread
+//  across every core. Build from the repo root with:
+//
+//    c++ -std=c++14 -O2 -pthread -Isrc tools/Tuner.cpp src/Block.cpp
+//        src/Bitboard.cpp src/Piece.cpp src/Board.cpp src/WideBitboard.cpp
+//        src/MoveGenerator.cpp src/Evaluator.cpp src/Policy.cpp src/Replay.cpp
+//        src/WorkStealingPool.cpp src/Trace.cpp src/Zobrist.cpp -o tuner
+//
+//  Usage: tuner [--population P] [--generations G] [--games N]
+//               [--max-pieces M] [--threads T] [--seed S] [--checkpoint FILE]
+//
+//  Every candidate in a generation plays the same N seeds, so they are compared
+//  on the same pieces; the seeds change from one generation to the next so the
+//  weights don't fit one set of games. With --checkpoint, the population is
+//  saved to FILE after every generation, and a run started with an existing
+//  FILE picks up where it stopped. The games are drawn from --seed and
+//  --games, so those are saved too and a resume has to pass the same ones.
+//  A FILE that exists but can't be read stops the run instead of being
+//  overwritten. Prints one CSV line per generation.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Global.hpp"
+#include "Board.hpp"
+#include "Policy.hpp"
+#include "WorkStealingPool.hpp"
+
+using std::string;
+using std::vector;
+
+/**
+ # of weights in a <Weights>.
+*/
+static const int GENES = 4;
+
+/**
+ A weight vector and how well it played. Vectors are kept at unit length: only
+ the direction changes which placement scores best.
+*/
+struct Candidate {
+  double genes[GENES];
+  double fitness;
+};
+
+/**
+ @return: the candidate's genes as policy weights.
+*/
+static Weights toWeights(const Candidate &c) {
+  Weights weights;
+  weights.height = c.genes[0];
+  weights.lines = c.genes[1];
+  weights.holes = c.genes[2];
+  weights.bumpiness = c.genes[3];
+  return weights;
+}
+
+/**
+ Scales the genes to unit length.
+*/
+static void normalize(Candidate &c) {
+  double length = 0;
+  for (const double &g : c.genes)
+    length += g * g;
+  length = std::sqrt(length);
+  if (length > 0)
+    for (double &g : c.genes)
+      g /= length;
+}
+
+/**
+ Writes the population about to be scored in the given generation, and the
+ seed and # of games the games are drawn from. Goes through a temporary file,
+ so a run killed mid-write leaves the last checkpoint intact.
+
+ @return: true if it was written; false otherwise.
+*/
+static bool save(const string &path, const unsigned &seed, const int &games, const int &generation,
+                 const vector<Candidate> &population) {
+  const string temporary = path + ".tmp";
+  FILE *file = fopen(temporary.c_str(), "w");
+  if (!file)
+    return false;
+
+  fprintf(file, "seed %u\ngames %d\ngeneration %d\n", seed, games, generation);
+  for (const Candidate &c : population)
+    fprintf(file, "candidate %.17g %.17g %.17g %.17g\n",
+            c.genes[0], c.genes[1], c.genes[2], c.genes[3]);
+  const bool written = fclose(file) == 0;
+  return written && rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+/**
+ Reads a checkpoint written by save(). found is set to false only if there is
+ no file at path, so a fresh run can tell that apart from a bad checkpoint.
+
+ @return: true if it was read; false if it can't be opened or is malformed.
+*/
+static bool load(const string &path, bool &found, unsigned &seed, int &games, int &generation,
+                 vector<Candidate> &population) {
+  FILE *file = fopen(path.c_str(), "r");
+  found = file || errno != ENOENT;
+  if (!file)
+    return false;
+
+  vector<Candidate> loaded;
+  bool ok = fscanf(file, " seed %u games %d generation %d", &seed, &games, &generation) == 3;
+  Candidate c = {};
+  while (ok && fscanf(file, " candidate %lf %lf %lf %lf",
+                      &c.genes[0], &c.genes[1], &c.genes[2], &c.genes[3]) == 4)
+    loaded.push_back(c);
+  ok = ok && feof(file) && loaded.size() >= 2;
+  fclose(file);
+
+  if (ok)
+    population = loaded;
+  return ok;
+}
+
+/**
+ Plays every candidate on the same games and sets its fitness to the mean #
+ of lines it cleared. One task per game, so the slow candidates don't hold
+ up a whole worker.
+*/
+static void evaluate(vector<Candidate> &population, WorkStealingPool &pool, const unsigned &seed,
+                     const int &games, const int &max_pieces) {
+  vector<long> lines(population.size() * games);
+  for (int c = 0; c < (int)population.size(); c++) {
+    for (int g = 0; g < games; g++) {
+      pool.submit([&, c, g](int) {
+        HeuristicPolicy policy(toWeights(population[c]));
+        Board board(ROWS, COLS, 1.0 / TICK_RATE, seed + (unsigned)g);
+        policy.play(board, max_pieces);
+        lines[c * games + g] = board.getLines();
+      });
+    }
+  }
+  pool.wait();
+
+  for (int c = 0; c < (int)population.size(); c++) {
+    long total = 0;
+    for (int g = 0; g < games; g++)
+      total += lines[c * games + g];
+    population[c].fitness = (double)total / games;
+  }
+}
+
+/**
+ Replaces the weakest 30% of a population sorted best first. Each child
+ comes from the two best of a random tenth of the population, averaged by
+ fitness, and now and then has one gene nudged.
+*/
+static void breed(vector<Candidate> &population, std::mt19937 &rng) {
+  const int size = (int)population.size();
+  const int children = std::max(size * 3 / 10, 1);
+  const int tournament = std::max(size / 10, 2);
+  std::uniform_int_distribution<int> pick(0, size - 1);
+  std::uniform_int_distribution<int> gene(0, GENES - 1);
+  std::uniform_real_distribution<double> unit(0, 1);
+
+  vector<Candidate> offspring;
+  for (int i = 0; i < children; i++) {
+    // The population is sorted, so the lowest indices drawn are the fittest
+    int first = size, second = size;
+    for (int t = 0; t < tournament; t++) {
+      const int drawn = pick(rng);
+      if (drawn < first) {
+        second = first;
+        first = drawn;
+      } else if (drawn < second && drawn != first) {
+        second = drawn;
+      }
+    }
+    if (second == size)
+      second = first;
+
+    const Candidate &a = population[first];
+    const Candidate &b = population[second];
+    const double total = a.fitness + b.fitness;
+    const double share = total > 0 ? a.fitness / total : 0.5;
+    Candidate child = {};
+    for (int g = 0; g < GENES; g++)
+      child.genes[g] = share * a.genes[g] + (1 - share) * b.genes[g];
+    if (unit(rng) < 0.05)
+      child.genes[gene(rng)] += unit(rng) * 0.4 - 0.2;
+    normalize(child);
+    offspring.push_back(child);
+  }
+
+  std::copy(offspring.begin(), offspring.end(), population.end() - children);
+}
+
+int main(int argc, char **argv) {
+  int size = 64;
+  int generations = 20;
+  int games = 32;
+  int max_pieces = 500;
+  int threads = (int)std::thread::hardware_concurrency();
+  unsigned seed = 1;
+  string checkpoint;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--population")) size = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--generations")) generations = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--games")) games = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--max-pieces")) max_pieces = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--threads")) threads = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--seed")) seed = (unsigned)atol(argv[i + 1]);
+    else if (!strcmp(argv[i], "--checkpoint")) checkpoint = argv[i + 1];
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (size < 2 || games < 1) {
+    fprintf(stderr, "need a population of at least 2 and at least 1 game\n");
+    return 1;
+  }
+
+  // Start from the hand-tuned weights and random directions around them,
+  // unless there is a run to resume
+  int first = 0;
+  vector<Candidate> population;
+  bool found = false;
+  unsigned saved_seed = 0;
+  int saved_games = 0;
+  if (!checkpoint.empty() &&
+      !load(checkpoint, found, saved_seed, saved_games, first, population) && found) {
+    fprintf(stderr, "could not read checkpoint %s\n", checkpoint.c_str());
+    return 1;
+  }
+  if (found && (saved_seed != seed || saved_games != games)) {
+    fprintf(stderr, "%s was run with --seed %u --games %d; resume it with the same\n",
+            checkpoint.c_str(), saved_seed, saved_games);
+    return 1;
+  }
+  if (!found) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> unit(-1, 1);
+    const Weights defaults;
+    population.push_back({ { defaults.height, defaults.lines, defaults.holes, defaults.bumpiness }, 0 });
+    while ((int)population.size() < size) {
+      Candidate c = {};
+      for (double &g : c.genes)
+        g = unit(rng);
+      population.push_back(c);
+    }
+    for (Candidate &c : population)
+      normalize(c);
+  } else {
+    fprintf(stderr, "resuming %s at generation %d\n", checkpoint.c_str(), first);
+  }
+
+  WorkStealingPool pool(threads);
+  printf("generation,best,mean,height,lines,holes,bumpiness,seconds\n");
+  for (int generation = first; generation < generations; generation++) {
+    const auto start = std::chrono::steady_clock::now();
+    // Everything that depends on the generation is derived from it, so a
+    // resumed run carries on exactly as the original would have
+    const unsigned games_seed = seed + (unsigned)(generation * games);
+    std::mt19937 rng(seed ^ (0x9E3779B9u * (unsigned)(generation + 1)));
+
+    evaluate(population, pool, games_seed, games, max_pieces);
+    std::stable_sort(population.begin(), population.end(),
+                     [](const Candidate &a, const Candidate &b) { return a.fitness > b.fitness; });
+
+    double mean = 0;
+    for (const Candidate &c : population)
+      mean += c.fitness / population.size();
+    const Candidate &best = population[0];
+    const double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+    printf("%d,%.2f,%.2f,%.6f,%.6f,%.6f,%.6f,%.3f\n", generation, best.fitness, mean,
+           best.genes[0], best.genes[1], best.genes[2], best.genes[3], seconds);
+    fflush(stdout);
+
+    breed(population, rng);
+    if (!checkpoint.empty() && !save(checkpoint, seed, games, generation + 1, population))
+      fprintf(stderr, "could not write %s\n", checkpoint.c_str());
+  }
+
+  return 0;
+}
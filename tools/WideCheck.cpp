@@ -0,0 +1,185 @@
+//
+//  WideCheck.cpp
+//  Tetris
+//
+//  Created by Andy Mina on 5/25/21.
+//
+//  Checks that a <WideBitboard> stack plays out the same game as a <Bitboard>
+//  one: feeds a <Board> and a <WideBoard> the same actions on boards narrow
+//  enough for either and compares them after every one, then plays a few
+//  games on boards thousands of columns wide. Half the games follow a bot that
+//  puts each piece as low as it can go instead of random actions, so rows get
+//  cleared however wide the board is. Runs headless. Build from the repo root
+//  with:
+//
+//    c++ -std=c++14 -O2 -Isrc tools/WideCheck.cpp src/Block.cpp
+//        src/Bitboard.cpp src/Piece.cpp src/Board.cpp src/WideBitboard.cpp
+//        src/MoveGenerator.cpp src/Trace.cpp src/Zobrist.cpp -o widecheck
+//
+//  Usage: widecheck [--games N] [--seed S]
+//
+//  Prints one CSV line per board size and exits with 1 if the two ever
+//  disagreed, or if a <Board> took a size its <Bitboard> can't hold.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "Global.hpp"
+#include "Board.hpp"
+#include "MoveGenerator.hpp"
+
+using std::vector;
+
+/**
+ @return: true if both games are in the same state; false otherwise.
+*/
+static bool matches(const Board &board, const WideBoard &wide) {
+  const Piece &active = board.getActive();
+  const WidePiece &other = wide.getActive();
+  if (active.getType() != other.getType() || active.getRotation() != other.getRotation() ||
+      active.getPivot().x != other.getPivot().x || active.getPivot().y != other.getPivot().y ||
+      board.getPieces() != wide.getPieces() || board.getLines() != wide.getLines() ||
+      board.getScore() != wide.getScore() || board.isOver() != wide.isOver())
+    return false;
+
+  const Bitboard &b = board.getBitboard();
+  for (int row = 0; row < b.getRows(); row++)
+    for (int col = 0; col < b.getCols(); col++)
+      if (b.isOccupied(row, col) != wide.getBitboard().isOccupied(row, col))
+        return false;
+  return true;
+}
+
+/**
+ The heuristic bot piles pieces up in the middle of a wide board and tops out
+ before it fills a row, so the bot here just sinks every piece as deep as it
+ goes, which fills the floor first.
+
+ @return: the index of the placement whose cells sit lowest on the board.
+*/
+static int lowest(const vector<Placement> &placements) {
+  int best = 0, best_depth = -1;
+  for (int i = 0; i < (int)placements.size(); i++) {
+    const Footprint &f = placements[i].piece.getFootprint();
+    int depth = 0;
+    for (int k = 0; k < 4; k++)
+      depth += __builtin_popcountll(f.rows[k]) * (f.top + k);
+    if (depth > best_depth) {
+      best = i;
+      best_depth = depth;
+    }
+  }
+  return best;
+}
+
+/**
+ @return: a random action, mostly moves and ticks so pieces travel before they
+ lock.
+*/
+static ACTION randomAction(std::mt19937 &rng) {
+  static const ACTION ACTIONS[] = {
+    MOVE_LEFT, MOVE_LEFT, MOVE_RIGHT, MOVE_RIGHT, MOVE_DOWN,
+    ROTATE_CW, ROTATE_CCW, TICK, TICK, TICK, TICK, HARD_DROP
+  };
+  return ACTIONS[rng() % (sizeof(ACTIONS) / sizeof(ACTIONS[0]))];
+}
+
+int main(int argc, char **argv) {
+  int games = 50;
+  unsigned seed = 1;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--games")) games = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--seed")) seed = (unsigned)atol(argv[i + 1]);
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  // Boards both can hold, with gravity slow and fast
+  struct Size { int rows; int cols; double gravity; };
+  const Size sizes[] = {
+    { ROWS, COLS, 1.0 / TICK_RATE }, { TALL_ROWS, COLS, 1.0 / TICK_RATE },
+    { ROWS, 16, 0.5 }, { 24, 62, 1.0 / TICK_RATE }
+  };
+
+  printf("rows,cols,games,actions,pieces,lines,mismatches\n");
+  MoveGenerator generator;
+  long mismatches = 0;
+  for (const Size &size : sizes) {
+    std::mt19937 rng(seed);
+    long actions = 0, pieces = 0, lines = 0, wrong = 0;
+    for (int g = 0; g < games; g++) {
+      Board board(size.rows, size.cols, size.gravity, seed + g);
+      WideBoard wide(size.rows, size.cols, size.gravity, seed + g);
+      const bool bot = g & 1;
+      vector<ACTION> path;
+      size_t next = 0;
+      int planned = -1;
+      bool same = matches(board, wide);
+      for (int i = 0; i < 20000 && same && !board.isOver(); i++, actions++) {
+        // The bot walks each new piece to where it wants it, a tick per move
+        if (bot && board.getPieces() != planned) {
+          planned = board.getPieces();
+          path.clear();
+          next = 0;
+          const vector<Placement> &placements = generator.generate(board.getBitboard(), board.getActive());
+          if (!placements.empty()) {
+            const Path steps = generator.getPath(placements[lowest(placements)]);
+            for (const ACTION &step : steps) {
+              path.push_back(step);
+              path.push_back(TICK);
+            }
+            path.push_back(HARD_DROP);
+          }
+        }
+        const ACTION action = !bot ? randomAction(rng) : next < path.size() ? path[next++] : TICK;
+        same = board.step(action) == wide.step(action) && matches(board, wide);
+      }
+      wrong += !same;
+      pieces += board.getPieces();
+      lines += board.getLines();
+    }
+    printf("%d,%d,%d,%ld,%ld,%ld,%ld\n", size.rows, size.cols, games, actions, pieces, lines,
+           wrong);
+    mismatches += wrong;
+  }
+
+  // Boards a <Bitboard> can't hold are turned down: the game is over at once
+  const int too_wide[] = { Bitboard::MAX_COLS + 1, 64, 4096 };
+  for (const int &cols : too_wide) {
+    Board board(ROWS, cols, 1.0 / TICK_RATE, seed);
+    if (!board.isOver() || board.step(HARD_DROP)) {
+      printf("board with %d cols was let through\n", cols);
+      mismatches++;
+    }
+  }
+
+  // Boards only the wide path can hold, where the same play has to stay fast
+  const int widths[] = { 4096, 16384 };
+  printf("rows,cols,games,pieces,pieces_per_sec\n");
+  for (const int &cols : widths) {
+    std::mt19937 rng(seed);
+    long pieces = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int g = 0; g < 4; g++) {
+      WideBoard wide(ROWS, cols, 1.0 / TICK_RATE, seed + g);
+      while (!wide.isOver() && wide.getPieces() < 2000) {
+        const int shift = (int)(rng() % cols) - cols / 2;
+        for (int s = 0; s < std::abs(shift); s++)
+          wide.step(shift < 0 ? MOVE_LEFT : MOVE_RIGHT);
+        wide.step(HARD_DROP);
+      }
+      pieces += wide.getPieces();
+    }
+    const double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+    printf("%d,%d,4,%ld,%.0f\n", ROWS, cols, pieces, pieces / seconds);
+  }
+
+  return mismatches == 0 ? 0 : 1;
+}